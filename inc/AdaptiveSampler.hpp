@@ -0,0 +1,64 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+/**************************************************************************
+
+ Stratified sampling of the frames scored with expensive metrics.
+
+ Every frame is first scored with a cheap metric (PSNR). The frames are
+ split into strata of equal size by cheap-metric quantile, and the budget
+ of expensive computations is allocated to the strata in proportion to
+ their size times the spread of the cheap metric within them (Neyman
+ allocation), with low-quality strata weighted up to twice as much, so
+ that short quality dips are sampled. The mean of an expensive metric over
+ the whole sequence is then estimated with the stratified mean, and its
+ 95% confidence interval with the stratified variance.
+
+**************************************************************************/
+
+#ifndef AdaptiveSampler_hpp
+#define AdaptiveSampler_hpp
+
+#include <vector>
+
+class AdaptiveSampler {
+public:
+    // fraction: share of the frames scored with the expensive metrics
+    explicit AdaptiveSampler(double fraction);
+    // Choose the frames to score from the cheap metric of every frame
+    // (higher is better)
+    // Return the indices of the chosen frames, in increasing order
+    std::vector<int> select(const std::vector<float>& cheap);
+    // Estimate the mean of an expensive metric over all the frames
+    // values[i] is the metric of the i-th chosen frame
+    void estimate(const std::vector<float>& values, double& mean, double& ci95) const;
+private:
+    double fraction;
+    std::vector<int> chosen;	// chosen frames, in increasing order
+    std::vector<int> stratum;	// stratum of each chosen frame
+    std::vector<int> sizes;		// number of frames in each stratum
+    std::vector<int> samples;	// number of chosen frames in each stratum
+};
+
+#endif
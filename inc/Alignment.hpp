@@ -0,0 +1,74 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+/**************************************************************************
+
+ Estimation of the spatial offset between the original and processed
+ frames (shifts and crops introduced by encoding pipelines and scalers).
+
+ A coarse offset is found by phase correlation of thumbnails, then refined
+ by an SSD search at full resolution, and optionally to a fraction of a
+ pixel by fitting a parabola to the SSD around its minimum. The metrics
+ are then computed on the region where both frames overlap: ROIs of the
+ decoded frames for integer offsets, the processed frame being resampled
+ only for subpixel offsets.
+
+**************************************************************************/
+
+#ifndef Alignment_hpp
+#define Alignment_hpp
+
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+class Alignment {
+public:
+    // max_shift: largest offset searched, in pixels
+    Alignment(int max_shift, bool subpixel);
+    // Add a pair of frames (CV_32F) to the estimate
+    void addFrames(const cv::Mat& original, const cv::Mat& processed);
+    // Estimate the offset from the frames added so far
+    bool estimate();
+    // Offset such that processed(y,x) matches original(y+dy,x+dx)
+    double getOffsetX() const;
+    double getOffsetY() const;
+    // Size of the overlapping region
+    int getHeight() const;
+    int getWidth() const;
+    // Overlapping regions of a pair of frames
+    void apply(const cv::Mat& original, const cv::Mat& processed, cv::Mat& original_roi, cv::Mat& processed_roi);
+private:
+    int max_shift;
+    bool subpixel;
+    std::vector<cv::Mat> originals;
+    std::vector<cv::Mat> processeds;
+    int ix, iy;		// integer part of the offset
+    double fx, fy;		// fractional part of the offset
+    cv::Rect original_region;
+    cv::Rect processed_region;
+    // Mean squared difference over the overlap for an integer offset
+    double ssd(int dx, int dy) const;
+};
+
+#endif
@@ -0,0 +1,84 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+/**************************************************************************
+
+ Pre-analysis of a source for encoders: per-block complexity maps and the
+ spatial and temporal information of each frame, in a single pass over
+ the luma without a processed stream.
+
+ Per frame:
+ - mean and variance of the luma,
+ - SI: standard deviation of the Sobel gradient magnitude (ITU-T P.910),
+ - TI: standard deviation of the difference with the previous frame,
+ - scene cut flag and scene index, a cut being a mean absolute difference
+   with the previous frame well above the average of the current scene
+   (the first difference inside a scene only seeds that average).
+ Per block (block x block, partial blocks on the right and bottom edges):
+ - variance of the luma (x4, 16 bits),
+ - activity: mean gradient magnitude (x16, 16 bits).
+
+ File layout: MAGIC, then int height, width, block, first frame, blocks_x,
+ blocks_y, then per frame FRAME_VALUES floats, the variance grid and the
+ activity grid (uint16, row-major).
+
+**************************************************************************/
+
+#ifndef Analysis_hpp
+#define Analysis_hpp
+
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include "FramePool.hpp"
+
+class Analysis {
+public:
+    Analysis(int height, int width, int block);
+    // Number of blocks of a grid
+    size_t gridSize() const;
+    // Analyse the next frame of the sequence (luma, CV_32F), which is held
+    // until the following one for TI
+    // stats receives FRAME_VALUES values: mean, variance, SI, TI, cut, scene
+    void analyze(const FrameRef& frame, std::vector<float>& stats,
+                 std::vector<uint16_t>& variance, std::vector<uint16_t>& activity);
+    // Write the header of an analysis file whose first frame is first,
+    // false if it cannot be written
+    bool writeHeader(FILE *file, int first);
+    static const int FRAME_VALUES = 6;
+private:
+    int height;
+    int width;
+    int block;
+    int blocks_x;
+    int blocks_y;
+    FrameRef previous;	// previous frame, null before the first one
+    double scene_mad;	// sum of the mean absolute differences in the scene
+    int scene_frames;	// frames of the scene after its first one
+    int scene;		// index of the current scene
+    static const char MAGIC[8];
+};
+
+#endif
@@ -0,0 +1,48 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+/**************************************************************************
+
+ Helpers for the benchmark modes: synthetic frames and timing.
+
+**************************************************************************/
+
+#ifndef Benchmark_hpp
+#define Benchmark_hpp
+
+#include <functional>
+#include <opencv2/core/core.hpp>
+
+class Benchmark {
+public:
+    // Synthetic pair of luma frames (CV_32F, 0-255): a textured original
+    // and a blurred, noisy version of it as processed. The content is the
+    // same on every call, so that runs can be compared.
+    static void syntheticFrames(int height, int width, cv::Mat& original, cv::Mat& processed);
+    // Average duration of fn, in seconds, run at least min_runs times and
+    // for at least min_time seconds
+    static double time(const std::function<void()>& fn, double min_time, int min_runs = 3);
+};
+
+#endif
@@ -0,0 +1,140 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+/**************************************************************************
+
+ Distribution of a job over several hosts.
+
+ A coordinator splits the frames to score into ranges and hands them out
+ over TCP to worker processes, which must see the input files under the
+ same paths (shared storage). Workers report each scored frame and are
+ told in return where their range currently ends: when a worker asks for
+ work and none is left, the coordinator steals the second half of the
+ largest range in progress, so that fast workers keep busy until the last
+ frame. The ranges of disconnected workers, and of workers silent for
+ longer than the timeout, are handed out again; the coordinator gives up
+ when no worker has been connected for that long. There is no
+ authentication: the coordinator is meant to listen on a trusted network
+ only (see the bind address). Not available on Windows.
+
+ Protocol, one text line per message:
+   worker      -> coordinator: HELLO | FRAME <frame> <values...> | DONE
+   coordinator -> worker:      JOB <height> <width> <chroma> <bitdepth> <transfer> <full range>
+                                   <start> <frames> <n> <metrics...>
+                               ORIGINAL <path> | PROCESSED <path>
+                               RANGE <first> <end> | LIMIT <end> | QUIT
+
+**************************************************************************/
+
+#ifndef Cluster_hpp
+#define Cluster_hpp
+
+#include <chrono>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Job description, sent to each worker
+struct ClusterJob {
+    std::string original;
+    std::string processed;
+    int height;
+    int width;
+    int chroma;
+    int bitdepth;
+    int transfer;		// TransferFunction
+    bool full_range;
+    int start;		// first frame to score
+    int nbframes;		// number of frames to score
+    std::vector<std::string> metrics;	// names of the metrics
+};
+
+// Buffered line-oriented TCP channel
+class LineChannel {
+public:
+    explicit LineChannel(int fd);
+    int descriptor() const;
+    // Receive what is available, false once the peer is gone
+    bool receive();
+    // Extract a complete line from what was received, false if none
+    bool nextLine(std::string& line);
+    // Blocking read of a complete line, false once the peer is gone
+    bool readLine(std::string& line);
+    bool writeLine(const std::string& line);
+    void close();
+private:
+    int fd;
+    std::string buffer;
+};
+
+class Coordinator {
+public:
+    // bind: address of the interface to listen on, empty for all of them
+    // range: number of frames in the ranges handed out first
+    // timeout: seconds without news from a worker scoring a range, or
+    // without any worker, before giving up on it
+    Coordinator(const ClusterJob& job, const std::string& bind, int port, int range, int timeout);
+    // Serve the workers until all frames are scored, then write one results
+    // file per metric, as a local run would
+    int run(const std::string& results_path);
+private:
+    struct Connection {
+        LineChannel channel;
+        bool idle;		// waiting for a range
+        int next;		// frame being scored
+        int end;		// end of the range (exclusive)
+        std::chrono::steady_clock::time_point active;	// last message or range
+    };
+    ClusterJob job;
+    std::string bind_address;
+    int port;
+    int timeout;		// in seconds
+    std::vector<Connection> connections;
+    std::deque<std::pair<int,int>> ranges;	// ranges not handed out yet
+    std::vector<float> results;		// nbframes x number of metrics
+    std::vector<bool> scored;
+    std::vector<double> sums;		// running sum of each metric
+    int nscored;
+    void handle(Connection& conn, const std::string& line);
+    // Give a range to each idle worker, stealing from the slowest ones
+    void dispatch();
+    bool sendRange(Connection& conn, int first, int end);
+    void drop(Connection& conn);
+    int writeResults(const std::string& results_path) const;
+};
+
+class Worker {
+public:
+    // address: host:port of the coordinator
+    Worker(const std::string& address, int nthreads, size_t readahead);
+    int run();
+private:
+    std::string host;
+    std::string port;
+    int nthreads;
+    size_t readahead;
+};
+
+#endif
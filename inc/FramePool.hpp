@@ -0,0 +1,127 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+/**************************************************************************
+
+ Pool of reference-counted frames, shared without copies.
+
+ A reader takes a free frame, fills it and hands out references to it;
+ from then on the frame is immutable, and any number of consumers (other
+ threads, the following frames of a temporal analysis) may hold it. The
+ frame goes back to the pool when its last reference is dropped. The
+ frames are allocated once, one below the other in a single buffer, and
+ the free list is a lock-free stack (Treiber stack, with a tag against
+ ABA), so that steady state takes no lock and no allocation. A reader
+ finding no free frame sleeps until one is released.
+
+ The frames are handed out in the order of the buffer at first, and a
+ batch released from its last frame to its first is handed out again in
+ that order, so that consecutive frames of a batch are stacked without
+ copies (see Metric::stack()).
+
+ The pre-analysis reads its frames through a pool (and keeps the previous
+ one for TI by reference), as do the batches of the metric modes and the
+ ERP frames shared by the viewports.
+
+**************************************************************************/
+
+#ifndef FramePool_hpp
+#define FramePool_hpp
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+class FramePool;
+
+class Frame {
+public:
+    int number;		// frame number in the stream
+    cv::Mat image;		// preallocated by the pool, filled in place
+private:
+    friend class FramePool;
+    friend class FrameRef;
+    FramePool *pool;
+    std::atomic<int> refs;
+    uint32_t index;		// index in the pool
+    std::atomic<uint32_t> next;	// next free frame, in the free list
+};
+
+// Shared reference to a frame of a pool, null by default
+class FrameRef {
+public:
+    FrameRef();
+    FrameRef(const FrameRef& other);
+    FrameRef(FrameRef&& other);
+    FrameRef& operator=(FrameRef other);
+    ~FrameRef();
+    explicit operator bool() const;
+    const Frame& operator*() const;
+    const Frame *operator->() const;
+    // Frame to fill, only for the reader holding the single reference to a
+    // frame just taken from the pool: a shared frame is immutable, filling
+    // it is an error
+    Frame *fill();
+private:
+    friend class FramePool;
+    explicit FrameRef(Frame *frame);
+    Frame *frame;
+};
+
+class FramePool {
+public:
+    // nframes frames of height x width samples of type
+    FramePool(int nframes, int height, int width, int type);
+    // All the references have to be dropped first
+    ~FramePool();
+    // Take a free frame, waiting for one to be released if there is none,
+    // for up to timeout seconds when positive
+    // Return a null reference on timeout
+    FrameRef acquire(double timeout = -1.0);
+    // Take a free frame, or return a null reference if there is none
+    FrameRef tryAcquire();
+    // Type of the samples of the frames
+    int type() const;
+private:
+    friend class FrameRef;
+    std::vector<std::unique_ptr<Frame>> frames;
+    cv::Mat buffer;		// the images of all the frames
+    int image_type;
+    // Readers waiting in acquire(), woken up by release()
+    std::atomic<int> waiting;
+    std::mutex wait_mutex;
+    std::condition_variable released;
+    // Top of the free list: index of the frame in the low 32 bits, tag
+    // incremented on every change in the high 32 bits
+    std::atomic<uint64_t> head;
+    static const uint32_t NONE = 0xffffffff;
+    // Push a frame whose last reference was dropped
+    void release(Frame *frame);
+};
+
+#endif
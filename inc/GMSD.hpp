@@ -0,0 +1,72 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+//
+// This is an OpenCV implementation of the original Matlab implementation
+// from Wufeng Xue available from http://www4.comp.polyu.edu.hk/~cslzhang/IQA/GMSD/GMSD.htm.
+// Please refer to the following paper:
+// - W. Xue, L. Zhang, X. Mou, and A.C. Bovik, "Gradient magnitude
+//   similarity deviation: a highly efficient perceptual image quality
+//   index," IEEE Transactions on Image Processing, vol. 23, no. 2,
+//   pp. 684–695, February 2014.
+//
+
+/**************************************************************************
+
+ Calculation of the Gradient Magnitude Similarity Deviation (GMSD) image
+ quality measure.
+
+ GMSD works on the images downsampled by 2, with the same 2x2 averaging as
+ the first level of the MS-SSIM pyramid, so that MSSSIM can share its
+ planes (see MSSSIM::computeBatch()). Lower is better.
+
+**************************************************************************/
+
+#ifndef GMSD_hpp
+#define GMSD_hpp
+
+#include "Metric.hpp"
+
+class GMSD : protected Metric {
+public:
+    GMSD(int height, int width);
+    // Compute the GMSD index of the processed image
+    float compute(const cv::Mat& original, const cv::Mat& processed);
+    // Compute the GMSD index for a batch of frames, results[i] for frame i
+    // Small frames are stacked, with a row of zeros between them, so that
+    // the gradients of many frames are computed by one call
+    void computeFrames(const std::vector<cv::Mat>& original, const std::vector<cv::Mat>& processed,
+                       std::vector<float>& results);
+    // Compute the GMSD index from the images already downsampled by 2
+    float computeDownsampled(const cv::Mat& original, const cv::Mat& processed);
+private:
+    static const double T;
+    // Prewitt kernels
+    cv::Mat dx;
+    cv::Mat dy;
+    // Gradient magnitude
+    void gradientMagnitude(const cv::Mat& img, cv::Mat& gm);
+};
+
+#endif
@@ -0,0 +1,89 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+/**************************************************************************
+
+ Backends reading the input files for VideoYUV.
+
+   read     read() and lseek(), the page cache and the kernel read-ahead
+   mmap     the file is mapped, frames are copied out of the mapping
+   uring    io_uring, a chunk is split into requests in flight together
+            (only when built with liburing)
+   direct   O_DIRECT, bypasses the page cache through an aligned buffer
+            (not supported by all file systems, tmpfs for one)
+
+ Pipes are always read with read(), and so is everything on Windows,
+ where the other backends are left out. The backend is chosen once for
+ the process with select(), and auto picks the fastest with probe().
+
+**************************************************************************/
+
+#ifndef IOBackend_hpp
+#define IOBackend_hpp
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <string>
+#include <vector>
+
+enum IOMode {
+    IO_AUTO = 0,
+    IO_READ = 1,
+    IO_MMAP = 2,
+    IO_URING = 3,
+    IO_DIRECT = 4,
+    IO_MODES = 5
+};
+
+class IOBackend {
+public:
+    virtual ~IOBackend();
+    // Open a file, return false if the backend cannot read it
+    virtual bool open(const std::string& path) = 0;
+    // Read up to bytes at the current position
+    // Return the number of bytes read, 0 at the end of the file, -1 on error
+    virtual ssize_t read(void *buf, size_t bytes) = 0;
+    // Move the current position, return false on failure
+    virtual bool seek(int64_t offset) = 0;
+    // Hint that the whole file is going to be read sequentially soon
+    virtual void willNeed() = 0;
+
+    // New backend of the given mode (IO_AUTO: the selected one), closed
+    static IOBackend *create(int mode = IO_AUTO);
+    // Backend used by create() from now on
+    static void select(int mode);
+    static int selected();
+    // Mode of a name, -1 if unknown
+    static int parse(const std::string& name);
+    static const char *name(int mode);
+    // False for the backends left out of the build
+    static bool available(int mode);
+    // Read up to bytes of path, split between the available backends, each
+    // on its own part of the file dropped from the page cache beforehand
+    // bandwidth receives the MB/s of each mode (0 if not measured)
+    // Return the fastest mode, IO_READ if nothing could be measured
+    static int probe(const std::string& path, size_t bytes, std::vector<double>& bandwidth);
+};
+
+#endif
@@ -0,0 +1,80 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+/**************************************************************************
+
+ Bulk scoring of still image pairs listed in a manifest.
+
+ The pairs are independent and of any size: they are decoded and scored on
+ the thread pool, in chunks stolen by idle workers. The metrics take the
+ geometry from the images, so the engines are kept in a pool and reused by
+ the following pairs whatever their size (engines beyond max_idle are
+ dropped). The decoded images go to per-thread buffers that only grow,
+ images being views of their first samples, so that steady state needs no
+ allocation for them.
+
+**************************************************************************/
+
+#ifndef ImageScorer_hpp
+#define ImageScorer_hpp
+
+#include <stdio.h>
+#include <list>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "MetricEngine.hpp"
+#include "ThreadPool.hpp"
+
+class ImageScorer {
+public:
+    // metrics: indexes (see Metrics) of the metrics to compute, in the
+    // order of the results columns
+    ImageScorer(const std::vector<int>& metrics, size_t max_idle);
+    ~ImageScorer();
+    // Score the pairs of a manifest, one "original processed" pair of paths
+    // per line (blank lines and lines starting with '#' are skipped), and
+    // write one CSV line per pair to results, in the order of the manifest
+    // Return the number of pairs that could not be scored, or -1 if the
+    // manifest cannot be read
+    long run(const std::string& manifest, ThreadPool *pool, FILE *results);
+private:
+    std::vector<int> metrics;
+    bool enabled[METRIC_SIZE];
+    bool color;		// a metric needs the colour components
+    size_t max_idle;
+    std::list<MetricEngine *> idle;	// engines not in use, most recently used first
+    std::mutex mutex;
+    // Engine from the pool, or set up for images of height x width
+    MetricEngine *acquire(int height, int width);
+    // Give an engine back to the pool
+    void release(MetricEngine *engine);
+    // Score one pair, results[m] for metric m
+    // Return an error message, or nullptr on success
+    const char *score(const std::string& original, const std::string& processed,
+                      int& height, int& width, std::vector<float>& results);
+};
+
+#endif
@@ -0,0 +1,92 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+/**************************************************************************
+
+ Load shedding for real-time input (FIFO fed by a live decoder).
+
+ Every metric has a priority and a per-frame cost, learned online from its
+ measured compute times (exponential moving average). Before each frame,
+ the lag behind real time sets the time budget of the frame: one frame
+ period, minus the lag spread over the next CATCHUP seconds. While the
+ expected cost of the frame is over budget, the least important metric
+ (then the most expensive) is degraded by one level:
+   0  every frame, full resolution
+   1  every frame, half resolution (when the metric supports the size)
+   2+ one frame in 2, 4, ..., MAX_STRIDE, at the lowest resolution
+ Metrics of priority 0 (PSNR) are cheap and always run on every frame.
+
+**************************************************************************/
+
+#ifndef LoadShedder_hpp
+#define LoadShedder_hpp
+
+#include <string>
+#include <vector>
+
+class LoadShedder {
+public:
+    // fps: frame rate of the input
+    // metrics: indexes (see Metrics) of the metrics
+    // half[i]: metrics[i] can be computed at half resolution
+    LoadShedder(double fps, const std::vector<int>& metrics, const std::vector<bool>& half);
+    // Plan a frame (index from the first frame) given the lag behind real
+    // time, in seconds (positive when late)
+    // Return true if the level of a metric changed since the previous frame
+    bool plan(int frame, double lag);
+    // Whether metric i runs on the planned frame, and at half resolution
+    bool runs(size_t i) const;
+    bool halved(size_t i) const;
+    // Record the time taken by metric i on the planned frame
+    void record(size_t i, double seconds);
+    // Current level of metric i, e.g. "half, 1/4"
+    std::string describe(size_t i) const;
+    // Frames of metric i computed at full and half resolution, and shed
+    void counts(size_t i, long& full, long& half, long& shed) const;
+    // Cost estimate of metric i at full resolution, in seconds
+    double cost(size_t i) const;
+private:
+    struct State {
+        int priority;
+        bool half;		// has a half-resolution level
+        double cost_full;	// seconds per frame, 0 until measured
+        double cost_half;
+        int level;
+        bool run;		// runs on the planned frame
+        long full, halves, shed;
+    };
+    double period;
+    std::vector<State> states;
+    // Stride and resolution of a level
+    static int stride(const State& state, int level);
+    static bool isHalf(const State& state, int level);
+    // Expected cost per frame of a level, amortized over its stride
+    static double levelCost(const State& state, int level);
+    static int maxLevel(const State& state);
+    static const double CATCHUP;
+    static const double SMOOTHING;
+    static const int MAX_STRIDE = 16;
+};
+
+#endif
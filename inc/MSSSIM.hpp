@@ -46,14 +46,29 @@
 #ifndef MSSSIM_hpp
 #define MSSSIM_hpp
 
+#include <vector>
 #include "SSIM.hpp"
+#include "GMSD.hpp"
+#include "ThreadPool.hpp"
 
 class MSSSIM : protected SSIM {
 public:
-    MSSSIM(int height, int width);
+    // Levels are computed on the pool when one is given
+    MSSSIM(int height, int width, ThreadPool *pool = nullptr);
     // Compute the SSIM and MS-SSIM indexes of the processed image
     // Return the MS-SSIM index
     float compute(const cv::Mat& original, const cv::Mat& processed);
+    // Compute the SSIM and MS-SSIM indexes of a batch of consecutive frames
+    // The SSIM of a level runs as a task while the next level is built; the
+    // levels smaller than SMALL_LEVEL of all the frames are grouped into one
+    // task
+    void computeBatch(const std::vector<cv::Mat>& original, const std::vector<cv::Mat>& processed,
+                      std::vector<float>& ssim, std::vector<float>& msssim);
+    // Same as above, also computing GMSD on the first level of the pyramid as
+    // soon as it is built (the decimated planes are shared)
+    void computeBatch(const std::vector<cv::Mat>& original, const std::vector<cv::Mat>& processed,
+                      std::vector<float>& ssim, std::vector<float>& msssim,
+                      GMSD& gmsd, std::vector<float>& gmsd_res);
     // Return the SSIM index only
     // compute() needs to be called before getSSIM()
     float getSSIM();
@@ -61,10 +76,15 @@ public:
     // compute() needs to be called before getMSSSIM()
     float getMSSSIM();
 private:
+    ThreadPool *pool;
     double ssim;
     double msssim;
     static const int NLEVS = 5;
+    static const int SMALL_LEVEL = 256*256;
     static const double WEIGHT[];
+    void computeBatch(const std::vector<cv::Mat>& original, const std::vector<cv::Mat>& processed,
+                      std::vector<float>& ssim, std::vector<float>& msssim,
+                      GMSD *gmsd, std::vector<float> *gmsd_res);
 };
 
 #endif
@@ -26,6 +26,7 @@
 #define Metric_hpp
 
 #include <cmath>
+#include <vector>
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 
@@ -34,6 +35,14 @@ public:
     Metric(int height, int width);
     virtual ~Metric();
     virtual float compute(const cv::Mat& original, const cv::Mat& processed) = 0;
+    // Compute the metric for a batch of frames, results[i] for frame i
+    // The default calls compute() on each frame, metrics whose kernels work
+    // on stacked frames (see stack()) process many small frames per call
+    virtual void computeFrames(const std::vector<cv::Mat>& original, const std::vector<cv::Mat>& processed,
+                               std::vector<float>& results);
+    // Number of frames of the given size stacked together, as many as fit
+    // in STACK_PIXELS (at least 1)
+    static size_t stackFrames(int height, int width);
 protected:
     int height;
     int width;
@@ -41,6 +50,20 @@ protected:
     // Returns only those parts of the correlation that are computed without zero-padded edges
     // (similarly to 'filter2' in Matlab with option 'valid')
     void applyGaussianBlur(const cv::Mat& src, cv::Mat& dst, int ksize, double sigma);
+    // 2x2 average and decimation by 2 (CV_32F, any number of channels)
+    // Any size: the output has ceil(rows/2) x ceil(cols/2) samples, the last
+    // row and column of odd sizes being averaged with themselves (virtual
+    // edge replication, no padded copy)
+    static void downsample(const cv::Mat& src, cv::Mat& dst);
+    // Every other sample of every other row, starting with the first
+    // (x(1:2:end,1:2:end) in Matlab), ceil(rows/2) x ceil(cols/2) samples
+    static void decimate(const cv::Mat& src, cv::Mat& dst);
+    // Same, for frames of the size of frame
+    static size_t stackFrames(const cv::Mat& frame);
+    // Frames [begin, end) as one image, the frames one below the other: a
+    // view when they are consecutive in a single buffer, otherwise a copy
+    static void stack(const std::vector<cv::Mat>& frames, size_t begin, size_t end, cv::Mat& dst);
+    static const int STACK_PIXELS = 1 << 21;
 };
 
 #endif
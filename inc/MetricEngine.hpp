@@ -0,0 +1,114 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+/**************************************************************************
+
+ Computation of a set of metrics on batches of frames.
+
+ The engine owns one instance of each enabled metric and knows which
+ computations can be shared (SSIM and GMSD with MS-SSIM, PSNR-HVS with
+ PSNR-HVS-M), so that the local loop and the workers of a distributed job
+ score frames the same way. The metrics take the geometry from the frames
+ they are given, so an engine can score frames of any size.
+
+**************************************************************************/
+
+#ifndef MetricEngine_hpp
+#define MetricEngine_hpp
+
+#include <map>
+#include <string>
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+#include "ThreadPool.hpp"
+#include "PSNR.hpp"
+#include "SSIM.hpp"
+#include "MSSSIM.hpp"
+#include "GMSD.hpp"
+#include "VIFP.hpp"
+#include "VIF.hpp"
+#include "PSNRHVS.hpp"
+#include "SSIMULACRA2.hpp"
+
+// Spherical metrics
+#include "WSPSNR.hpp"
+
+enum Metrics {
+    METRIC_PSNR = 0,
+    METRIC_SSIM,
+    METRIC_MSSSIM,
+    METRIC_VIFP,
+    METRIC_PSNRHVS,
+    METRIC_PSNRHVSM,
+    METRIC_VIF,
+    METRIC_GMSD,
+    METRIC_SSIMULACRA2,
+
+    METRIC_WSPSNR,
+    METRIC_WSSSIM,
+    METRIC_WSMMSSSIM,
+    METRIC_SIZE
+};
+
+// Metric names, as given on the command line and used in the results files
+extern const std::map<std::string, Metrics> metric2index;
+
+class MetricEngine {
+public:
+    // enabled: one flag per metric, indexed by Metrics
+    MetricEngine(int height, int width, const bool enabled[METRIC_SIZE], ThreadPool *pool);
+    ~MetricEngine();
+    bool isEnabled(int metric) const;
+    // True if an enabled metric uses the colour components (see the
+    // second computeBatch())
+    bool needsColor() const;
+    // Compute the enabled metrics for consecutive frames, starting at frame
+    // first (only used for tracing)
+    // results[i*METRIC_SIZE+m] receives metric m of frame i, disabled
+    // metrics are left to 0
+    // Colour metrics are computed on the luma, as grey images
+    void computeBatch(int first, const std::vector<cv::Mat>& original, const std::vector<cv::Mat>& processed,
+                      std::vector<float>& results);
+    // Same as above, the colour metrics using the R'G'B' frames (see
+    // VideoYUV::getRGB())
+    void computeBatch(int first, const std::vector<cv::Mat>& original, const std::vector<cv::Mat>& processed,
+                      const std::vector<cv::Mat>& original_rgb, const std::vector<cv::Mat>& processed_rgb,
+                      std::vector<float>& results);
+private:
+    bool enabled[METRIC_SIZE];
+    PSNR *psnr;
+    SSIM *ssim;
+    MSSSIM *msssim;
+    VIFP *vifp;
+    VIF *vif;
+    GMSD *gmsd;
+    PSNRHVS *phvs;
+    SSIMULACRA2 *ssimulacra2;
+    WSPSNR *wspsnr;
+    std::vector<float> psnr_batch, ssim_batch, msssim_batch, vifp_batch, gmsd_batch;
+    std::vector<float> psnrhvs_batch, psnrhvsm_batch;
+};
+
+#endif
@@ -0,0 +1,115 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+//
+// Please refer to the following papers:
+// - A. Mittal, A.K. Moorthy, and A.C. Bovik, "No-reference image quality
+//   assessment in the spatial domain," IEEE Transactions on Image
+//   Processing, vol. 21, no. 12, pp. 4695–4708, December 2012.
+// - A. Mittal, R. Soundararajan, and A.C. Bovik, "Making a 'completely
+//   blind' image quality analyzer," IEEE Signal Processing Letters,
+//   vol. 20, no. 3, pp. 209–212, March 2013.
+//
+
+/**************************************************************************
+
+ No-reference (NR) quality assessment.
+
+ The luma is normalized by its local Gaussian mean and deviation (7x7
+ window, the same local moments as SSIM) into MSCN coefficients, at full
+ and half resolution (halved as MATLAB's imresize, as in the reference
+ code). A generalized Gaussian (GGD) is fitted to the MSCN coefficients
+ and asymmetric ones (AGGD) to the products of neighbouring coefficients in
+ 4 orientations (wrapping around, as circshift), by moment matching,
+ giving 18 features per scale:
+ - BRISQUE: features of the whole frame, mapped to a score by the SVR of
+   the reference code (libsvm model and svm-scale ranges, e.g. allmodel
+   and allrange trained on LIVE). Lower is better.
+ - NIQE: the features of 96x96 patches (with the NIQE definitions of the
+   features) are modelled as a multivariate Gaussian and compared to the
+   model of pristine content (the published mu_prisparam and
+   cov_prisparam, or one trained from pristine videos with saveModel()).
+   Lower is better.
+
+**************************************************************************/
+
+#ifndef NoReference_hpp
+#define NoReference_hpp
+
+#include <string>
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+class NoReference {
+public:
+    static const int NFEATURES = 36;
+    static const int PATCH_SIZE = 96;
+    NoReference(int height, int width);
+    // Compute the MSCN coefficients of a frame (CV_32F), needed by the
+    // feature functions below
+    void analyze(const cv::Mat& luma);
+    // BRISQUE features of the whole frame
+    void frameFeatures(float features[NFEATURES]) const;
+    // Region of the frame covered by whole patches, which NIQE analyzes
+    cv::Rect patchArea() const;
+    // NIQE features of each patch (NFEATURES values per patch), and their
+    // sharpness (mean local deviation), after analyze() of the patch area
+    void patchFeatures(std::vector<float>& features, std::vector<float>& sharpness) const;
+    // Fit the pristine model to patch features and write it to a file
+    static bool saveModel(const std::string& path, const std::vector<float>& features);
+    // Read a pristine model
+    bool loadModel(const std::string& path);
+    // NIQE index of the patch features of a frame, a model has to be loaded
+    float niqe(const std::vector<float>& features) const;
+    // Read the BRISQUE regressor: a libsvm SVR model (RBF kernel) and the
+    // svm-scale ranges of its features
+    bool loadRegressor(const std::string& model, const std::string& range);
+    // BRISQUE score of frame features, a regressor has to be loaded
+    float brisque(const float features[NFEATURES]) const;
+private:
+    int height;
+    int width;
+    cv::Mat mscn[2];	// MSCN coefficients, full and half resolution
+    cv::Mat sigma[2];	// local deviation
+    cv::Mat model_mu;	// pristine model (CV_64F)
+    cv::Mat model_cov;
+    cv::Mat support;	// support vectors of the SVR, one per row (CV_64F)
+    std::vector<double> support_coefs;
+    double svr_gamma;
+    double svr_rho;
+    double range_lower;	// svm-scale target range and feature ranges
+    double range_upper;
+    std::vector<double> feature_min, feature_max;
+    std::vector<double> ratios;	// GGD moment ratio of each tabulated shape
+    // Shape whose moment ratio (GGD), or its inverse (AGGD), is closest to
+    // ratio
+    double shape(double ratio, bool inverse) const;
+    // 18 features of a region of the MSCN coefficients of a scale, with the
+    // BRISQUE or the NIQE definitions
+    void features(const cv::Mat& coefs, float *f, bool niqe) const;
+    // Mean and covariance of rows of NFEATURES values
+    static void fit(const std::vector<float>& features, cv::Mat& mu, cv::Mat& cov);
+};
+
+#endif
@@ -38,6 +38,9 @@ public:
     PSNR(int height, int width);
     // Compute the PSNR index of the processed image
     float compute(const cv::Mat& original, const cv::Mat& processed);
+    // Compute the PSNR index of a batch of frames, small frames stacked
+    void computeFrames(const std::vector<cv::Mat>& original, const std::vector<cv::Mat>& processed,
+                       std::vector<float>& results) override;
 };
 
 #endif
@@ -61,6 +61,11 @@ public:
     // Compute the PSNR-HVS-M and PSNR-HVS indexes of the processed image
     // Return the PSNR-HVS-M index
     float compute(const cv::Mat& original, const cv::Mat& processed);
+    // Compute both indexes for a batch of frames, results[i] for frame i
+    // Small frames are stacked (see Metric::stack()) and the DCTs of all
+    // their blocks computed by a few large products
+    void computeBatch(const std::vector<cv::Mat>& original, const std::vector<cv::Mat>& processed,
+                      std::vector<float>& results_hvsm, std::vector<float>& results_hvs);
     // Return the PSNR-HVS index only
     // compute() needs to be called before getPSNRHVS()
     float getPSNRHVS();
@@ -72,6 +77,14 @@ private:
     float psnrhvsm;
     static const float CSF[8][8];
     static const float MASK[8][8];
+    cv::Mat dct_matrix;	// 8x8 DCT basis, one row per frequency
+    // DCT of each 8x8 block of an image whose size is a multiple of 8
+    void blockDCT(const cv::Mat& src, cv::Mat& dst);
+    // Add the weighted masked (s1) and unmasked (s2) errors of a block
+    void scoreBlock(const cv::Mat& a, const cv::Mat& b, const cv::Mat& a_dct, const cv::Mat& b_dct,
+                    float weight, float& s1, float& s2);
+    // PSNR-HVS-M and PSNR-HVS of the error sums of a frame of num pixels
+    static void toPSNR(float s1, float s2, float num, float& hvsm, float& hvs);
     float maskeff(const cv::Mat &z, const cv::Mat &zdct);
     float vari(const cv::Mat &z);
 };
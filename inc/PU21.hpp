@@ -0,0 +1,77 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+/**************************************************************************
+
+ PU21 perceptually uniform encoding of HDR luminance.
+
+ PQ (SMPTE ST 2084) or HLG (ITU-R BT.2100) code values are converted to
+ absolute luminance, then encoded with PU21 so that PSNR, SSIM and the
+ other metrics, designed for gamma-encoded SDR values, can be applied to
+ HDR content. PU21 values of SDR luminance levels are close to their 8-bit
+ code values (about 256 at 100 cd/m2), so the metrics keep their 8-bit
+ constants.
+
+ The transfer functions are applied to the luma signal, as the metrics
+ only see luma.
+
+ Please refer to the following paper:
+ - R.K. Mantiuk and M. Azimi, "PU21: A novel perceptually uniform encoding
+   for adapting existing quality metrics for HDR," Picture Coding
+   Symposium (PCS), 2021.
+
+**************************************************************************/
+
+#ifndef PU21_hpp
+#define PU21_hpp
+
+#include <vector>
+
+// Transfer function of the input samples
+enum TransferFunction {
+    TRANSFER_SDR = 0,	// gamma-encoded, no conversion
+    TRANSFER_PQ,
+    TRANSFER_HLG
+};
+
+class PU21 {
+public:
+    // PU21 value of a luminance in cd/m2 (banding + glare variant)
+    static float encode(double luminance);
+    // Luminance in cd/m2 of a PQ signal in [0,1]
+    static double pqToLuminance(double signal);
+    // Luminance in cd/m2 of an HLG signal in [0,1], on a 1000 cd/m2 display
+    static double hlgToLuminance(double signal);
+    // Value of every code of a bitdepth-bit sample, as seen by the metrics
+    // SDR codes are scaled to the 8-bit range, PQ and HLG codes are mapped
+    // to PU21 values. Narrow range codes span 16-235 (scaled to bitdepth),
+    // full range codes span 0 to 2^bitdepth-1.
+    static std::vector<float> lut(int bitdepth, int transfer, bool full_range);
+private:
+    static const double PAR[7];
+    static const double L_MIN;
+    static const double L_MAX;
+};
+
+#endif
@@ -0,0 +1,69 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+/**************************************************************************
+
+ Coordinated reading of the original and processed video streams.
+
+ When both files sit on the same rotating disk (or RAID set), alternating
+ small reads from the two files makes the heads seek back and forth for
+ every row. The scheduler instead fills the frame pool of one stream with a
+ large multi-frame chunk, then the pool of the other one, and serves frames
+ from the pools until both are exhausted. The chunk size is adapted to the
+ measured throughput.
+
+**************************************************************************/
+
+#ifndef ReadScheduler_hpp
+#define ReadScheduler_hpp
+
+#include "VideoYUV.hpp"
+
+class ReadScheduler {
+public:
+    // budget: maximum number of bytes buffered for both streams together
+    ReadScheduler(VideoYUV *original, VideoYUV *processed, int nbframes, size_t budget);
+    // Read nbframes more frames from the current positions of the streams
+    // (e.g. after seekFrame()), keeping the frame pools and the chunk size
+    void restart(int nbframes);
+    // Advance both streams by one frame, refilling the frame pools if needed
+    bool readOneFrame();
+    // Current chunk size, in frames
+    int getChunkSize() const;
+private:
+    VideoYUV *original;
+    VideoYUV *processed;
+    int remaining;		// frames still to be read from the files
+    int chunk;		// current chunk size, in frames
+    int max_chunk;		// largest chunk fitting in the budget
+    int best_chunk;		// chunk size giving the best throughput so far
+    double best_throughput;	// best throughput so far, in bytes/s
+    // Read one chunk from each stream, one after the other
+    bool refill();
+    // Hill climbing on the chunk size: keep doubling it while the throughput
+    // improves, fall back to the best size seen when it drops
+    void adapt(double throughput);
+};
+
+#endif
@@ -0,0 +1,78 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+/**************************************************************************
+
+ Reduced-reference (RR) quality assessment.
+
+ The reference pass extracts a compact signature per frame: for every
+ block, the mean and variance of the local Gaussian statistics (the same
+ 11x11 Gaussian window as SSIM), and the scaled entropy of the band-pass
+ residual of the image, as in RRED. The scoring pass only needs the
+ signatures and the processed stream, and reports:
+ - RRSSIM: SSIM luminance and contrast terms evaluated on the block
+   statistics,
+ - RRED: mean absolute difference of the block scaled entropies (lower is
+   better).
+
+**************************************************************************/
+
+#ifndef ReducedReference_hpp
+#define ReducedReference_hpp
+
+#include <stdio.h>
+#include <vector>
+#include "Metric.hpp"
+
+class ReducedReference : protected Metric {
+public:
+    ReducedReference(int height, int width, int block);
+    // Number of values in the signature of one frame
+    size_t signatureSize() const;
+    // Extract the signature of a reference frame
+    void extract(const cv::Mat& original, std::vector<float>& signature);
+    // Compare a processed frame to the signature of its reference
+    // Return the RRSSIM and RRED indexes as val[0] and val[1]
+    cv::Scalar score(const std::vector<float>& signature, const cv::Mat& processed);
+    // Compute the RRSSIM index with the full reference at hand
+    float compute(const cv::Mat& original, const cv::Mat& processed);
+    // Write the header of a signature file whose first signature is for
+    // frame first, false if it cannot be written
+    bool writeHeader(FILE *file, int first);
+    // Check that a signature file matches this geometry and get the frame
+    // of its first signature
+    bool readHeader(FILE *file, int& first);
+private:
+    int block;
+    int blocks_x;
+    int blocks_y;
+    static const double C1;
+    static const double C2;
+    static const float SIGMA_NSQ;
+    static const char MAGIC[8];
+    // Per-block mean, variance and scaled entropy of an image
+    void blockStatistics(const cv::Mat& img, float *mu, float *sigma_sq, float *entropy);
+};
+
+#endif
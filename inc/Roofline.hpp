@@ -0,0 +1,61 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+/**************************************************************************
+
+ Roofline report of the metric kernels.
+
+ The peak memory bandwidth (STREAM triad) and floating-point throughput
+ (independent multiply-add chains) of the host are measured first, with
+ the same number of threads as OpenCV uses for the kernels. Each kernel is
+ then timed on synthetic frames, and its achieved GB/s and GFLOP/s are
+ derived from a model of its traffic and operations: the number of
+ full-plane passes and of operations per pixel of the current
+ implementation. A kernel whose arithmetic intensity (flop/byte) is below
+ the ridge point of the host is bound by memory (worth fusing passes),
+ above it by compute (worth vectorizing). The derived GB/s and GFLOP/s
+ are therefore estimates, and the compute peak is the one of the vector
+ extension the build targets (SSE2 without -march on x86-64).
+
+**************************************************************************/
+
+#ifndef Roofline_hpp
+#define Roofline_hpp
+
+class Roofline {
+public:
+    Roofline(int height, int width, int nthreads);
+    // Measure the peaks of the host, then each kernel, and print the report
+    void run();
+private:
+    int height;
+    int width;
+    int nthreads;
+    // Peak memory bandwidth, in bytes/s
+    double measureBandwidth() const;
+    // Peak floating-point throughput, in flop/s
+    double measureCompute() const;
+};
+
+#endif
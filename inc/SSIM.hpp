@@ -49,9 +49,16 @@ public:
     SSIM(int height, int width);
     // Compute the SSIM index of the processed image
     float compute(const cv::Mat& original, const cv::Mat& processed);
+    // Compute the SSIM index of a batch of frames, small frames stacked
+    void computeFrames(const std::vector<cv::Mat>& original, const std::vector<cv::Mat>& processed,
+                       std::vector<float>& results) override;
 protected:
     // Compute the SSIM index and mean of the contrast comparison function
     cv::Scalar computeSSIM(const cv::Mat& img1, const cv::Mat& img2);
+    // SSIM and contrast maps, on the 'valid' part of the images (10 rows
+    // and columns less), so that stacked frames do not interfere except on
+    // the last 10 rows of each frame
+    void computeMaps(const cv::Mat& img1, const cv::Mat& img2, cv::Mat& ssim_map, cv::Mat& cs_map);
 private:
     static const double C1;
     static const double C2;
@@ -0,0 +1,74 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+//
+// This is an OpenCV implementation of the reference implementation from
+// Jon Sneyers available from https://github.com/cloudinary/ssimulacra2.
+//
+
+/**************************************************************************
+
+ Calculation of the SSIMULACRA 2 image quality measure.
+
+ The images are converted to linear RGB, then to the XYB colour space at
+ 6 scales (2x2 averaging of linear RGB, as the MS-SSIM pyramid). At each
+ scale, SSIM and edge artifact / detail loss maps are computed from
+ Gaussian-weighted statistics (the recursive Gaussian of libjxl, sigma
+ 1.5) and pooled with L1 and L4 norms; the 108 features are combined into
+ a score, 100 being identical images. Higher is better.
+
+**************************************************************************/
+
+#ifndef SSIMULACRA2_hpp
+#define SSIMULACRA2_hpp
+
+#include <vector>
+#include "Metric.hpp"
+#include "ThreadPool.hpp"
+
+class SSIMULACRA2 : protected Metric {
+public:
+    // The blurs of a scale are computed on the pool when one is given
+    SSIMULACRA2(int height, int width, ThreadPool *pool = nullptr);
+    // Compute the SSIMULACRA 2 score of the processed image
+    // The images are either R'G'B' (CV_32FC3, sRGB transfer function, 0-1,
+    // see VideoYUV::getRGB()) or luma only (CV_32F, 0-255), taken as gray
+    float compute(const cv::Mat& original, const cv::Mat& processed);
+private:
+    static const int NSCALES = 6;
+    static const int LUT_SIZE = 4096;
+    static const double WEIGHT[108];
+    ThreadPool *pool;
+    std::vector<float> to_linear;	// sRGB transfer function, LUT_SIZE steps
+    cv::Mat kernel;	// Gaussian of libjxl, sigma 1.5
+    // Linear RGB (CV_32FC3) of an R'G'B' or luma image
+    void linearize(const cv::Mat& src, cv::Mat& dst) const;
+    // XYB, offset to positive values, of a linear RGB image
+    static void toXYB(const cv::Mat& linear, cv::Mat& xyb);
+    // Gaussian blur of libjxl (recursive Gaussian, applied as its
+    // equivalent FIR), zero outside the image
+    void blur(const cv::Mat& src, cv::Mat& dst) const;
+};
+
+#endif
@@ -0,0 +1,62 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+/**************************************************************************
+
+ Resources available to the process: CPUs and memory, as limited by the
+ affinity mask (cpusets) and the cgroup (v1 or v2) of the process, which
+ is what a container gets rather than the resources of the host.
+
+**************************************************************************/
+
+#ifndef SystemInfo_hpp
+#define SystemInfo_hpp
+
+#include <stdint.h>
+#include <string>
+
+class SystemInfo {
+public:
+    // Read the limits of the current process
+    SystemInfo();
+    // CPUs that can be used: the smallest of the affinity mask and the
+    // CPU quota (rounded up), at least 1
+    int getCpus() const;
+    // Memory that can be used, in bytes: the smallest of the physical
+    // memory and the memory limit
+    int64_t getMemory() const;
+    // Print the detected limits to stdout
+    void print() const;
+private:
+    int host_cpus;		// online CPUs of the host
+    int affinity_cpus;	// CPUs of the affinity mask
+    double quota_cpus;	// CPU quota, 0 if none
+    int64_t host_memory;	// physical memory
+    int64_t limit_memory;	// memory limit, 0 if none
+    // Path of a file of the cgroup of the process for a (v1) controller,
+    // or for the v2 hierarchy if controller is empty
+    static std::string cgroupFile(const std::string& controller, const std::string& file);
+};
+
+#endif
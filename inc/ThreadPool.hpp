@@ -0,0 +1,94 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+/**************************************************************************
+
+ Fixed-size pool of worker threads, and groups of tasks scheduled on it.
+
+ Each worker has its own queue of tasks. Tasks submitted by a worker go to
+ its own queue and are run last in, first out (the data they use is still
+ in its cache); the other tasks are spread over the queues. An idle worker
+ steals the oldest task of another queue.
+
+**************************************************************************/
+
+#ifndef ThreadPool_hpp
+#define ThreadPool_hpp
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    explicit ThreadPool(int nthreads);
+    ~ThreadPool();
+    // Number of worker threads
+    int size() const;
+    // Queue a task, the returned future becomes ready once it has run
+    std::future<void> submit(std::function<void()> task);
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::packaged_task<void()>> tasks;
+    };
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<Queue>> queues;	// one per worker
+    size_t next_queue;	// queue of the next task submitted from outside
+    size_t queued;		// tasks in all the queues
+    std::mutex mutex;	// protects next_queue, queued and stopping
+    std::condition_variable cond;
+    bool stopping;
+    void run(size_t index);
+    // Take a task from the queue of worker index, or steal one
+    bool take(size_t index, std::packaged_task<void()>& task);
+};
+
+// Tasks that are waited for together
+// Without a pool (nullptr), tasks run inline in the calling thread.
+class TaskGroup {
+public:
+    explicit TaskGroup(ThreadPool *pool);
+    ~TaskGroup();
+    // Start a task on the pool
+    void run(std::function<void()> task);
+    // Collect a task too small to be worth its own scheduling
+    // Deferred tasks are started together, as a single task, by flush() or wait()
+    void defer(std::function<void()> task);
+    // Start the deferred tasks
+    void flush();
+    // Wait for all the tasks of the group
+    void wait();
+private:
+    ThreadPool *pool;
+    std::vector<std::future<void>> pending;
+    std::vector<std::function<void()>> deferred;
+};
+
+#endif
@@ -0,0 +1,66 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+/**************************************************************************
+
+ USDT static tracepoints, provider "vqmt".
+
+ Probes are a single nop when no tracer is attached. They are compiled out
+ when sys/sdt.h (systemtap-sdt-dev) is not available at build time.
+
+   read-start     stream, first frame, number of frames
+   read-end       stream, first frame, number of frames read
+   metric-start   first frame, metric (see Metrics), number of frames
+   metric-end     first frame, metric (see Metrics), number of frames
+   result-write   frame, metric (see Metrics)
+
+ Example:
+   bpftrace -e 'usdt:./vqmt:vqmt:metric-start { @t[arg1] = nsecs; }
+                usdt:./vqmt:vqmt:metric-end { @ns[arg1] = hist(nsecs - @t[arg1]); }'
+
+**************************************************************************/
+
+#ifndef Trace_hpp
+#define Trace_hpp
+
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+
+#define TRACE_READ_START(stream, frame, n)	DTRACE_PROBE3(vqmt, read__start, stream, frame, n)
+#define TRACE_READ_END(stream, frame, n)	DTRACE_PROBE3(vqmt, read__end, stream, frame, n)
+#define TRACE_METRIC_START(frame, metric, n)	DTRACE_PROBE3(vqmt, metric__start, frame, metric, n)
+#define TRACE_METRIC_END(frame, metric, n)	DTRACE_PROBE3(vqmt, metric__end, frame, metric, n)
+#define TRACE_RESULT_WRITE(frame, metric)	DTRACE_PROBE2(vqmt, result__write, frame, metric)
+
+#else
+
+#define TRACE_READ_START(stream, frame, n)	do { (void)(stream); (void)(frame); (void)(n); } while (0)
+#define TRACE_READ_END(stream, frame, n)	do { (void)(stream); (void)(frame); (void)(n); } while (0)
+#define TRACE_METRIC_START(frame, metric, n)	do { (void)(frame); (void)(metric); (void)(n); } while (0)
+#define TRACE_METRIC_END(frame, metric, n)	do { (void)(frame); (void)(metric); (void)(n); } while (0)
+#define TRACE_RESULT_WRITE(frame, metric)	do { (void)(frame); (void)(metric); } while (0)
+
+#endif /* HAVE_SYS_SDT_H */
+
+#endif
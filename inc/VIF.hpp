@@ -0,0 +1,110 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+//              Laboratory for Image and Video Engineering (LIVE),
+//              The University of Texas at Austin
+//              http://live.ece.utexas.edu
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without license or royalty fees,
+// to use, copy, modify, and distribute this code (the source files) and its documentation for
+// research purpose only, provided that the copyright notice and the original authors' names in
+// its entirety appear in all copies of this code, and the original source of this code is 
+// acknowledged in any publication that reports research using this code.
+// The research is to be cited in the bibliography as:
+//
+// H.R. Sheikh and A.C. Bovik, "Image information and visual quality," IEEE Transactions on
+// Image Processing, vol. 15, no. 2, pp. 430-444, February 2006.
+//
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL) be liable to any party
+// for direct, indirect, special, incidental, or consequential damages arising out of the use of
+// the software and its documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole Polytechnique Fédérale de
+// Lausanne (EPFL) has no obligation to provide maintenance, support, updates, enhancements, or
+// modifications.
+//
+// In no event shall the University of Texas at Austin be liable to any party for direct, 
+// indirect, special, incidental, or consequential damages arising out of the use of this 
+// database and its documentation, even if the University of Texas at austin has been advised
+// of the possibility of such damage.
+// The University of Texas at Austin specifically disclaims any warranties, including, but not
+// limited to, the implied warranties of merchantability and fitness for a particular purpose.
+// the database provided hereunder is on an "as is" basis, and the University of Texas at Austin
+// has no obligation to provide maintenance, support, updates, enhancements, or modifications.
+
+//
+// This is an OpenCV implementation of the original Matlab implementation of the wavelet-domain
+// Visual Information Fidelity (VIF, vifvec) from H.R. Sheikh available from
+// http://live.ece.utexas.edu/research/quality/.
+// Please refer to the following paper:
+// - H.R. Sheikh and A.C. Bovik, "Image information and visual quality," IEEE Transactions on
+//   Image Processing, vol. 15, no. 2, pp. 430-444, February 2006.
+//
+
+/**************************************************************************
+
+ Calculation of the Visual Information Fidelity (VIF) image quality
+ measure, wavelet domain version.
+
+ As vifvec, the images are decomposed by a 4-level, 6-orientation steerable
+ pyramid, and the subbands of orientations 0 and 90 degrees of each level
+ are modelled as Gaussian scale mixtures (GSM) on 3x3 blocks: covariance of
+ all the overlapping blocks of the reference, multiplier field on the
+ non-overlapping ones, eigenvalues of the covariance, distortion channel
+ estimated on the windows of vifsub_est_M (3 to 17 samples, reflected at
+ the edges), and sigma_nsq = 0.4.
+
+ vifvec builds the pyramid in the spatial domain with the sp5 filters of
+ matlabPyrTools (buildSpyr). Here, the pyramid is the Fourier-domain one of
+ the same tools (buildSFpyr, order 5, hence 6 orientations), built from a
+ single DFT of the image: its subbands have the same sizes, orientations
+ and octave bands, but not the same taps. The scores have not been checked
+ against vifvec, they are expected to be close but not identical.
+
+ The frames have to be at least 65x65, so that the blocks of the coarsest
+ subbands are not all on the border.
+
+**************************************************************************/
+
+#ifndef VIF_hpp
+#define VIF_hpp
+
+#include "Metric.hpp"
+#include "ThreadPool.hpp"
+
+class VIF : protected Metric {
+public:
+    // The pyramids and the subbands are computed on the pool when one is
+    // given
+    VIF(int height, int width, ThreadPool *pool = nullptr);
+    // Compute the VIF index of the processed image
+    float compute(const cv::Mat& original, const cv::Mat& processed);
+    // Smallest height and width
+    static const int MIN_SIZE = 65;
+private:
+    ThreadPool *pool;
+    static const int NLEVELS = 4;
+    static const int NBANDS = 2;	// orientations used: 0 and 90 degrees
+    static const int M = 3;		// GSM block size
+    static const double SIGMA_NSQ;
+    // Frequency masks for frames of masks_size: per level, the oriented
+    // bandpass masks (angular times high-pass), and the low-pass mask to the
+    // next level, in the layout of cv::dft of the level
+    cv::Size masks_size;
+    cv::Mat band_masks[NLEVELS][NBANDS];
+    cv::Mat low_masks[NLEVELS];
+    // Set up the masks for frames of size
+    void computeMasks(cv::Size size);
+    // Subbands of the image, level 0 being the finest
+    void computeSubbands(const cv::Mat& img, cv::Mat bands[NLEVELS][NBANDS]);
+    // Compute the numerator and denominator of the VIF index in a subband
+    // lev: level as counted by vifvec (1 for the coarsest), which sets the
+    // window of the distortion channel
+    void computeSubband(const cv::Mat& ref, const cv::Mat& dist, int lev, double& num, double& den);
+};
+
+#endif
@@ -55,15 +55,26 @@
 #ifndef VIFP_hpp
 #define VIFP_hpp
 
+#include <vector>
 #include "Metric.hpp"
+#include "ThreadPool.hpp"
 
 class VIFP : protected Metric {
 public:
-    VIFP(int height, int width);
+    // Subbands are computed on the pool when one is given
+    VIFP(int height, int width, ThreadPool *pool = nullptr);
     // Compute the VIFp index of the processed image
     float compute(const cv::Mat& original, const cv::Mat& processed);
+    // Compute the VIFp indexes of a batch of consecutive frames
+    // The coefficients of a subband are computed as a task while the next
+    // subband is built; the subbands smaller than SMALL_LEVEL of all the
+    // frames are grouped into one task
+    void computeBatch(const std::vector<cv::Mat>& original, const std::vector<cv::Mat>& processed,
+                      std::vector<float>& vifp);
 private:
+    ThreadPool *pool;
     static const int NLEVS = 4;
+    static const int SMALL_LEVEL = 256*256;
     static const float SIGMA_NSQ;
     // Compute the coefficients of the VIFp index at a particular subband
     void computeVIFP(const cv::Mat& ref, const cv::Mat& dist, int N, double& num, double& den);
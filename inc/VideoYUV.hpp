@@ -28,8 +28,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <fcntl.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
 #include <opencv2/core/core.hpp>
 
+#include "FramePool.hpp"
+#include "IOBackend.hpp"
+#include "PU21.hpp"
+
 // _WIN32 is also defined in WIN64 environment (why on earth? => backward
 // compatibility the argue). Added this note to remember that this actually
 // includes 64-bit versions of Windows
@@ -61,15 +68,82 @@ enum ChromaSubsampling {
 
 class VideoYUV {
 public:
-    VideoYUV(const char *file, int height, int width, int nbframes, int chroma_format);
+    // bitdepth: 8, or up to 16 for samples stored on two bytes (little endian)
+    VideoYUV(const char *file, int height, int width, int nbframes, int chroma_format, int bitdepth = 8);
+    // Read the segments one after the other as a single logical stream
+    VideoYUV(const std::vector<std::string>& files, int height, int width, int nbframes, int chroma_format, int bitdepth = 8);
     ~VideoYUV();
+    // Read other segments from now on, with the same geometry, keeping the
+    // frame pool (e.g. one file after the other in watch mode)
+    // Return false, the error being reported, if a segment cannot be opened
+    bool open(const std::vector<std::string>& files);
+    // Expand an input path to a list of segments
+    // '@list.txt' is a file listing one segment per line, a path with
+    // wildcards is expanded as a glob (sorted), anything else is a single file
+    static std::vector<std::string> expandPath(const std::string& path);
+    // Number of frames in the logical stream, or -1 if unknown (pipes)
+    int getTotalFrames() const;
+    // Position the stream so that the next readOneFrame() returns frame
+    // Any buffered frame is discarded
+    bool seekFrame(int frame);
     // Read one frame
+    // Frames are served from the frame pool, which is refilled with a single
+    // frame when exhausted (see fillChunk() for larger reads)
     bool readOneFrame();
+    // Read one frame and convert its luma into a free frame of the pool
+    // (see getLuma(FramePool&))
+    // Return a null reference on failure
+    FrameRef readFrame(FramePool& frames);
+    // Convert the luma of the frame read last into a free frame of the
+    // pool, to the type of the pool: the frame is filled in place straight
+    // from the read buffer, to be shared by reference from then on
+    // Return a null reference if no frame of the pool gets free
+    FrameRef getLuma(FramePool& frames);
+    // Same for the colour components (see getRGB()), the pool being CV_32FC3
+    FrameRef getRGB(FramePool& frames);
     // Get the luma component
     // readOneFrame() needs to be called before getLuma()
+    // Samples of more than 8 bits, or with a transfer function (see
+    // setTransfer()), are mapped through a lookup table while converted to
+    // CV_32F.
     void getLuma(cv::Mat& luma, int type = CV_8UC1);
+    // Get the colour components as R'G'B' (CV_32FC3, 0-1)
+    // readOneFrame() needs to be called before getRGB()
+    // The chroma planes are upsampled to the luma resolution (nearest
+    // sample), and converted with the BT.709 matrix (BT.601 below 720 lines)
+    void getRGB(cv::Mat& rgb);
+    // Map the luma samples of HDR content (TransferFunction) to PU21 values
+    void setTransfer(int transfer, bool full_range);
+    // Resize the frame pool to hold up to nframes frames
+    // Any buffered frame is discarded
+    void setPoolSize(int nframes);
+    // Read up to nframes consecutive frames into the frame pool with one large read
+    // The pool has to be exhausted before calling fillChunk()
+    // Return the number of complete frames read
+    int fillChunk(int nframes);
+    // Number of frames read ahead and not yet consumed by readOneFrame()
+    int bufferedFrames() const;
+    // Size of one frame in the file, in bytes
+    size_t frameBytes() const;
+    int getHeight() const;
+    int getWidth() const;
 private:
-    int file;		// file stream
+    struct Segment {
+        std::string path;
+        int64_t start;	// offset of the segment in the logical stream
+        int64_t bytes;	// size of the segment
+    };
+    std::vector<Segment> segments;
+    bool seekable;		// false for pipes
+    int segment;		// segment being read
+    IOBackend *file;	// backend reading the segment being read
+    int segment_ahead;	// segment opened ahead, or -1
+    IOBackend *next_file;	// backend reading the segment opened ahead, or null
+    // Switch to segment index, and open the following one ahead of time
+    void openSegment(int index);
+    // Open a segment with the selected backend (read() for pipes), or null
+    IOBackend *openFile(int index);
+
     int nbframes;		// number of frames
     int height;		// height
     int width;		// width
@@ -77,9 +151,19 @@ private:
     int comp_width[3];	// width in specific component
 
     int size;		// number of samples
+    int bitdepth;		// bits per sample
+    int sample_bytes;	// bytes per sample in the file
+    std::vector<float> lut;	// value of each luma code, empty for plain 8-bit
+    bool full_range;	// samples use the full range of codes
     int comp_size[3];	// number of samples in specific component
 
-    imgpel *data;		// data array
+    imgpel *pool;		// frame pool (pool_frames consecutive frames)
+    int pool_frames;	// capacity of the frame pool
+    int pool_count;	// number of frames in the pool
+    int pool_pos;		// next frame to serve from the pool
+    int next_read;		// index of the next frame read from the files
+
+    imgpel *data;		// current frame
     imgpel *luma;		// pointer to luma
     imgpel *chroma[2];	// pointers to chroma
 };
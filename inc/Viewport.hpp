@@ -0,0 +1,57 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+/**************************************************************************
+
+ Rectilinear viewport of an equirectangular (ERP) frame.
+
+ The position in the ERP frame of every viewport pixel is computed once,
+ and stored as fixed-point gather maps, so that rendering a viewport is a
+ single vectorized bilinear remap.
+
+**************************************************************************/
+
+#ifndef Viewport_hpp
+#define Viewport_hpp
+
+#include <opencv2/core/core.hpp>
+
+class Viewport {
+public:
+    // yaw (positive to the right), pitch (positive up) and horizontal field
+    // of view in degrees; the vertical field of view follows from the
+    // aspect ratio of the viewport
+    Viewport(int erp_height, int erp_width, double yaw, double pitch, double fov, int height, int width);
+    // Render the viewport of an ERP luma frame
+    void render(const cv::Mat& erp, cv::Mat& view) const;
+    int getHeight() const;
+    int getWidth() const;
+private:
+    int height;
+    int width;
+    cv::Mat map_xy;		// integer positions (CV_16SC2)
+    cv::Mat map_frac;	// interpolation weights (CV_16UC1)
+};
+
+#endif
@@ -0,0 +1,81 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+/**************************************************************************
+
+ Watch-folder mode: the files completed in a directory (closed after
+ writing, or moved into it) are handed to a resident process one after the
+ other, so that the metrics are set up once for all the files. Linux only
+ (inotify), left out of builds without sys/inotify.h.
+
+ When the kernel queue of events overflows (many files completed while one
+ is scored), the directory is scanned again: the files whose size or
+ modification time differ from when they were last handled (or seen at
+ startup) are handed over, and the events still queued for them are
+ dropped.
+
+**************************************************************************/
+
+#ifndef Watch_hpp
+#define Watch_hpp
+
+#include <stdint.h>
+#include <functional>
+#include <map>
+#include <string>
+
+class Watch {
+public:
+    // Watch dir for files whose name ends with ext
+    Watch(const std::string& dir, const std::string& ext);
+    ~Watch();
+    // Call handler with the path of each completed file, until SIGINT or
+    // SIGTERM (the file being handled is finished first)
+    int run(const std::function<void(const std::string&)>& handler);
+    // Path of the reference of a file: in pattern, '{name}' is replaced by
+    // the file name without extension and '{prefix}' by the file name up
+    // to its first '_' (e.g. 'refs/{prefix}.yuv' for 'clip_crf23.yuv' is
+    // 'refs/clip.yuv')
+    static std::string reference(const std::string& pattern, const std::string& path);
+private:
+    std::string dir;
+    std::string ext;
+    int fd;		// inotify instance
+    // Size and modification time of a file
+    struct Stamp {
+        int64_t bytes;
+        int64_t sec;
+        int64_t nsec;
+    };
+    std::map<std::string, Stamp> seen;	// files handled or present at startup
+    // Whether name has the extension
+    bool matches(const std::string& name) const;
+    // Record the stamp of a file, return false if unchanged since last seen
+    bool update(const std::string& name);
+    // Record the stamps of the files of the directory, handing the new or
+    // changed ones to handler if given
+    void scan(const std::function<void(const std::string&)> *handler);
+};
+
+#endif
@@ -0,0 +1,148 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+#include <algorithm>
+#include <math.h>
+#include <random>
+
+#include "AdaptiveSampler.hpp"
+
+// Strata, and smallest number of frames chosen in each one, so that the
+// variance within every stratum can be estimated
+static const int MAX_STRATA = 10;
+static const int MIN_SAMPLES = 2;
+
+AdaptiveSampler::AdaptiveSampler(double f)
+{
+    fraction = f;
+}
+
+std::vector<int> AdaptiveSampler::select(const std::vector<float>& cheap)
+{
+    int nbframes = static_cast<int>(cheap.size());
+    int budget = static_cast<int>(fraction*nbframes + 0.5);
+    budget = std::max(MIN_SAMPLES, std::min(budget, nbframes));
+    int nstrata = std::max(1, std::min(MAX_STRATA, budget / (2*MIN_SAMPLES)));
+
+    // Frames by increasing cheap metric: stratum 0 holds the worst ones
+    std::vector<int> order(static_cast<size_t>(nbframes));
+    for (int i=0; i<nbframes; i++)
+        order[static_cast<size_t>(i)] = i;
+    std::stable_sort(order.begin(), order.end(), [&cheap](int a, int b) {
+        return cheap[static_cast<size_t>(a)] < cheap[static_cast<size_t>(b)];
+    });
+
+    sizes.assign(static_cast<size_t>(nstrata), 0);
+    samples.assign(static_cast<size_t>(nstrata), 0);
+    std::vector<double> weight(static_cast<size_t>(nstrata));
+    for (int h=0; h<nstrata; h++) {
+        int first = h*nbframes/nstrata;
+        int last = (h+1)*nbframes/nstrata;
+        size_t hh = static_cast<size_t>(h);
+        sizes[hh] = last-first;
+
+        double sum = 0.0, sum2 = 0.0;
+        for (int i=first; i<last; i++) {
+            double v = static_cast<double>(cheap[static_cast<size_t>(order[static_cast<size_t>(i)])]);
+            sum += v;
+            sum2 += v*v;
+        }
+        double mean = sum / sizes[hh];
+        double sd = sqrt(std::max(0.0, sum2/sizes[hh] - mean*mean));
+
+        // Neyman allocation, low quality weighted up (x2 for the worst
+        // stratum, x1 for the best); flat strata still get their minimum
+        double boost = nstrata > 1 ? 2.0 - static_cast<double>(h)/(nstrata-1) : 1.0;
+        weight[hh] = sizes[hh] * (sd + 1e-6) * boost;
+        samples[hh] = std::min(MIN_SAMPLES, sizes[hh]);
+        budget -= samples[hh];
+    }
+
+    // Greedy proportional allocation of the rest of the budget
+    for (; budget > 0; budget--) {
+        int best = -1;
+        for (int h=0; h<nstrata; h++) {
+            size_t hh = static_cast<size_t>(h);
+            if (samples[hh] >= sizes[hh])
+                continue;
+            if (best < 0 || weight[hh]/samples[hh] > weight[static_cast<size_t>(best)]/samples[static_cast<size_t>(best)])
+                best = h;
+        }
+        if (best < 0)
+            break;
+        samples[static_cast<size_t>(best)]++;
+    }
+
+    // Random frames within each stratum, reproducible from run to run
+    std::mt19937 rng(0x5eed);
+    std::vector<std::pair<int,int>> picked;
+    for (int h=0; h<nstrata; h++) {
+        size_t hh = static_cast<size_t>(h);
+        std::vector<int> members(order.begin()+h*nbframes/nstrata, order.begin()+(h+1)*nbframes/nstrata);
+        std::shuffle(members.begin(), members.end(), rng);
+        for (int i=0; i<samples[hh]; i++)
+            picked.push_back(std::make_pair(members[static_cast<size_t>(i)], h));
+    }
+    std::sort(picked.begin(), picked.end());
+
+    chosen.clear();
+    stratum.clear();
+    for (auto& p : picked) {
+        chosen.push_back(p.first);
+        stratum.push_back(p.second);
+    }
+    return chosen;
+}
+
+void AdaptiveSampler::estimate(const std::vector<float>& values, double& mean, double& ci95) const
+{
+    size_t nstrata = sizes.size();
+    std::vector<double> sum(nstrata, 0.0), sum2(nstrata, 0.0);
+    for (size_t i=0; i<values.size(); i++) {
+        size_t h = static_cast<size_t>(stratum[i]);
+        sum[h] += static_cast<double>(values[i]);
+        sum2[h] += static_cast<double>(values[i])*static_cast<double>(values[i]);
+    }
+
+    double total = 0.0;
+    for (size_t h=0; h<nstrata; h++)
+        total += sizes[h];
+
+    // Stratified mean, and its variance with the finite population correction
+    mean = 0.0;
+    double variance = 0.0;
+    for (size_t h=0; h<nstrata; h++) {
+        double n = samples[h];
+        if (n < 1)
+            continue;
+        double w = sizes[h] / total;
+        double m = sum[h] / n;
+        mean += w*m;
+        if (n > 1) {
+            double s2 = std::max(0.0, (sum2[h] - n*m*m) / (n-1));
+            variance += w*w * (1.0 - n/sizes[h]) * s2 / n;
+        }
+    }
+    ci95 = 1.96*sqrt(variance);
+}
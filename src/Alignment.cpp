@@ -0,0 +1,183 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "Alignment.hpp"
+
+// Thumbnails are downsampled by this factor for the phase correlation
+static const int THUMBNAIL_FACTOR = 4;
+
+Alignment::Alignment(int shift, bool sub)
+{
+    max_shift = shift;
+    subpixel = sub;
+    ix = iy = 0;
+    fx = fy = 0.0;
+}
+
+void Alignment::addFrames(const cv::Mat& original, const cv::Mat& processed)
+{
+    originals.push_back(original.clone());
+    processeds.push_back(processed.clone());
+}
+
+double Alignment::ssd(int dx, int dy) const
+{
+    double sum = 0.0;
+    double count = 0.0;
+    for (size_t i=0; i<originals.size(); i++) {
+        const cv::Mat& o = originals[i];
+        const cv::Mat& p = processeds[i];
+        // Overlap, in original coordinates
+        int x0 = std::max(0, dx), x1 = std::min(o.cols, p.cols+dx);
+        int y0 = std::max(0, dy), y1 = std::min(o.rows, p.rows+dy);
+        if (x1-x0 < 8 || y1-y0 < 8)
+            return DBL_MAX;
+        cv::Rect ro(x0, y0, x1-x0, y1-y0);
+        cv::Rect rp(x0-dx, y0-dy, x1-x0, y1-y0);
+        double n = cv::norm(o(ro), p(rp), cv::NORM_L2);
+        sum += n*n;
+        count += static_cast<double>(ro.area());
+    }
+    return sum / count;
+}
+
+bool Alignment::estimate()
+{
+    if (originals.empty())
+        return false;
+
+    // Coarse offset: phase correlation of thumbnails (top-left aligned,
+    // cropped to the same size), median over the frames
+    int factor = std::min(originals[0].rows, originals[0].cols) >= 64*THUMBNAIL_FACTOR ? THUMBNAIL_FACTOR : 1;
+    std::vector<double> sx, sy;
+    for (size_t i=0; i<originals.size(); i++) {
+        cv::Mat to, tp, window;
+        cv::resize(originals[i], to, cv::Size(originals[i].cols/factor, originals[i].rows/factor), 0, 0, cv::INTER_AREA);
+        cv::resize(processeds[i], tp, cv::Size(processeds[i].cols/factor, processeds[i].rows/factor), 0, 0, cv::INTER_AREA);
+        cv::Rect common(0, 0, std::min(to.cols, tp.cols), std::min(to.rows, tp.rows));
+        cv::createHanningWindow(window, common.size(), CV_32F);
+        cv::Point2d shift = cv::phaseCorrelate(tp(common), to(common), window);
+        sx.push_back(shift.x*factor);
+        sy.push_back(shift.y*factor);
+    }
+    std::nth_element(sx.begin(), sx.begin()+static_cast<long>(sx.size()/2), sx.end());
+    std::nth_element(sy.begin(), sy.begin()+static_cast<long>(sy.size()/2), sy.end());
+    int cx = static_cast<int>(lround(sx[sx.size()/2]));
+    int cy = static_cast<int>(lround(sy[sy.size()/2]));
+
+    // Refinement: SSD search around the coarse offset, at full resolution
+    double best = DBL_MAX;
+    int radius = factor+1;
+    for (int dy=cy-radius; dy<=cy+radius; dy++) {
+        for (int dx=cx-radius; dx<=cx+radius; dx++) {
+            if (abs(dx) > max_shift || abs(dy) > max_shift)
+                continue;
+            double e = ssd(dx, dy);
+            if (e < best) {
+                best = e;
+                ix = dx;
+                iy = dy;
+            }
+        }
+    }
+    if (best == DBL_MAX) {
+        fprintf(stderr, "Alignment: no offset found within %d pixels.\n", max_shift);
+        return false;
+    }
+
+    // Subpixel: vertex of the parabola through the SSD around the minimum
+    fx = fy = 0.0;
+    if (subpixel) {
+        double l = ssd(ix-1, iy), r = ssd(ix+1, iy);
+        double t = ssd(ix, iy-1), b = ssd(ix, iy+1);
+        if (l < DBL_MAX && r < DBL_MAX && l+r-2*best > 0.0)
+            fx = std::max(-0.5, std::min(0.5, (l-r) / (2*(l+r-2*best))));
+        if (t < DBL_MAX && b < DBL_MAX && t+b-2*best > 0.0)
+            fy = std::max(-0.5, std::min(0.5, (t-b) / (2*(t+b-2*best))));
+    }
+
+    // Overlap, one pixel smaller on each side when resampling
+    const cv::Mat& o = originals[0];
+    const cv::Mat& p = processeds[0];
+    int margin = subpixel ? 1 : 0;
+    int x0 = std::max(0, ix) + margin, x1 = std::min(o.cols, p.cols+ix) - margin;
+    int y0 = std::max(0, iy) + margin, y1 = std::min(o.rows, p.rows+iy) - margin;
+    int w = x1-x0;
+    int h = y1-y0;
+    if (w <= 0 || h <= 0) {
+        fprintf(stderr, "Alignment: the frames do not overlap enough.\n");
+        return false;
+    }
+    original_region = cv::Rect(x0, y0, w, h);
+    processed_region = cv::Rect(x0-ix, y0-iy, w, h);
+
+    originals.clear();
+    processeds.clear();
+    return true;
+}
+
+double Alignment::getOffsetX() const
+{
+    return ix+fx;
+}
+
+double Alignment::getOffsetY() const
+{
+    return iy+fy;
+}
+
+int Alignment::getHeight() const
+{
+    return original_region.height;
+}
+
+int Alignment::getWidth() const
+{
+    return original_region.width;
+}
+
+void Alignment::apply(const cv::Mat& original, const cv::Mat& processed, cv::Mat& original_roi, cv::Mat& processed_roi)
+{
+    original_roi = original(original_region);
+    if (fx == 0.0 && fy == 0.0) {
+        processed_roi = processed(processed_region);
+        return;
+    }
+
+    // processed(y-fy, x-fx), so that the fractional offset is compensated
+    cv::Mat translation = cv::Mat::eye(2, 3, CV_64F);
+    translation.at<double>(0,2) = -fx;
+    translation.at<double>(1,2) = -fy;
+    // A new frame each time, as the ROIs of a batch are used together
+    cv::Mat shifted;
+    cv::warpAffine(processed, shifted, translation, processed.size(), cv::INTER_LINEAR | cv::WARP_INVERSE_MAP,
+                   cv::BORDER_REPLICATE);
+    processed_roi = shifted(processed_region);
+}
@@ -0,0 +1,138 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+#include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <opencv2/imgproc/imgproc.hpp>
+#include "Analysis.hpp"
+
+const char Analysis::MAGIC[8] = {'V', 'Q', 'M', 'T', 'A', 'N', '0', '1'};
+
+// Scene cut: mean absolute difference above CUT_FACTOR times the average of
+// the scene, and above CUT_MIN (on 0-255 values)
+#define CUT_FACTOR 3.0
+#define CUT_MIN 8.0
+
+Analysis::Analysis(int h, int w, int b)
+{
+    if (b < 1 || h < 3 || w < 3) {
+        fprintf(stderr, "Analysis: the frame has to be at least 3x3 and the block size positive.\n");
+        exit(EXIT_FAILURE);
+    }
+    height = h;
+    width = w;
+    block = b;
+    blocks_x = (w + block-1) / block;
+    blocks_y = (h + block-1) / block;
+    scene_mad = 0.0;
+    scene_frames = 0;
+    scene = -1;
+}
+
+size_t Analysis::gridSize() const
+{
+    return static_cast<size_t>(blocks_x*blocks_y);
+}
+
+void Analysis::analyze(const FrameRef& frame_ref, std::vector<float>& stats,
+                       std::vector<uint16_t>& variance, std::vector<uint16_t>& activity)
+{
+    const cv::Mat& frame = frame_ref->image;
+
+    // Sobel gradient magnitude, SI on the pixels with a full 3x3 window
+    cv::Mat dx, dy, mag;
+    cv::Sobel(frame, dx, CV_32F, 1, 0);
+    cv::Sobel(frame, dy, CV_32F, 0, 1);
+    cv::magnitude(dx, dy, mag);
+    cv::Scalar mean, stddev;
+    cv::meanStdDev(mag(cv::Rect(1, 1, width-2, height-2)), mean, stddev);
+    double si = stddev.val[0];
+
+    // Block sums from integral images, each pixel is visited once
+    cv::Mat sum, sqsum, magsum;
+    cv::integral(frame, sum, sqsum, CV_64F, CV_64F);
+    cv::integral(mag, magsum, CV_64F);
+    variance.resize(gridSize());
+    activity.resize(gridSize());
+    for (int by=0; by<blocks_y; by++) {
+        int y0 = by*block;
+        int y1 = std::min(y0+block, height);
+        for (int bx=0; bx<blocks_x; bx++) {
+            int x0 = bx*block;
+            int x1 = std::min(x0+block, width);
+            double n = static_cast<double>((y1-y0)*(x1-x0));
+            double s = sum.at<double>(y1, x1) - sum.at<double>(y0, x1) - sum.at<double>(y1, x0) + sum.at<double>(y0, x0);
+            double sq = sqsum.at<double>(y1, x1) - sqsum.at<double>(y0, x1) - sqsum.at<double>(y1, x0) + sqsum.at<double>(y0, x0);
+            double m = magsum.at<double>(y1, x1) - magsum.at<double>(y0, x1) - magsum.at<double>(y1, x0) + magsum.at<double>(y0, x0);
+            size_t i = static_cast<size_t>(by*blocks_x + bx);
+            variance[i] = cv::saturate_cast<uint16_t>(4.0 * std::max(sq/n - (s/n)*(s/n), 0.0));
+            activity[i] = cv::saturate_cast<uint16_t>(16.0 * m/n);
+        }
+    }
+
+    double pixels = static_cast<double>(height*width);
+    double frame_mean = sum.at<double>(height, width) / pixels;
+    double frame_var = std::max(sqsum.at<double>(height, width) / pixels - frame_mean*frame_mean, 0.0);
+
+    // Temporal information, and scene cut detection on the mean absolute
+    // difference
+    double ti = 0.0;
+    bool cut = !previous;
+    if (previous) {
+        cv::Mat diff;
+        cv::subtract(frame, previous->image, diff);
+        cv::meanStdDev(diff, mean, stddev);
+        ti = stddev.val[0];
+        double mad = cv::norm(diff, cv::NORM_L1) / pixels;
+        // The first difference inside a scene seeds its average, so that a
+        // panning or high-motion scene is not cut again on every frame
+        cut = scene_frames > 0 && mad > CUT_MIN && mad > CUT_FACTOR * scene_mad / scene_frames;
+        if (!cut) {
+            scene_mad += mad;
+            scene_frames++;
+        }
+    }
+    if (cut) {
+        scene++;
+        scene_mad = 0.0;
+        scene_frames = 0;
+    }
+    previous = frame_ref;
+
+    stats.resize(FRAME_VALUES);
+    stats[0] = static_cast<float>(frame_mean);
+    stats[1] = static_cast<float>(frame_var);
+    stats[2] = static_cast<float>(si);
+    stats[3] = static_cast<float>(ti);
+    stats[4] = cut ? 1.0f : 0.0f;
+    stats[5] = static_cast<float>(scene);
+}
+
+bool Analysis::writeHeader(FILE *file, int first)
+{
+    int geometry[6] = {height, width, block, first, blocks_x, blocks_y};
+    return fwrite(MAGIC, 1, sizeof(MAGIC), file) == sizeof(MAGIC)
+        && fwrite(geometry, sizeof(int), 6, file) == 6;
+}
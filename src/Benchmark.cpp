@@ -0,0 +1,62 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "Benchmark.hpp"
+
+void Benchmark::syntheticFrames(int height, int width, cv::Mat& original, cv::Mat& processed)
+{
+    cv::RNG rng(0x5eed);
+    cv::Mat noise(height, width, CV_32F);
+
+    // Texture at several scales
+    rng.fill(noise, cv::RNG::UNIFORM, cv::Scalar(0.0), cv::Scalar(255.0));
+    cv::GaussianBlur(noise, original, cv::Size(0,0), 2.0);
+    cv::normalize(original, original, 16.0, 235.0, cv::NORM_MINMAX);
+
+    // Coding-like degradation: loss of detail and noise
+    cv::GaussianBlur(original, processed, cv::Size(3,3), 0.8);
+    rng.fill(noise, cv::RNG::NORMAL, cv::Scalar(0.0), cv::Scalar(3.0));
+    processed += noise;
+    cv::max(processed, 0.0, processed);
+    cv::min(processed, 255.0, processed);
+}
+
+double Benchmark::time(const std::function<void()>& fn, double min_time, int min_runs)
+{
+    // Warm up: caches, lazily allocated buffers
+    fn();
+
+    double start = static_cast<double>(cv::getTickCount());
+    double elapsed = 0.0;
+    int runs = 0;
+    while (runs < min_runs || elapsed < min_time) {
+        fn();
+        runs++;
+        elapsed = (static_cast<double>(cv::getTickCount()) - start) / cv::getTickFrequency();
+    }
+
+    return elapsed / runs;
+}
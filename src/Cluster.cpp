@@ -0,0 +1,517 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+// Sockets and poll() are POSIX, the cluster mode is left out on Windows
+#ifndef _WIN32
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <sstream>
+
+#include "Cluster.hpp"
+#include "MetricEngine.hpp"
+#include "ReadScheduler.hpp"
+#include "Trace.hpp"
+#include "VideoYUV.hpp"
+
+LineChannel::LineChannel(int f)
+{
+    fd = f;
+}
+
+int LineChannel::descriptor() const
+{
+    return fd;
+}
+
+bool LineChannel::receive()
+{
+    char data[4096];
+    ssize_t ret = recv(fd, data, sizeof(data), 0);
+    if (ret <= 0)
+        return false;
+    buffer.append(data, static_cast<size_t>(ret));
+    return true;
+}
+
+bool LineChannel::nextLine(std::string& line)
+{
+    size_t pos = buffer.find('\n');
+    if (pos == std::string::npos)
+        return false;
+    line = buffer.substr(0, pos);
+    buffer.erase(0, pos+1);
+    return true;
+}
+
+bool LineChannel::readLine(std::string& line)
+{
+    while (!nextLine(line)) {
+        if (!receive())
+            return false;
+    }
+    return true;
+}
+
+bool LineChannel::writeLine(const std::string& line)
+{
+    std::string msg = line + "\n";
+    size_t sent = 0;
+    while (sent < msg.size()) {
+        ssize_t ret = send(fd, msg.data()+sent, msg.size()-sent, MSG_NOSIGNAL);
+        if (ret <= 0)
+            return false;
+        sent += static_cast<size_t>(ret);
+    }
+    return true;
+}
+
+void LineChannel::close()
+{
+    if (fd >= 0)
+        ::close(fd);
+    fd = -1;
+}
+
+Coordinator::Coordinator(const ClusterJob& j, const std::string& b, int p, int range, int t)
+{
+    job = j;
+    bind_address = b;
+    port = p;
+    timeout = t < 1 ? 1 : t;
+    if (range < 1)
+        range = 1;
+    for (int first=job.start; first<job.start+job.nbframes; first+=range) {
+        int end = first+range < job.start+job.nbframes ? first+range : job.start+job.nbframes;
+        ranges.push_back(std::make_pair(first, end));
+    }
+    results.assign(static_cast<size_t>(job.nbframes)*job.metrics.size(), 0.0f);
+    scored.assign(static_cast<size_t>(job.nbframes), false);
+    sums.assign(job.metrics.size(), 0.0);
+    nscored = 0;
+}
+
+int Coordinator::run(const std::string& results_path)
+{
+    // Listen on the given interface only, all of them by default
+    struct addrinfo hints, *info;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    std::string service = std::to_string(port);
+    if (getaddrinfo(bind_address.empty() ? nullptr : bind_address.c_str(), service.c_str(), &hints, &info) != 0) {
+        fprintf(stderr, "Coordinator: cannot resolve %s\n", bind_address.c_str());
+        return EXIT_FAILURE;
+    }
+    int server = -1;
+    for (struct addrinfo *ai=info; ai != nullptr && server < 0; ai=ai->ai_next) {
+        server = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (server < 0)
+            continue;
+        int yes = 1;
+        setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+        if (bind(server, ai->ai_addr, ai->ai_addrlen) != 0 || listen(server, 64) != 0) {
+            close(server);
+            server = -1;
+        }
+    }
+    freeaddrinfo(info);
+    if (server < 0) {
+        fprintf(stderr, "Coordinator: cannot listen on %s:%d.\n",
+                bind_address.empty() ? "*" : bind_address.c_str(), port);
+        return EXIT_FAILURE;
+    }
+    printf("Coordinator: %d frames in %zu ranges, waiting for workers on port %d.\n",
+           job.nbframes, ranges.size(), port);
+
+    // Since when no worker has been connected
+    std::chrono::steady_clock::time_point alone = std::chrono::steady_clock::now();
+    while (nscored < job.nbframes) {
+        std::vector<struct pollfd> fds(connections.size()+1);
+        fds[0].fd = server;
+        fds[0].events = POLLIN;
+        for (size_t i=0; i<connections.size(); i++) {
+            fds[i+1].fd = connections[i].channel.descriptor();
+            fds[i+1].events = POLLIN;
+        }
+        // Wake up every second to check the deadlines
+        if (poll(&fds[0], fds.size(), 1000) < 0)
+            continue;
+
+        // Connections are added after the existing ones have been served,
+        // so that indices in fds stay valid
+        for (size_t i=0; i<connections.size(); i++) {
+            if (fds[i+1].revents == 0)
+                continue;
+            Connection& conn = connections[i];
+            if (!conn.channel.receive()) {
+                drop(conn);
+                continue;
+            }
+            conn.active = std::chrono::steady_clock::now();
+            std::string line;
+            while (conn.channel.descriptor() >= 0 && conn.channel.nextLine(line))
+                handle(conn, line);
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int fd = accept(server, nullptr, nullptr);
+            if (fd >= 0) {
+                Connection conn = {LineChannel(fd), false, 0, 0, std::chrono::steady_clock::now()};
+                connections.push_back(conn);
+            }
+        }
+
+        // A worker silent for too long while scoring a range is hung, the
+        // range is handed out again
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        for (size_t i=0; i<connections.size(); i++) {
+            Connection& conn = connections[i];
+            if (conn.channel.descriptor() >= 0 && !conn.idle
+                && now - conn.active > std::chrono::seconds(timeout)) {
+                fprintf(stderr, "Coordinator: no answer from a worker for %d s.\n", timeout);
+                drop(conn);
+            }
+        }
+
+        for (size_t i=connections.size(); i-- > 0; ) {
+            if (connections[i].channel.descriptor() < 0)
+                connections.erase(connections.begin()+static_cast<long>(i));
+        }
+        if (!connections.empty()) {
+            alone = now;
+        }
+        else if (now - alone > std::chrono::seconds(timeout)) {
+            fprintf(stderr, "Coordinator: no worker for %d s, %d/%d frames scored.\n",
+                    timeout, nscored, job.nbframes);
+            close(server);
+            return EXIT_FAILURE;
+        }
+        dispatch();
+    }
+
+    for (size_t i=0; i<connections.size(); i++) {
+        connections[i].channel.writeLine("QUIT");
+        connections[i].channel.close();
+    }
+    close(server);
+
+    return writeResults(results_path);
+}
+
+void Coordinator::handle(Connection& conn, const std::string& line)
+{
+    std::istringstream in(line);
+    std::string cmd;
+    in >> cmd;
+
+    if (cmd == "HELLO") {
+        std::ostringstream msg;
+        msg << "JOB " << job.height << " " << job.width << " " << job.chroma << " "
+            << job.bitdepth << " " << job.transfer << " " << job.full_range << " "
+            << job.start << " " << job.nbframes << " " << job.metrics.size();
+        for (size_t m=0; m<job.metrics.size(); m++)
+            msg << " " << job.metrics[m];
+        if (!conn.channel.writeLine(msg.str())
+            || !conn.channel.writeLine("ORIGINAL " + job.original)
+            || !conn.channel.writeLine("PROCESSED " + job.processed)) {
+            drop(conn);
+            return;
+        }
+        conn.idle = true;
+    }
+    else if (cmd == "FRAME") {
+        int frame;
+        in >> frame;
+        int index = frame - job.start;
+        if (!in || index < 0 || index >= job.nbframes) {
+            fprintf(stderr, "Coordinator: unexpected message (%s)\n", line.c_str());
+            drop(conn);
+            return;
+        }
+        if (!scored[static_cast<size_t>(index)]) {
+            for (size_t m=0; m<job.metrics.size(); m++) {
+                float value = 0.0f;
+                in >> value;
+                results[static_cast<size_t>(index)*job.metrics.size()+m] = value;
+                sums[m] += double(value);
+            }
+            scored[static_cast<size_t>(index)] = true;
+            nscored++;
+        }
+        conn.next = frame+1;
+        if (!conn.channel.writeLine("LIMIT " + std::to_string(conn.end)))
+            drop(conn);
+    }
+    else if (cmd == "DONE") {
+        conn.idle = true;
+        conn.next = conn.end = 0;
+
+        // Partial aggregates
+        printf("Coordinator: %d/%d frames scored", nscored, job.nbframes);
+        for (size_t m=0; m<job.metrics.size() && nscored > 0; m++)
+            printf(", %s: %.3f", job.metrics[m].c_str(), sums[m]/nscored);
+        printf("\n");
+    }
+    else {
+        fprintf(stderr, "Coordinator: unexpected message (%s)\n", line.c_str());
+        drop(conn);
+    }
+}
+
+void Coordinator::dispatch()
+{
+    for (size_t i=0; i<connections.size(); i++) {
+        Connection& conn = connections[i];
+        if (!conn.idle || conn.channel.descriptor() < 0)
+            continue;
+
+        if (!ranges.empty()) {
+            std::pair<int,int> range = ranges.front();
+            ranges.pop_front();
+            sendRange(conn, range.first, range.second);
+            continue;
+        }
+
+        // Steal from the worker with the most frames left. The victim keeps
+        // the frame it is scoring and the first half of the rest.
+        Connection *victim = nullptr;
+        for (size_t j=0; j<connections.size(); j++) {
+            Connection& other = connections[j];
+            if (other.idle || other.channel.descriptor() < 0)
+                continue;
+            if (victim == nullptr || other.end-other.next > victim->end-victim->next)
+                victim = &other;
+        }
+        if (victim == nullptr || victim->end-victim->next < 2)
+            return;
+        int mid = victim->next + 1 + (victim->end-victim->next-1)/2;
+        int end = victim->end;
+        victim->end = mid;
+        sendRange(conn, mid, end);
+    }
+}
+
+bool Coordinator::sendRange(Connection& conn, int first, int end)
+{
+    if (!conn.channel.writeLine("RANGE " + std::to_string(first) + " " + std::to_string(end))) {
+        // Still queued, for another worker
+        ranges.push_front(std::make_pair(first, end));
+        drop(conn);
+        return false;
+    }
+    conn.idle = false;
+    conn.next = first;
+    conn.end = end;
+    conn.active = std::chrono::steady_clock::now();
+    return true;
+}
+
+void Coordinator::drop(Connection& conn)
+{
+    // The range in progress is handed out again
+    if (!conn.idle && conn.next < conn.end) {
+        fprintf(stderr, "Coordinator: worker lost, frames %d to %d queued again.\n", conn.next, conn.end-1);
+        ranges.push_back(std::make_pair(conn.next, conn.end));
+    }
+    conn.idle = false;
+    conn.next = conn.end = 0;
+    conn.channel.close();
+}
+
+int Coordinator::writeResults(const std::string& results_path) const
+{
+    size_t nmetrics = job.metrics.size();
+    for (size_t m=0; m<nmetrics; m++) {
+        std::string name = results_path + "_" + (job.transfer != TRANSFER_SDR ? "PU-" : "") + job.metrics[m] + ".csv";
+        FILE *result_file = fopen(name.c_str(), "w");
+        if (result_file == nullptr) {
+            fprintf(stderr, "Coordinator: cannot create results file (%s)\n", name.c_str());
+            return EXIT_FAILURE;
+        }
+        fprintf(result_file, "frame,value\n");
+        for (int i=0; i<job.nbframes; i++) {
+            fprintf(result_file, "%d,%.6f\n", job.start+i,
+                    double(results[static_cast<size_t>(i)*nmetrics+m]));
+            TRACE_RESULT_WRITE(job.start+i, metric2index.at(job.metrics[m]));
+        }
+        fprintf(result_file, "average,%.6f", sums[m] / job.nbframes);
+        fclose(result_file);
+    }
+    return EXIT_SUCCESS;
+}
+
+Worker::Worker(const std::string& address, int threads, size_t budget)
+{
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos) {
+        fprintf(stderr, "Worker: the coordinator address has to be host:port (%s)\n", address.c_str());
+        exit(EXIT_FAILURE);
+    }
+    host = address.substr(0, colon);
+    port = address.substr(colon+1);
+    nthreads = threads;
+    readahead = budget;
+}
+
+int Worker::run()
+{
+    struct addrinfo hints, *info;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &info) != 0) {
+        fprintf(stderr, "Worker: cannot resolve %s\n", host.c_str());
+        return EXIT_FAILURE;
+    }
+    int fd = -1;
+    for (struct addrinfo *ai=info; ai != nullptr && fd < 0; ai=ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(info);
+    if (fd < 0) {
+        fprintf(stderr, "Worker: cannot connect to %s:%s\n", host.c_str(), port.c_str());
+        return EXIT_FAILURE;
+    }
+
+    LineChannel channel(fd);
+    std::string line, cmd;
+    ClusterJob job;
+    size_t nmetrics = 0;
+    if (!channel.writeLine("HELLO") || !channel.readLine(line)) {
+        fprintf(stderr, "Worker: connection to the coordinator lost.\n");
+        return EXIT_FAILURE;
+    }
+    std::istringstream in(line);
+    in >> cmd >> job.height >> job.width >> job.chroma >> job.bitdepth >> job.transfer >> job.full_range >> job.start >> job.nbframes >> nmetrics;
+    job.metrics.resize(nmetrics);
+    for (size_t m=0; m<nmetrics; m++)
+        in >> job.metrics[m];
+    if (!in || cmd != "JOB" || !channel.readLine(job.original) || !channel.readLine(job.processed)
+        || job.original.compare(0, 9, "ORIGINAL ") != 0 || job.processed.compare(0, 10, "PROCESSED ") != 0) {
+        fprintf(stderr, "Worker: invalid job description.\n");
+        return EXIT_FAILURE;
+    }
+    job.original.erase(0, 9);
+    job.processed.erase(0, 10);
+
+    bool enabled[METRIC_SIZE] = {false};
+    std::vector<int> indices(nmetrics);
+    for (size_t m=0; m<nmetrics; m++) {
+        if (!metric2index.count(job.metrics[m])) {
+            fprintf(stderr, "Worker: metric %s not supported.\n", job.metrics[m].c_str());
+            return EXIT_FAILURE;
+        }
+        indices[m] = metric2index.at(job.metrics[m]);
+        enabled[indices[m]] = true;
+    }
+
+    int nbf = job.start+job.nbframes;
+    VideoYUV *original  = new VideoYUV(VideoYUV::expandPath(job.original), job.height, job.width, nbf, job.chroma, job.bitdepth);
+    VideoYUV *processed = new VideoYUV(VideoYUV::expandPath(job.processed), job.height, job.width, nbf, job.chroma, job.bitdepth);
+    original->setTransfer(job.transfer, job.full_range);
+    processed->setTransfer(job.transfer, job.full_range);
+    ThreadPool *pool = nthreads > 1 ? new ThreadPool(nthreads) : nullptr;
+    MetricEngine *engine = new MetricEngine(job.height, job.width, enabled, pool);
+
+    // One scheduler for the whole job, so that the frame pools are
+    // allocated once and the chunk size carries over from range to range
+    ReadScheduler reader(original, processed, job.nbframes, readahead);
+    std::vector<cv::Mat> original_frames(1), processed_frames(1);
+    std::vector<cv::Mat> original_rgb(1), processed_rgb(1);
+    std::vector<float> results;
+    int ret = EXIT_FAILURE;
+    while (channel.readLine(line)) {
+        std::istringstream msg(line);
+        int first, end;
+        msg >> cmd;
+        if (cmd == "QUIT") {
+            ret = EXIT_SUCCESS;
+            break;
+        }
+        msg >> first >> end;
+        if (cmd != "RANGE" || !msg || !original->seekFrame(first) || !processed->seekFrame(first))
+            break;
+
+        printf("Worker: scoring frames %d to %d.\n", first, end-1);
+        reader.restart(end-first);
+        bool ok = true;
+        for (int frame=first; ok && frame<end; frame++) {
+            if (!reader.readOneFrame()) {
+                ok = false;
+                break;
+            }
+            original->getLuma(original_frames[0], CV_32F);
+            processed->getLuma(processed_frames[0], CV_32F);
+            if (engine->needsColor()) {
+                original->getRGB(original_rgb[0]);
+                processed->getRGB(processed_rgb[0]);
+                engine->computeBatch(frame, original_frames, processed_frames, original_rgb, processed_rgb, results);
+            }
+            else {
+                engine->computeBatch(frame, original_frames, processed_frames, results);
+            }
+
+            std::ostringstream reply;
+            reply.precision(9);
+            reply << "FRAME " << frame;
+            for (size_t m=0; m<nmetrics; m++)
+                reply << " " << results[static_cast<size_t>(indices[m])];
+
+            // The coordinator answers with the end of the range, which moves
+            // back when the rest of the range is given to another worker
+            std::string limit;
+            std::istringstream answer;
+            ok = channel.writeLine(reply.str()) && channel.readLine(limit);
+            answer.str(limit);
+            answer >> cmd >> end;
+            ok = ok && answer && cmd == "LIMIT";
+        }
+        if (!ok || !channel.writeLine("DONE"))
+            break;
+    }
+    if (ret != EXIT_SUCCESS)
+        fprintf(stderr, "Worker: connection to the coordinator lost.\n");
+
+    channel.close();
+    delete engine;
+    delete pool;
+    delete original;
+    delete processed;
+    return ret;
+}
+
+#endif /* _WIN32 */
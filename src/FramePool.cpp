@@ -0,0 +1,186 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include "FramePool.hpp"
+
+FrameRef::FrameRef()
+{
+    frame = nullptr;
+}
+
+FrameRef::FrameRef(Frame *f)
+{
+    frame = f;
+}
+
+FrameRef::FrameRef(const FrameRef& other)
+{
+    frame = other.frame;
+    if (frame != nullptr)
+        frame->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+FrameRef::FrameRef(FrameRef&& other)
+{
+    frame = other.frame;
+    other.frame = nullptr;
+}
+
+FrameRef& FrameRef::operator=(FrameRef other)
+{
+    std::swap(frame, other.frame);
+    return *this;
+}
+
+FrameRef::~FrameRef()
+{
+    // The last holder sees the writes of all the others before recycling
+    if (frame != nullptr && frame->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        frame->pool->release(frame);
+}
+
+FrameRef::operator bool() const
+{
+    return frame != nullptr;
+}
+
+const Frame& FrameRef::operator*() const
+{
+    return *frame;
+}
+
+const Frame *FrameRef::operator->() const
+{
+    return frame;
+}
+
+Frame *FrameRef::fill()
+{
+    // Only the reader holds the frame until it hands out copies of the
+    // reference, so the count cannot change under this check
+    if (frame != nullptr && frame->refs.load(std::memory_order_relaxed) != 1) {
+        fprintf(stderr, "FrameRef: frame %d is shared and cannot be filled.\n", frame->number);
+        exit(EXIT_FAILURE);
+    }
+    return frame;
+}
+
+FramePool::FramePool(int nframes, int height, int width, int type)
+{
+    image_type = type;
+    waiting.store(0);
+    if (nframes > 0)
+        buffer.create(nframes*height, width, type);
+    for (int i=0; i<nframes; i++) {
+        frames.push_back(std::unique_ptr<Frame>(new Frame()));
+        Frame& frame = *frames.back();
+        frame.number = -1;
+        frame.image = buffer.rowRange(i*height, (i+1)*height);
+        frame.pool = this;
+        frame.refs.store(0);
+        frame.index = static_cast<uint32_t>(i);
+        frame.next.store(i+1 < nframes ? static_cast<uint32_t>(i+1) : NONE);
+    }
+    head.store(nframes > 0 ? 0 : NONE);
+}
+
+FramePool::~FramePool()
+{
+}
+
+int FramePool::type() const
+{
+    return image_type;
+}
+
+FrameRef FramePool::tryAcquire()
+{
+    uint64_t top = head.load(std::memory_order_acquire);
+    for (;;) {
+        uint32_t index = static_cast<uint32_t>(top);
+        if (index == NONE)
+            return FrameRef();
+        // The tag makes the exchange fail if the frame was taken and pushed
+        // back in the meantime, with another next
+        Frame *frame = frames[index].get();
+        uint64_t next = ((top >> 32) + 1) << 32 | frame->next.load(std::memory_order_relaxed);
+        if (head.compare_exchange_weak(top, next, std::memory_order_acquire, std::memory_order_acquire)) {
+            frame->refs.store(1, std::memory_order_relaxed);
+            return FrameRef(frame);
+        }
+    }
+}
+
+FrameRef FramePool::acquire(double timeout)
+{
+    FrameRef frame = tryAcquire();
+    if (frame)
+        return frame;
+
+    // Announce the wait before checking again under the lock, so that a
+    // release in between either is seen by the check or notifies
+    waiting.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now()
+        + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(timeout > 0.0 ? timeout : 0.0));
+    {
+        std::unique_lock<std::mutex> lock(wait_mutex);
+        for (;;) {
+            frame = tryAcquire();
+            if (frame)
+                break;
+            if (timeout <= 0.0) {
+                released.wait(lock);
+            }
+            else if (released.wait_until(lock, deadline) == std::cv_status::timeout) {
+                frame = tryAcquire();
+                break;
+            }
+        }
+    }
+    waiting.fetch_sub(1);
+    return frame;
+}
+
+void FramePool::release(Frame *frame)
+{
+    uint64_t top = head.load(std::memory_order_relaxed);
+    for (;;) {
+        frame->next.store(static_cast<uint32_t>(top), std::memory_order_relaxed);
+        uint64_t next = ((top >> 32) + 1) << 32 | frame->index;
+        if (head.compare_exchange_weak(top, next, std::memory_order_release, std::memory_order_relaxed))
+            break;
+    }
+
+    // Pairs with the fence of acquire(): either the waiter sees the frame
+    // or this sees the waiter
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting.load() > 0) {
+        std::lock_guard<std::mutex> lock(wait_mutex);
+        released.notify_all();
+    }
+}
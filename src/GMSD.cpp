@@ -0,0 +1,145 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+//
+// This is an OpenCV implementation of the original Matlab implementation
+// from Wufeng Xue available from http://www4.comp.polyu.edu.hk/~cslzhang/IQA/GMSD/GMSD.htm.
+// Please refer to the following paper:
+// - W. Xue, L. Zhang, X. Mou, and A.C. Bovik, "Gradient magnitude
+//   similarity deviation: a highly efficient perceptual image quality
+//   index," IEEE Transactions on Image Processing, vol. 23, no. 2,
+//   pp. 684–695, February 2014.
+//
+
+#include <algorithm>
+#include "GMSD.hpp"
+
+const double GMSD::T = 170.0;
+
+GMSD::GMSD(int h, int w) : Metric(h, w)
+{
+    // dx = [1 0 -1; 1 0 -1; 1 0 -1]/3; dy = dx';
+    dx = cv::Mat(3, 3, CV_32F);
+    for (int i=0; i<3; i++) {
+        dx.at<float>(i,0) = 1.0f/3.0f;
+        dx.at<float>(i,1) = 0.0f;
+        dx.at<float>(i,2) = -1.0f/3.0f;
+    }
+    dy = dx.t();
+}
+
+float GMSD::compute(const cv::Mat& original, const cv::Mat& processed)
+{
+    // aveY1 = conv2(Y1, aveKernel,'same'); Y1 = aveY1(1:2:end,1:2:end);
+    // (2x2 average, same as the first level of MS-SSIM)
+    cv::Mat img1, img2;
+    downsample(original, img1);
+    downsample(processed, img2);
+
+    return computeDownsampled(img1, img2);
+}
+
+void GMSD::computeFrames(const std::vector<cv::Mat>& original, const std::vector<cv::Mat>& processed,
+                         std::vector<float>& results)
+{
+    size_t n = original.size();
+    results.resize(n);
+    if (n == 0)
+        return;
+
+    // Downsampled frames one below the other, separated by rows of zeros:
+    // the gradients of the stack see the zero padding of conv2(..., 'same')
+    // around each frame
+    int h = (original[0].rows+1)/2;
+    int w = (original[0].cols+1)/2;
+    size_t per_stack = stackFrames(original[0]);
+    cv::Mat img1, img2, gm1, gm2, tmp1, tmp2;
+    for (size_t begin=0; begin<n; begin+=per_stack) {
+        size_t end = std::min(begin+per_stack, n);
+        int rows = static_cast<int>(end-begin)*(h+1)+1;
+        img1.create(rows, w, CV_32F);
+        img2.create(rows, w, CV_32F);
+        for (size_t i=begin; i<end; i++) {
+            int y = static_cast<int>(i-begin)*(h+1);
+            img1.row(y).setTo(cv::Scalar(0));
+            img2.row(y).setTo(cv::Scalar(0));
+            cv::Mat frame1 = img1.rowRange(y+1, y+1+h);
+            cv::Mat frame2 = img2.rowRange(y+1, y+1+h);
+            downsample(original[i], frame1);
+            downsample(processed[i], frame2);
+        }
+        img1.row(rows-1).setTo(cv::Scalar(0));
+        img2.row(rows-1).setTo(cv::Scalar(0));
+
+        gradientMagnitude(img1, gm1);
+        gradientMagnitude(img2, gm2);
+        cv::multiply(gm1, gm2, tmp1, 2.0);
+        tmp1 += T;
+        cv::multiply(gm1, gm1, gm1);
+        cv::multiply(gm2, gm2, gm2);
+        tmp2 = gm1 + gm2 + T;
+        cv::divide(tmp1, tmp2, tmp1);
+
+        double count = static_cast<double>(h)*w;
+        for (size_t i=begin; i<end; i++) {
+            int y = static_cast<int>(i-begin)*(h+1)+1;
+            cv::Scalar mean, stddev;
+            cv::meanStdDev(tmp1.rowRange(y, y+h), mean, stddev);
+            results[i] = float(stddev.val[0] * sqrt(count/(count-1)));
+        }
+    }
+}
+
+float GMSD::computeDownsampled(const cv::Mat& original, const cv::Mat& processed)
+{
+    cv::Mat gm1, gm2, tmp1, tmp2;
+
+    gradientMagnitude(original, gm1);
+    gradientMagnitude(processed, gm2);
+
+    // quality_map = (2*gradientMap1.*gradientMap2 + T) ./(gradientMap1.^2 + gradientMap2.^2 + T);
+    cv::multiply(gm1, gm2, tmp1, 2.0);
+    tmp1 += T;
+    cv::multiply(gm1, gm1, gm1);
+    cv::multiply(gm2, gm2, gm2);
+    tmp2 = gm1 + gm2 + T;
+    cv::divide(tmp1, tmp2, tmp1);
+
+    // score = std2(quality_map);
+    cv::Scalar mean, stddev;
+    cv::meanStdDev(tmp1, mean, stddev);
+    double n = static_cast<double>(tmp1.total());
+
+    return float(stddev.val[0] * sqrt(n/(n-1)));
+}
+
+void GMSD::gradientMagnitude(const cv::Mat& img, cv::Mat& gm)
+{
+    cv::Mat ix, iy;
+    // IxY1 = conv2(Y1, dx, 'same'); IyY1 = conv2(Y1, dy, 'same');
+    cv::filter2D(img, ix, CV_32F, dx, cv::Point(-1,-1), 0, cv::BORDER_CONSTANT);
+    cv::filter2D(img, iy, CV_32F, dy, cv::Point(-1,-1), 0, cv::BORDER_CONSTANT);
+    // gradientMap1 = sqrt(IxY1.^2 + IyY1.^2);
+    cv::magnitude(ix, iy, gm);
+}
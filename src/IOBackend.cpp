@@ -0,0 +1,437 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#else /* Linux, *BSD, ... */
+#include <unistd.h>
+#include <sys/mman.h>
+#endif /* _WIN32 */
+#include <chrono>
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#include "IOBackend.hpp"
+
+#ifndef _WIN32
+// as in VideoYUV.hpp, no difference between text and binary files on UNIX
+#define O_BINARY 0
+#endif /* _WIN32 */
+
+// Alignment of the offsets, sizes and buffers of O_DIRECT requests
+#define DIRECT_ALIGN 4096
+// Size of the aligned buffer of O_DIRECT reads
+#define DIRECT_BUFFER (8 << 20)
+// io_uring: requests in flight, and smallest request
+#define URING_DEPTH 8
+#define URING_MIN_REQUEST (256 << 10)
+
+static int io_selected = IO_READ;
+
+IOBackend::~IOBackend()
+{
+}
+
+class ReadIO : public IOBackend {
+public:
+    ReadIO() : file(-1) {}
+    ~ReadIO() override
+    {
+        if (file >= 0)
+            close(file);
+    }
+    bool open(const std::string& path) override
+    {
+        file = ::open(path.c_str(), O_RDONLY | O_BINARY);
+        if (file < 0)
+            return false;
+#ifdef POSIX_FADV_SEQUENTIAL
+        posix_fadvise(file, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        return true;
+    }
+    ssize_t read(void *buf, size_t bytes) override
+    {
+        return ::read(file, buf, bytes);
+    }
+    bool seek(int64_t offset) override
+    {
+        return lseek(file, offset, SEEK_SET) >= 0;
+    }
+    void willNeed() override
+    {
+#ifdef POSIX_FADV_WILLNEED
+        posix_fadvise(file, 0, 0, POSIX_FADV_WILLNEED);
+#endif
+    }
+private:
+    int file;
+};
+
+// Only read() is portable, the other backends are left out on Windows
+#ifndef _WIN32
+class MmapIO : public IOBackend {
+public:
+    MmapIO() : map(nullptr), size(0), pos(0) {}
+    ~MmapIO() override
+    {
+        if (map != nullptr)
+            munmap(map, size);
+    }
+    bool open(const std::string& path) override
+    {
+        int file = ::open(path.c_str(), O_RDONLY);
+        if (file < 0)
+            return false;
+        struct stat st;
+        if (fstat(file, &st) != 0 || !S_ISREG(st.st_mode) || static_cast<uint64_t>(st.st_size) > SIZE_MAX) {
+            close(file);
+            return false;
+        }
+        size = static_cast<size_t>(st.st_size);
+        // An empty file cannot be mapped, and has nothing to read anyway
+        if (size > 0) {
+            map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+            if (map == MAP_FAILED)
+                map = nullptr;
+        }
+        close(file);
+        if (size > 0 && map == nullptr)
+            return false;
+        if (map != nullptr)
+            madvise(map, size, MADV_SEQUENTIAL);
+        return true;
+    }
+    ssize_t read(void *buf, size_t bytes) override
+    {
+        if (pos >= size)
+            return 0;
+        if (bytes > size-pos)
+            bytes = size-pos;
+        memcpy(buf, static_cast<const char *>(map)+pos, bytes);
+        pos += bytes;
+        return static_cast<ssize_t>(bytes);
+    }
+    bool seek(int64_t offset) override
+    {
+        if (offset < 0)
+            return false;
+        pos = static_cast<size_t>(offset);
+        return true;
+    }
+    void willNeed() override
+    {
+        if (map != nullptr)
+            madvise(map, size, MADV_WILLNEED);
+    }
+private:
+    void *map;
+    size_t size;
+    size_t pos;
+};
+
+#ifdef HAVE_LIBURING
+class UringIO : public IOBackend {
+public:
+    UringIO() : file(-1), pos(0), ring_ready(false) {}
+    ~UringIO() override
+    {
+        if (ring_ready)
+            io_uring_queue_exit(&ring);
+        if (file >= 0)
+            close(file);
+    }
+    bool open(const std::string& path) override
+    {
+        file = ::open(path.c_str(), O_RDONLY);
+        if (file < 0)
+            return false;
+        if (io_uring_queue_init(URING_DEPTH, &ring, 0) < 0)
+            return false;
+        ring_ready = true;
+#ifdef POSIX_FADV_SEQUENTIAL
+        posix_fadvise(file, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        return true;
+    }
+    ssize_t read(void *buf, size_t bytes) override
+    {
+        // Split the read into up to URING_DEPTH requests submitted at once,
+        // so that the storage works on all of them in parallel
+        size_t request = (bytes + URING_DEPTH-1) / URING_DEPTH;
+        if (request < URING_MIN_REQUEST)
+            request = URING_MIN_REQUEST;
+        size_t lengths[URING_DEPTH];
+        ssize_t results[URING_DEPTH];
+        unsigned n = 0;
+        for (size_t off=0; off<bytes && n<URING_DEPTH; off+=request, n++) {
+            lengths[n] = bytes-off < request ? bytes-off : request;
+            struct io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+            io_uring_prep_read(sqe, file, static_cast<char *>(buf)+off, static_cast<unsigned>(lengths[n]),
+                               static_cast<uint64_t>(pos)+off);
+            io_uring_sqe_set_data(sqe, reinterpret_cast<void *>(static_cast<uintptr_t>(n)));
+        }
+        if (n == 0)
+            return 0;
+        if (io_uring_submit(&ring) < 0)
+            return -1;
+        for (unsigned i=0; i<n; i++) {
+            struct io_uring_cqe *cqe;
+            if (io_uring_wait_cqe(&ring, &cqe) < 0)
+                return -1;
+            results[reinterpret_cast<uintptr_t>(io_uring_cqe_get_data(cqe))] = cqe->res;
+            io_uring_cqe_seen(&ring, cqe);
+        }
+        // Only the leading run of complete requests is contiguous
+        size_t got = 0;
+        for (unsigned i=0; i<n; i++) {
+            if (results[i] < 0)
+                return got > 0 ? static_cast<ssize_t>(got) : -1;
+            got += static_cast<size_t>(results[i]);
+            if (static_cast<size_t>(results[i]) < lengths[i])
+                break;
+        }
+        pos += static_cast<int64_t>(got);
+        return static_cast<ssize_t>(got);
+    }
+    bool seek(int64_t offset) override
+    {
+        if (offset < 0)
+            return false;
+        pos = offset;
+        return true;
+    }
+    void willNeed() override
+    {
+#ifdef POSIX_FADV_WILLNEED
+        posix_fadvise(file, 0, 0, POSIX_FADV_WILLNEED);
+#endif
+    }
+private:
+    int file;
+    int64_t pos;
+    bool ring_ready;
+    struct io_uring ring;
+};
+#endif
+
+class DirectIO : public IOBackend {
+public:
+    DirectIO() : file(-1), pos(0), buffer(nullptr) {}
+    ~DirectIO() override
+    {
+        free(buffer);
+        if (file >= 0)
+            close(file);
+    }
+    bool open(const std::string& path) override
+    {
+#ifdef O_DIRECT
+        file = ::open(path.c_str(), O_RDONLY | O_DIRECT);
+#endif
+        if (file < 0)
+            return false;
+        void *ptr;
+        if (posix_memalign(&ptr, DIRECT_ALIGN, DIRECT_BUFFER) != 0)
+            return false;
+        buffer = static_cast<char *>(ptr);
+        // Some file systems accept the flag at open() and fail the reads
+        if (pread(file, buffer, DIRECT_ALIGN, 0) < 0)
+            return false;
+        return true;
+    }
+    ssize_t read(void *buf, size_t bytes) override
+    {
+        // Aligned read covering the start of the request, copied out of the
+        // aligned buffer
+        int64_t start = pos & ~static_cast<int64_t>(DIRECT_ALIGN-1);
+        size_t skip = static_cast<size_t>(pos - start);
+        size_t want = skip + bytes;
+        if (want > DIRECT_BUFFER)
+            want = DIRECT_BUFFER;
+        want = (want + DIRECT_ALIGN-1) & ~static_cast<size_t>(DIRECT_ALIGN-1);
+        ssize_t ret = pread(file, buffer, want, start);
+        if (ret < 0)
+            return -1;
+        if (static_cast<size_t>(ret) <= skip)
+            return 0;
+        size_t got = static_cast<size_t>(ret) - skip;
+        if (got > bytes)
+            got = bytes;
+        memcpy(buf, buffer+skip, got);
+        pos += static_cast<int64_t>(got);
+        return static_cast<ssize_t>(got);
+    }
+    bool seek(int64_t offset) override
+    {
+        if (offset < 0)
+            return false;
+        pos = offset;
+        return true;
+    }
+    void willNeed() override
+    {
+        // Nothing to prefetch: the page cache is bypassed
+    }
+private:
+    int file;
+    int64_t pos;
+    char *buffer;
+};
+#endif /* _WIN32 */
+
+IOBackend *IOBackend::create(int mode)
+{
+    if (mode == IO_AUTO)
+        mode = io_selected;
+    switch (mode) {
+#ifndef _WIN32
+    case IO_MMAP:
+        return new MmapIO();
+#ifdef HAVE_LIBURING
+    case IO_URING:
+        return new UringIO();
+#endif
+    case IO_DIRECT:
+        return new DirectIO();
+#endif /* _WIN32 */
+    default:
+        return new ReadIO();
+    }
+}
+
+void IOBackend::select(int mode)
+{
+    io_selected = mode == IO_AUTO || !available(mode) ? IO_READ : mode;
+}
+
+int IOBackend::selected()
+{
+    return io_selected;
+}
+
+static const char *io_names[IO_MODES] = { "auto", "read", "mmap", "uring", "direct" };
+
+int IOBackend::parse(const std::string& name)
+{
+    for (int mode=0; mode<IO_MODES; mode++) {
+        if (name == io_names[mode])
+            return mode;
+    }
+    return -1;
+}
+
+const char *IOBackend::name(int mode)
+{
+    return mode >= 0 && mode < IO_MODES ? io_names[mode] : "unknown";
+}
+
+bool IOBackend::available(int mode)
+{
+#ifdef _WIN32
+    if (mode == IO_MMAP || mode == IO_URING || mode == IO_DIRECT)
+        return false;
+#endif
+#ifndef HAVE_LIBURING
+    if (mode == IO_URING)
+        return false;
+#endif
+#ifndef O_DIRECT
+    if (mode == IO_DIRECT)
+        return false;
+#endif
+    return mode >= 0 && mode < IO_MODES;
+}
+
+int IOBackend::probe(const std::string& path, size_t bytes, std::vector<double>& bandwidth)
+{
+    bandwidth.assign(IO_MODES, 0.0);
+
+#ifdef _WIN32
+    // read() is the only backend
+    (void)path;
+    (void)bytes;
+    return IO_READ;
+#else
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+        return IO_READ;
+
+    std::vector<int> modes;
+    for (int mode=IO_READ; mode<IO_MODES; mode++) {
+        if (available(mode))
+            modes.push_back(mode);
+    }
+
+    // Each backend reads its own part of the file, so that none of them
+    // finds the data cached by the previous one
+    size_t part = (static_cast<size_t>(st.st_size) < bytes ? static_cast<size_t>(st.st_size) : bytes) / modes.size();
+    part &= ~static_cast<size_t>(DIRECT_ALIGN-1);
+    if (part < DIRECT_BUFFER)
+        return IO_READ;
+
+    std::vector<char> buf(DIRECT_BUFFER);
+    int best = IO_READ;
+    for (size_t i=0; i<modes.size(); i++) {
+        int64_t offset = static_cast<int64_t>(i*part);
+
+        // Drop the part from the page cache (clean pages only)
+        int file = ::open(path.c_str(), O_RDONLY);
+        if (file >= 0) {
+#ifdef POSIX_FADV_DONTNEED
+            posix_fadvise(file, offset, static_cast<off_t>(part), POSIX_FADV_DONTNEED);
+#endif
+            close(file);
+        }
+
+        IOBackend *io = create(modes[i]);
+        if (io->open(path) && io->seek(offset)) {
+            auto t0 = std::chrono::steady_clock::now();
+            size_t got = 0;
+            while (got < part) {
+                size_t want = part-got < buf.size() ? part-got : buf.size();
+                ssize_t ret = io->read(buf.data(), want);
+                if (ret <= 0)
+                    break;
+                got += static_cast<size_t>(ret);
+            }
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - t0;
+            if (got == part && elapsed.count() > 0.0)
+                bandwidth[static_cast<size_t>(modes[i])] = static_cast<double>(got) / elapsed.count() / 1e6;
+        }
+        delete io;
+
+        if (bandwidth[static_cast<size_t>(modes[i])] > bandwidth[static_cast<size_t>(best)])
+            best = modes[i];
+    }
+    return best;
+#endif /* _WIN32 */
+}
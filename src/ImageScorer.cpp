@@ -0,0 +1,231 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <opencv2/highgui/highgui.hpp>
+
+#include "ImageScorer.hpp"
+
+// Pairs per task: large enough to amortize the scheduling, small enough to
+// balance the load
+#define CHUNK_PAIRS 16
+
+// Decoded images of a worker thread, the buffers only grow
+struct Workspace {
+    std::vector<float> original, processed;
+    std::vector<float> original_rgb, processed_rgb;
+};
+
+static thread_local Workspace workspace;
+
+// Image of rows x cols (CV_32F, 1 or 3 channels) over a buffer, grown if
+// needed
+static cv::Mat wrap(std::vector<float>& buffer, int rows, int cols, int channels)
+{
+    size_t needed = static_cast<size_t>(rows) * static_cast<size_t>(cols) * static_cast<size_t>(channels);
+    if (buffer.size() < needed)
+        buffer.resize(needed);
+    return cv::Mat(rows, cols, channels == 3 ? CV_32FC3 : CV_32F, buffer.data());
+}
+
+// Smallest size of the metrics (see checkSize() in main.cpp), the SSIM
+// window for the others
+static int minimumSize(const bool enabled[METRIC_SIZE])
+{
+    if (enabled[METRIC_MSSSIM])
+        return 161;
+    if (enabled[METRIC_VIF])
+        return VIF::MIN_SIZE;
+    if (enabled[METRIC_VIFP])
+        return 41;
+    return 11;
+}
+
+ImageScorer::ImageScorer(const std::vector<int>& m, size_t n)
+{
+    metrics = m;
+    max_idle = n;
+    for (int i=0; i<METRIC_SIZE; i++)
+        enabled[i] = false;
+    for (size_t i=0; i<metrics.size(); i++)
+        enabled[metrics[i]] = true;
+    color = enabled[METRIC_SSIMULACRA2];
+}
+
+ImageScorer::~ImageScorer()
+{
+    for (auto it=idle.begin(); it!=idle.end(); ++it)
+        delete *it;
+}
+
+MetricEngine *ImageScorer::acquire(int height, int width)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!idle.empty()) {
+            MetricEngine *engine = idle.front();
+            idle.pop_front();
+            return engine;
+        }
+    }
+    // The pairs are the parallelism: no pool for the levels of MS-SSIM and
+    // VIFp, whose tasks would wait on workers busy with other pairs
+    return new MetricEngine(height, width, enabled, nullptr);
+}
+
+void ImageScorer::release(MetricEngine *engine)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.push_front(engine);
+    if (idle.size() > max_idle) {
+        delete idle.back();
+        idle.pop_back();
+    }
+}
+
+const char *ImageScorer::score(const std::string& original_path, const std::string& processed_path,
+                               int& height, int& width, std::vector<float>& results)
+{
+    int flags = color ? cv::IMREAD_COLOR : cv::IMREAD_GRAYSCALE;
+    cv::Mat original_img = cv::imread(original_path, flags);
+    cv::Mat processed_img = cv::imread(processed_path, flags);
+    if (original_img.empty() || processed_img.empty())
+        return "cannot decode";
+    height = original_img.rows;
+    width = original_img.cols;
+    if (processed_img.rows != height || processed_img.cols != width)
+        return "different sizes";
+    if (std::min(height, width) < minimumSize(enabled))
+        return "too small for the metrics";
+
+    // Luma (grey) and R'G'B' frames, in the buffers of the thread
+    std::vector<cv::Mat> original(1), processed(1), original_rgb, processed_rgb;
+    original[0] = wrap(workspace.original, height, width, 1);
+    processed[0] = wrap(workspace.processed, height, width, 1);
+    if (color) {
+        original_rgb.assign(1, wrap(workspace.original_rgb, height, width, 3));
+        processed_rgb.assign(1, wrap(workspace.processed_rgb, height, width, 3));
+        original_img.convertTo(original_rgb[0], CV_32FC3, 1.0/255.0);
+        processed_img.convertTo(processed_rgb[0], CV_32FC3, 1.0/255.0);
+        cv::cvtColor(original_rgb[0], original_rgb[0], cv::COLOR_BGR2RGB);
+        cv::cvtColor(processed_rgb[0], processed_rgb[0], cv::COLOR_BGR2RGB);
+        // Grey levels on the 0-255 scale of the other metrics
+        cv::cvtColor(original_rgb[0], original[0], cv::COLOR_RGB2GRAY);
+        cv::cvtColor(processed_rgb[0], processed[0], cv::COLOR_RGB2GRAY);
+        original[0] *= 255.0;
+        processed[0] *= 255.0;
+    }
+    else {
+        original_img.convertTo(original[0], CV_32F);
+        processed_img.convertTo(processed[0], CV_32F);
+    }
+
+    MetricEngine *engine = acquire(height, width);
+    if (color)
+        engine->computeBatch(0, original, processed, original_rgb, processed_rgb, results);
+    else
+        engine->computeBatch(0, original, processed, results);
+    release(engine);
+    return nullptr;
+}
+
+long ImageScorer::run(const std::string& manifest, ThreadPool *pool, FILE *results)
+{
+    std::ifstream file(manifest.c_str());
+    if (!file) {
+        fprintf(stderr, "Images: cannot open manifest (%s)\n", manifest.c_str());
+        return -1;
+    }
+    std::vector<std::pair<std::string, std::string>> pairs;
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream fields(line);
+        std::string original, processed;
+        if (!(fields >> original) || original[0] == '#')
+            continue;
+        if (!(fields >> processed)) {
+            fprintf(stderr, "Images: no processed image for %s, skipped.\n", original.c_str());
+            continue;
+        }
+        pairs.push_back(std::make_pair(original, processed));
+    }
+
+    fprintf(results, "original,processed,height,width");
+    for (size_t m=0; m<metrics.size(); m++) {
+        for (auto it=metric2index.begin(); it!=metric2index.end(); ++it) {
+            if (it->second == metrics[m])
+                fprintf(results, ",%s", it->first.c_str());
+        }
+    }
+    fprintf(results, "\n");
+
+    // Lines are written in the order of the manifest: a finished line waits
+    // in pending until all the previous ones are written
+    std::mutex output;
+    std::map<size_t, std::string> pending;
+    size_t next_line = 0;
+    long failed = 0;
+
+    TaskGroup group(pool);
+    for (size_t begin=0; begin<pairs.size(); begin+=CHUNK_PAIRS) {
+        size_t end = std::min(begin+CHUNK_PAIRS, pairs.size());
+        group.run([&, begin, end] {
+            std::vector<float> values;
+            for (size_t i=begin; i<end; i++) {
+                int height = 0, width = 0;
+                const char *error = score(pairs[i].first, pairs[i].second, height, width, values);
+                std::ostringstream row;
+                row << pairs[i].first << "," << pairs[i].second << "," << height << "," << width;
+                char value[32];
+                for (size_t m=0; m<metrics.size(); m++) {
+                    if (error == nullptr)
+                        snprintf(value, sizeof(value), ",%.6f", static_cast<double>(values[static_cast<size_t>(metrics[m])]));
+                    else
+                        snprintf(value, sizeof(value), ",nan");
+                    row << value;
+                }
+                row << "\n";
+
+                std::unique_lock<std::mutex> lock(output);
+                if (error != nullptr) {
+                    fprintf(stderr, "Images: %s and %s: %s.\n", pairs[i].first.c_str(), pairs[i].second.c_str(), error);
+                    failed++;
+                }
+                pending[i] = row.str();
+                while (!pending.empty() && pending.begin()->first == next_line) {
+                    fputs(pending.begin()->second.c_str(), results);
+                    pending.erase(pending.begin());
+                    next_line++;
+                }
+            }
+        });
+    }
+    group.wait();
+
+    printf("Images: %zu pairs scored, %ld failed.\n", pairs.size() - static_cast<size_t>(failed), failed);
+    return failed;
+}
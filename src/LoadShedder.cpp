@@ -0,0 +1,182 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+#include <sstream>
+#include "LoadShedder.hpp"
+#include "MetricEngine.hpp"
+
+// Seconds over which a lag is caught up
+const double LoadShedder::CATCHUP = 0.5;
+// Weight of a new measurement in the cost estimates
+const double LoadShedder::SMOOTHING = 0.2;
+
+// Importance of a metric, 0 is never shed
+static int metricPriority(int metric)
+{
+    switch (metric) {
+    case METRIC_PSNR:
+    case METRIC_WSPSNR:
+        return 0;
+    case METRIC_SSIM:
+    case METRIC_GMSD:
+        return 1;
+    case METRIC_MSSSIM:
+    case METRIC_PSNRHVS:
+    case METRIC_PSNRHVSM:
+        return 2;
+    default:
+        return 3;
+    }
+}
+
+LoadShedder::LoadShedder(double fps, const std::vector<int>& metrics, const std::vector<bool>& half)
+{
+    period = 1.0 / fps;
+    for (size_t i=0; i<metrics.size(); i++) {
+        State state;
+        state.priority = metricPriority(metrics[i]);
+        state.half = half[i] && state.priority > 0;
+        state.cost_full = 0.0;
+        state.cost_half = 0.0;
+        state.level = 0;
+        state.run = true;
+        state.full = 0;
+        state.halves = 0;
+        state.shed = 0;
+        states.push_back(state);
+    }
+}
+
+int LoadShedder::maxLevel(const State& state)
+{
+    if (state.priority == 0)
+        return 0;
+    // Strides 2 to MAX_STRIDE after the resolution levels
+    int levels = state.half ? 1 : 0;
+    for (int k=2; k<=MAX_STRIDE; k*=2)
+        levels++;
+    return levels;
+}
+
+int LoadShedder::stride(const State& state, int level)
+{
+    int first = state.half ? 2 : 1;
+    return level < first ? 1 : 2 << (level-first);
+}
+
+bool LoadShedder::isHalf(const State& state, int level)
+{
+    return state.half && level >= 1;
+}
+
+double LoadShedder::levelCost(const State& state, int level)
+{
+    double cost = state.cost_full;
+    if (isHalf(state, level))
+        cost = state.cost_half > 0.0 ? state.cost_half : state.cost_full / 4;
+    return cost / stride(state, level);
+}
+
+bool LoadShedder::plan(int frame, double lag)
+{
+    double budget = period - (lag > 0.0 ? lag * period / CATCHUP : 0.0);
+
+    std::vector<int> levels(states.size(), 0);
+    double total = 0.0;
+    for (size_t i=0; i<states.size(); i++)
+        total += levelCost(states[i], 0);
+
+    // Degrade the least important, then most expensive, metric until the
+    // frame fits in its budget
+    while (total > budget) {
+        size_t victim = states.size();
+        for (size_t i=0; i<states.size(); i++) {
+            if (levels[i] >= maxLevel(states[i]))
+                continue;
+            if (victim == states.size() || states[i].priority > states[victim].priority
+                || (states[i].priority == states[victim].priority
+                    && levelCost(states[i], levels[i]) > levelCost(states[victim], levels[victim])))
+                victim = i;
+        }
+        if (victim == states.size())
+            break;
+        total -= levelCost(states[victim], levels[victim]);
+        levels[victim]++;
+        total += levelCost(states[victim], levels[victim]);
+    }
+
+    bool changed = false;
+    for (size_t i=0; i<states.size(); i++) {
+        State& state = states[i];
+        changed = changed || state.level != levels[i];
+        state.level = levels[i];
+        state.run = frame % stride(state, state.level) == 0;
+        if (!state.run)
+            state.shed++;
+        else if (isHalf(state, state.level))
+            state.halves++;
+        else
+            state.full++;
+    }
+    return changed;
+}
+
+bool LoadShedder::runs(size_t i) const
+{
+    return states[i].run;
+}
+
+bool LoadShedder::halved(size_t i) const
+{
+    return isHalf(states[i], states[i].level);
+}
+
+void LoadShedder::record(size_t i, double seconds)
+{
+    State& state = states[i];
+    double& cost = halved(i) ? state.cost_half : state.cost_full;
+    cost = cost > 0.0 ? (1.0-SMOOTHING)*cost + SMOOTHING*seconds : seconds;
+}
+
+std::string LoadShedder::describe(size_t i) const
+{
+    const State& state = states[i];
+    std::ostringstream text;
+    text << (isHalf(state, state.level) ? "half" : "full");
+    if (stride(state, state.level) > 1)
+        text << ", 1/" << stride(state, state.level);
+    return text.str();
+}
+
+void LoadShedder::counts(size_t i, long& full, long& half, long& shed) const
+{
+    full = states[i].full;
+    half = states[i].halves;
+    shed = states[i].shed;
+}
+
+double LoadShedder::cost(size_t i) const
+{
+    return states[i].cost_full;
+}
@@ -37,52 +37,108 @@
 
 const double MSSSIM::WEIGHT[] = {0.0448, 0.2856, 0.3001, 0.2363, 0.1333};
 
-MSSSIM::MSSSIM(int h, int w) : SSIM(h, w)
+MSSSIM::MSSSIM(int h, int w, ThreadPool *p) : SSIM(h, w)
 {
+    pool = p;
 }
 
 float MSSSIM::compute(const cv::Mat& original, const cv::Mat& processed)
 {
-    double mssim[NLEVS];
-    double mcs[NLEVS];
-
-    cv::Mat im1[NLEVS];
-    cv::Mat im2[NLEVS];
-
-    int w = original.cols;
-    int h = original.rows;
-
-    original.copyTo(im1[0]);
-    processed.copyTo(im2[0]);
-
-    for (int l=0; l<NLEVS; l++) {
-        // [mssim_array(l) ssim_map_array{l} mcs_array(l) cs_map_array{l}] = ssim_index_new(im1, im2, K, window);
-        cv::Scalar res = SSIM::computeSSIM(im1[l], im2[l]);
-        mssim[l] = res.val[0];
-        mcs[l] = res.val[1];
-
-        if (l < NLEVS-1) {
-            w /= 2;
-            h /= 2;
-            im1[l+1] = cv::Mat(h,w,CV_32F);
-            im2[l+1] = cv::Mat(h,w,CV_32F);
-
-            // filtered_im1 = filter2(downsample_filter, im1, 'valid');
-            // im1 = filtered_im1(1:2:M-1, 1:2:N-1);
-            cv::resize(im1[l], im1[l+1], cv::Size(w,h), 0, 0, cv::INTER_LINEAR);
-            // filtered_im2 = filter2(downsample_filter, im2, 'valid');
-            // im2 = filtered_im2(1:2:M-1, 1:2:N-1);
-            cv::resize(im2[l], im2[l+1], cv::Size(w,h), 0, 0, cv::INTER_LINEAR);
+    std::vector<float> ssim_res, msssim_res;
+    computeBatch(std::vector<cv::Mat>(1, original), std::vector<cv::Mat>(1, processed), ssim_res, msssim_res);
+
+    return msssim_res[0];
+}
+
+void MSSSIM::computeBatch(const std::vector<cv::Mat>& original, const std::vector<cv::Mat>& processed,
+                          std::vector<float>& ssim_res, std::vector<float>& msssim_res)
+{
+    computeBatch(original, processed, ssim_res, msssim_res, nullptr, nullptr);
+}
+
+void MSSSIM::computeBatch(const std::vector<cv::Mat>& original, const std::vector<cv::Mat>& processed,
+                          std::vector<float>& ssim_res, std::vector<float>& msssim_res,
+                          GMSD& gmsd, std::vector<float>& gmsd_res)
+{
+    computeBatch(original, processed, ssim_res, msssim_res, &gmsd, &gmsd_res);
+}
+
+void MSSSIM::computeBatch(const std::vector<cv::Mat>& original, const std::vector<cv::Mat>& processed,
+                          std::vector<float>& ssim_res, std::vector<float>& msssim_res,
+                          GMSD *gmsd, std::vector<float> *gmsd_res)
+{
+    size_t nframes = original.size();
+
+    if (gmsd_res != nullptr)
+        gmsd_res->resize(nframes);
+
+    std::vector<cv::Mat> im1(nframes*NLEVS);
+    std::vector<cv::Mat> im2(nframes*NLEVS);
+    // [mssim mcs] of each level of each frame
+    std::vector<cv::Scalar> res(nframes*NLEVS);
+
+    TaskGroup tasks(pool);
+
+    for (size_t f=0; f<nframes; f++) {
+        cv::Mat *pyr1 = &im1[f*NLEVS];
+        cv::Mat *pyr2 = &im2[f*NLEVS];
+
+        int w = original[f].cols;
+        int h = original[f].rows;
+
+        pyr1[0] = original[f];
+        pyr2[0] = processed[f];
+
+        for (int l=0; l<NLEVS; l++) {
+            // [mssim_array(l) ssim_map_array{l} mcs_array(l) cs_map_array{l}] = ssim_index_new(im1, im2, K, window);
+            cv::Mat a = pyr1[l];
+            cv::Mat b = pyr2[l];
+            cv::Scalar *r = &res[f*NLEVS+static_cast<size_t>(l)];
+            std::function<void()> task = [this, a, b, r] { *r = SSIM::computeSSIM(a, b); };
+            if (h*w >= SMALL_LEVEL)
+                tasks.run(task);
+            else
+                tasks.defer(task);
+
+            // The next level is built while the SSIM of this one runs
+            if (l < NLEVS-1) {
+                // filtered_im1 = filter2(downsample_filter, im1, 'valid');
+                // im1 = filtered_im1(1:2:M-1, 1:2:N-1);
+                downsample(pyr1[l], pyr1[l+1]);
+                // filtered_im2 = filter2(downsample_filter, im2, 'valid');
+                // im2 = filtered_im2(1:2:M-1, 1:2:N-1);
+                downsample(pyr2[l], pyr2[l+1]);
+                w = pyr1[l+1].cols;
+                h = pyr1[l+1].rows;
+
+                // GMSD uses the same 2x2 averaging, reuse the planes while
+                // they are hot
+                if (l == 0 && gmsd != nullptr) {
+                    cv::Mat a1 = pyr1[1];
+                    cv::Mat b1 = pyr2[1];
+                    float *g = &(*gmsd_res)[f];
+                    tasks.run([gmsd, a1, b1, g] { *g = gmsd->computeDownsampled(a1, b1); });
+                }
+            }
         }
     }
 
-    ssim = mssim[0];
+    tasks.wait();
 
-    // overall_mssim = prod(mcs_array(1:level-1).^weight(1:level-1))*mssim_array(level);
-    msssim = mssim[NLEVS-1];
-    for (int l=0; l<NLEVS-1; l++)	msssim *= pow(mcs[l], WEIGHT[l]);
+    ssim_res.resize(nframes);
+    msssim_res.resize(nframes);
+    for (size_t f=0; f<nframes; f++) {
+        const cv::Scalar *r = &res[f*NLEVS];
 
-    return float(msssim);
+        ssim = r[0].val[0];
+
+        // overall_mssim = prod(mcs_array(1:level-1).^weight(1:level-1))*mssim_array(level);
+        msssim = r[NLEVS-1].val[0];
+        for (int l=0; l<NLEVS-1; l++)	msssim *= pow(r[l].val[1], WEIGHT[l]);
+
+        ssim_res[f] = float(ssim);
+        msssim_res[f] = float(msssim);
+    }
 }
 
 float MSSSIM::getSSIM()
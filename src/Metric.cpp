@@ -22,6 +22,7 @@
 // maintenance, support, updates, enhancements, or modifications.
 //
 
+#include <algorithm>
 #include "Metric.hpp"
 
 Metric::Metric(int h, int w)
@@ -35,6 +36,44 @@ Metric::~Metric()
 
 }
 
+void Metric::computeFrames(const std::vector<cv::Mat>& original, const std::vector<cv::Mat>& processed,
+                           std::vector<float>& results)
+{
+    results.resize(original.size());
+    for (size_t i=0; i<original.size(); i++)
+        results[i] = compute(original[i], processed[i]);
+}
+
+size_t Metric::stackFrames(int height, int width)
+{
+    size_t pixels = static_cast<size_t>(height) * static_cast<size_t>(width);
+    return pixels > 0 && pixels < STACK_PIXELS ? STACK_PIXELS / pixels : 1;
+}
+
+size_t Metric::stackFrames(const cv::Mat& frame)
+{
+    return stackFrames(frame.rows, frame.cols);
+}
+
+void Metric::stack(const std::vector<cv::Mat>& frames, size_t begin, size_t end, cv::Mat& dst)
+{
+    const cv::Mat& first = frames[begin];
+    size_t step = first.step;
+    bool contiguous = true;
+    for (size_t i=begin+1; i<end && contiguous; i++) {
+        size_t frame_step = frames[i].step;
+        contiguous = frames[i].data == first.data + (i-begin)*static_cast<size_t>(first.rows)*step
+                     && frame_step == step && frames[i].rows == first.rows && frames[i].cols == first.cols;
+    }
+    if (contiguous) {
+        dst = cv::Mat(first.rows*static_cast<int>(end-begin), first.cols, first.type(), first.data, step);
+    }
+    else {
+        std::vector<cv::Mat> parts(frames.begin()+static_cast<std::ptrdiff_t>(begin), frames.begin()+static_cast<std::ptrdiff_t>(end));
+        cv::vconcat(parts, dst);
+    }
+}
+
 void Metric::applyGaussianBlur(const cv::Mat& src, cv::Mat& dst, int ksize, double sigma)
 {
     int invalid = (ksize-1)/2;
@@ -42,3 +81,49 @@ void Metric::applyGaussianBlur(const cv::Mat& src, cv::Mat& dst, int ksize, doub
     cv::GaussianBlur(src, tmp, cv::Size(ksize,ksize), sigma);
     tmp(cv::Range(invalid, tmp.rows-invalid), cv::Range(invalid, tmp.cols-invalid)).copyTo(dst);
 }
+
+void Metric::downsample(const cv::Mat& src, cv::Mat& dst)
+{
+    int w = src.cols/2;
+    int h = src.rows/2;
+    int nc = src.channels();
+    dst.create((src.rows+1)/2, (src.cols+1)/2, src.type());
+
+    // Even part: exact 2x2 average, written in place
+    if (w > 0 && h > 0) {
+        cv::Mat even = dst(cv::Rect(0, 0, w, h));
+        cv::resize(src(cv::Rect(0, 0, 2*w, 2*h)), even, even.size(), 0, 0, cv::INTER_LINEAR);
+    }
+
+    // Last column of an odd width (and the corner)
+    if (src.cols % 2 == 1) {
+        for (int y=0; y<dst.rows; y++) {
+            const float *r0 = src.ptr<float>(2*y) + (src.cols-1)*nc;
+            const float *r1 = src.ptr<float>(std::min(2*y+1, src.rows-1)) + (src.cols-1)*nc;
+            float *d = dst.ptr<float>(y) + w*nc;
+            for (int c=0; c<nc; c++)
+                d[c] = 0.5f*(r0[c] + r1[c]);
+        }
+    }
+
+    // Last row of an odd height
+    if (src.rows % 2 == 1) {
+        const float *r = src.ptr<float>(src.rows-1);
+        float *d = dst.ptr<float>(h);
+        for (int x=0; x<w; x++) {
+            for (int c=0; c<nc; c++)
+                d[x*nc+c] = 0.5f*(r[2*x*nc+c] + r[(2*x+1)*nc+c]);
+        }
+    }
+}
+
+void Metric::decimate(const cv::Mat& src, cv::Mat& dst)
+{
+    dst.create((src.rows+1)/2, (src.cols+1)/2, CV_32F);
+    for (int y=0; y<dst.rows; y++) {
+        const float *s = src.ptr<float>(2*y);
+        float *d = dst.ptr<float>(y);
+        for (int x=0; x<dst.cols; x++)
+            d[x] = s[2*x];
+    }
+}
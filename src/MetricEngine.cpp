@@ -0,0 +1,199 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+#include "MetricEngine.hpp"
+#include "Trace.hpp"
+
+const std::map<std::string, Metrics> metric2index = {
+    {"PSNR", METRIC_PSNR},
+    {"SSIM", METRIC_SSIM},
+    {"MSSSIM", METRIC_MSSSIM},
+    {"VIFP", METRIC_VIFP},
+    {"PSNRHVS", METRIC_PSNRHVS},
+    {"PSNRHVSM", METRIC_PSNRHVSM},
+    {"VIF", METRIC_VIF},
+    {"GMSD", METRIC_GMSD},
+    {"SSIMULACRA2", METRIC_SSIMULACRA2},
+    {"WSPSNR", METRIC_WSPSNR},
+};
+
+MetricEngine::MetricEngine(int height, int width, const bool enabled_metrics[METRIC_SIZE], ThreadPool *pool)
+{
+    for (int m=0; m<METRIC_SIZE; m++)
+        enabled[m] = enabled_metrics[m];
+
+    // Only the enabled metrics are set up, SSIM coming with MS-SSIM
+    psnr   = enabled[METRIC_PSNR] ? new PSNR(height, width) : nullptr;
+    ssim   = enabled[METRIC_SSIM] && !enabled[METRIC_MSSSIM] ? new SSIM(height, width) : nullptr;
+    msssim = enabled[METRIC_MSSSIM] ? new MSSSIM(height, width, pool) : nullptr;
+    vifp   = enabled[METRIC_VIFP] ? new VIFP(height, width, pool) : nullptr;
+    vif    = enabled[METRIC_VIF] ? new VIF(height, width, pool) : nullptr;
+    gmsd   = enabled[METRIC_GMSD] ? new GMSD(height, width) : nullptr;
+    phvs   = enabled[METRIC_PSNRHVS] || enabled[METRIC_PSNRHVSM] ? new PSNRHVS(height, width) : nullptr;
+    ssimulacra2 = enabled[METRIC_SSIMULACRA2] ? new SSIMULACRA2(height, width, pool) : nullptr;
+
+    // Spherical metrics.
+    wspsnr = enabled[METRIC_WSPSNR] ? new WSPSNR(height, width) : nullptr;
+}
+
+MetricEngine::~MetricEngine()
+{
+    delete psnr;
+    delete ssim;
+    delete msssim;
+    delete vifp;
+    delete vif;
+    delete gmsd;
+    delete phvs;
+    delete ssimulacra2;
+
+    delete wspsnr;
+}
+
+bool MetricEngine::isEnabled(int metric) const
+{
+    return enabled[metric];
+}
+
+bool MetricEngine::needsColor() const
+{
+    return enabled[METRIC_SSIMULACRA2];
+}
+
+void MetricEngine::computeBatch(int first, const std::vector<cv::Mat>& original, const std::vector<cv::Mat>& processed,
+                                std::vector<float>& results)
+{
+    computeBatch(first, original, processed, original, processed, results);
+}
+
+void MetricEngine::computeBatch(int first, const std::vector<cv::Mat>& original, const std::vector<cv::Mat>& processed,
+                                const std::vector<cv::Mat>& original_rgb, const std::vector<cv::Mat>& processed_rgb,
+                                std::vector<float>& results)
+{
+    size_t n = original.size();
+    int nframes = static_cast<int>(n);
+    results.assign(n*METRIC_SIZE, 0.0f);
+
+    // Compute MS-SSIM (and SSIM, GMSD) and VIFp for the whole batch
+    if (enabled[METRIC_MSSSIM] && enabled[METRIC_GMSD]) {
+        TRACE_METRIC_START(first, METRIC_MSSSIM, nframes);
+        msssim->computeBatch(original, processed, ssim_batch, msssim_batch, *gmsd, gmsd_batch);
+        TRACE_METRIC_END(first, METRIC_MSSSIM, nframes);
+    }
+    else if (enabled[METRIC_MSSSIM]) {
+        TRACE_METRIC_START(first, METRIC_MSSSIM, nframes);
+        msssim->computeBatch(original, processed, ssim_batch, msssim_batch);
+        TRACE_METRIC_END(first, METRIC_MSSSIM, nframes);
+    }
+    if (enabled[METRIC_VIFP]) {
+        TRACE_METRIC_START(first, METRIC_VIFP, nframes);
+        vifp->computeBatch(original, processed, vifp_batch);
+        TRACE_METRIC_END(first, METRIC_VIFP, nframes);
+    }
+
+    // PSNR and SSIM (unless shared with MS-SSIM) for the whole batch, small
+    // frames being stacked into a few large kernel calls
+    if (enabled[METRIC_PSNR]) {
+        TRACE_METRIC_START(first, METRIC_PSNR, nframes);
+        psnr->computeFrames(original, processed, psnr_batch);
+        TRACE_METRIC_END(first, METRIC_PSNR, nframes);
+    }
+    if (enabled[METRIC_SSIM] && !enabled[METRIC_MSSSIM]) {
+        TRACE_METRIC_START(first, METRIC_SSIM, nframes);
+        ssim->computeFrames(original, processed, ssim_batch);
+        TRACE_METRIC_END(first, METRIC_SSIM, nframes);
+    }
+    // Same for GMSD (unless shared with MS-SSIM) and PSNR-HVS
+    if (enabled[METRIC_GMSD] && !enabled[METRIC_MSSSIM]) {
+        TRACE_METRIC_START(first, METRIC_GMSD, nframes);
+        gmsd->computeFrames(original, processed, gmsd_batch);
+        TRACE_METRIC_END(first, METRIC_GMSD, nframes);
+    }
+    if (enabled[METRIC_PSNRHVS] || enabled[METRIC_PSNRHVSM]) {
+        TRACE_METRIC_START(first, METRIC_PSNRHVS, nframes);
+        phvs->computeBatch(original, processed, psnrhvsm_batch, psnrhvs_batch);
+        TRACE_METRIC_END(first, METRIC_PSNRHVS, nframes);
+    }
+
+    for (size_t i=0; i<n; i++) {
+        const cv::Mat& original_frame = original[i];
+        const cv::Mat& processed_frame = processed[i];
+        float *result = &results[i*METRIC_SIZE];
+        int frame = first+static_cast<int>(i);
+
+        // PSNR,
+        if (enabled[METRIC_PSNR]) {
+            result[METRIC_PSNR] = psnr_batch[i];
+        }
+
+        // SSIM and MS-SSIM
+        if (enabled[METRIC_SSIM]) {
+            result[METRIC_SSIM] = ssim_batch[i];
+        }
+
+        if (enabled[METRIC_MSSSIM]) {
+            result[METRIC_MSSSIM] = msssim_batch[i];
+        }
+
+        // VIFp,
+        if (enabled[METRIC_VIFP]) {
+            result[METRIC_VIFP] = vifp_batch[i];
+        }
+
+        // GMSD,
+        if (enabled[METRIC_GMSD]) {
+            result[METRIC_GMSD] = gmsd_batch[i];
+        }
+
+        // Compute VIF,
+        if (enabled[METRIC_VIF]) {
+            TRACE_METRIC_START(frame, METRIC_VIF, 1);
+            result[METRIC_VIF] = vif->compute(original_frame, processed_frame);
+            TRACE_METRIC_END(frame, METRIC_VIF, 1);
+        }
+
+        // Compute SSIMULACRA 2, on colour frames when given
+        if (enabled[METRIC_SSIMULACRA2]) {
+            TRACE_METRIC_START(frame, METRIC_SSIMULACRA2, 1);
+            result[METRIC_SSIMULACRA2] = ssimulacra2->compute(original_rgb[i], processed_rgb[i]);
+            TRACE_METRIC_END(frame, METRIC_SSIMULACRA2, 1);
+        }
+
+        // PSNR-HVS and PSNR-HVS-M,
+        if (enabled[METRIC_PSNRHVS]) {
+            result[METRIC_PSNRHVS] = psnrhvs_batch[i];
+        }
+
+        if (enabled[METRIC_PSNRHVSM]) {
+            result[METRIC_PSNRHVSM] = psnrhvsm_batch[i];
+        }
+
+        // Compute WSPSNR,
+        if (enabled[METRIC_WSPSNR]) {
+            TRACE_METRIC_START(frame, METRIC_WSPSNR, 1);
+            result[METRIC_WSPSNR] = wspsnr->compute(original_frame, processed_frame);
+            TRACE_METRIC_END(frame, METRIC_WSPSNR, 1);
+        }
+    }
+}
@@ -0,0 +1,441 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "NoReference.hpp"
+
+// Tabulated shapes of the GGD
+static const double SHAPE_MIN = 0.2;
+static const double SHAPE_STEP = 0.001;
+static const int SHAPE_COUNT = 9801;
+
+// Moments of a set of coefficients, for the GGD and AGGD fits
+struct Moments {
+    double n;
+    double abs_sum;
+    double sq_sum;
+    double left_n, left_sq;
+    double right_n, right_sq;
+};
+
+// Accumulate the moments of a (products of b if given, with the same size)
+static void accumulate(const cv::Mat& a, const cv::Mat *b, Moments& m)
+{
+    m = Moments();
+    for (int y=0; y<a.rows; y++) {
+        const float *pa = a.ptr<float>(y);
+        const float *pb = b != nullptr ? b->ptr<float>(y) : nullptr;
+        // Per row in float, so that the loop vectorizes
+        float abs_sum = 0.0f, left_sq = 0.0f, right_sq = 0.0f, left_n = 0.0f, right_n = 0.0f;
+        for (int x=0; x<a.cols; x++) {
+            float v = pb != nullptr ? pa[x]*pb[x] : pa[x];
+            float sq = v*v;
+            float neg = v < 0.0f ? 1.0f : 0.0f;
+            float pos = v > 0.0f ? 1.0f : 0.0f;
+            abs_sum += fabsf(v);
+            left_sq += neg*sq;
+            right_sq += pos*sq;
+            left_n += neg;
+            right_n += pos;
+        }
+        m.abs_sum += static_cast<double>(abs_sum);
+        m.left_sq += static_cast<double>(left_sq);
+        m.right_sq += static_cast<double>(right_sq);
+        m.left_n += static_cast<double>(left_n);
+        m.right_n += static_cast<double>(right_n);
+    }
+    m.n = static_cast<double>(a.rows)*a.cols;
+    m.sq_sum = m.left_sq + m.right_sq;
+}
+
+// Index of the sample i in a line of n samples mirrored at both ends, the
+// edge sample repeated
+static int mirror(int i, int n)
+{
+    while (i < 0 || i >= n)
+        i = i < 0 ? -i-1 : 2*n-i-1;
+    return i;
+}
+
+// Half-size image as MATLAB's imresize(im, 0.5) of the reference code: the
+// bicubic kernel is stretched by 2 (antialiasing), so each sample is the
+// weighted sum of the 8 inputs around 2i+0.5
+static void halve(const cv::Mat& src, cv::Mat& dst)
+{
+    static const float taps[8] = {-0.01171875f, -0.03515625f, 0.11328125f, 0.43359375f,
+                                  0.43359375f, 0.11328125f, -0.03515625f, -0.01171875f};
+    int rows = (src.rows+1)/2, cols = (src.cols+1)/2;
+
+    std::vector<int> index(static_cast<size_t>(8*std::max(rows, cols)));
+    for (int x=0; x<cols; x++) {
+        for (int k=0; k<8; k++)
+            index[static_cast<size_t>(8*x+k)] = mirror(2*x-3+k, src.cols);
+    }
+    cv::Mat horizontal(src.rows, cols, CV_32F);
+    for (int y=0; y<src.rows; y++) {
+        const float *in = src.ptr<float>(y);
+        float *out = horizontal.ptr<float>(y);
+        for (int x=0; x<cols; x++) {
+            const int *i = &index[static_cast<size_t>(8*x)];
+            float sum = 0.0f;
+            for (int k=0; k<8; k++)
+                sum += taps[k]*in[i[k]];
+            out[x] = sum;
+        }
+    }
+
+    dst.create(rows, cols, CV_32F);
+    for (int y=0; y<rows; y++) {
+        float *out = dst.ptr<float>(y);
+        std::fill(out, out+cols, 0.0f);
+        for (int k=0; k<8; k++) {
+            const float *in = horizontal.ptr<float>(mirror(2*y-3+k, src.rows));
+            for (int x=0; x<cols; x++)
+                out[x] += taps[k]*in[x];
+        }
+    }
+}
+
+NoReference::NoReference(int h, int w)
+{
+    height = h;
+    width = w;
+    svr_gamma = svr_rho = 0.0;
+    range_lower = -1.0;
+    range_upper = 1.0;
+
+    // Gamma(1/a)Gamma(3/a)/Gamma(2/a)^2, decreasing with the shape a
+    ratios.resize(SHAPE_COUNT);
+    for (int i=0; i<SHAPE_COUNT; i++) {
+        double a = SHAPE_MIN + i*SHAPE_STEP;
+        ratios[static_cast<size_t>(i)] = exp(lgamma(1.0/a) + lgamma(3.0/a) - 2.0*lgamma(2.0/a));
+    }
+}
+
+double NoReference::shape(double ratio, bool inverse) const
+{
+    // Binary search in the decreasing table, then the closest neighbour in
+    // the domain the reference code compares in
+    double target = inverse ? 1.0/ratio : ratio;
+    size_t lo = 0, hi = ratios.size()-1;
+    while (hi - lo > 1) {
+        size_t mid = (lo+hi)/2;
+        if (ratios[mid] > target)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    double lo_error = inverse ? fabs(1.0/ratios[lo]-ratio) : fabs(ratios[lo]-ratio);
+    double hi_error = inverse ? fabs(1.0/ratios[hi]-ratio) : fabs(ratios[hi]-ratio);
+    size_t best = lo_error <= hi_error ? lo : hi;
+    return SHAPE_MIN + static_cast<double>(best)*SHAPE_STEP;
+}
+
+void NoReference::analyze(const cv::Mat& luma)
+{
+    cv::Mat scaled[2];
+    scaled[0] = luma;
+    halve(luma, scaled[1]);
+
+    for (int s=0; s<2; s++) {
+        // mu = w*I, sigma = sqrt(|w*I^2 - mu^2|), MSCN = (I-mu)/(sigma+1),
+        // the borders of a region of a frame replicated as those of a frame
+        cv::Mat mu, mu_sq, sq;
+        cv::GaussianBlur(scaled[s], mu, cv::Size(7,7), 7.0/6.0, 7.0/6.0, cv::BORDER_REPLICATE | cv::BORDER_ISOLATED);
+        cv::GaussianBlur(scaled[s].mul(scaled[s]), sq, cv::Size(7,7), 7.0/6.0, 7.0/6.0, cv::BORDER_REPLICATE);
+        mu_sq = mu.mul(mu);
+        cv::absdiff(sq, mu_sq, sigma[s]);
+        cv::sqrt(sigma[s], sigma[s]);
+        cv::subtract(scaled[s], mu, mscn[s]);
+        cv::divide(mscn[s], sigma[s] + 1.0, mscn[s]);
+    }
+}
+
+void NoReference::features(const cv::Mat& coefs, float *f, bool niqe) const
+{
+    // AGGD of moments: shape, left and right deviations, and the factor
+    // from deviations to AGGD scales
+    double a, left, right, scale;
+    auto aggd = [&](const Moments& m) {
+        left = m.left_n > 0.0 ? sqrt(m.left_sq / m.left_n) : 0.0;
+        right = m.right_n > 0.0 ? sqrt(m.right_sq / m.right_n) : 0.0;
+        a = SHAPE_MIN;
+        if (left > 0.0 && right > 0.0 && m.abs_sum > 0.0) {
+            double gamma = left / right;
+            double r = (m.abs_sum/m.n)*(m.abs_sum/m.n) / (m.sq_sum/m.n);
+            a = shape(r*(gamma*gamma*gamma + 1.0)*(gamma + 1.0) / ((gamma*gamma + 1.0)*(gamma*gamma + 1.0)), true);
+        }
+        scale = sqrt(exp(lgamma(1.0/a) - lgamma(3.0/a)));
+    };
+
+    // Coefficients: GGD shape and variance (BRISQUE), or AGGD shape and
+    // mean scale (NIQE)
+    Moments m;
+    accumulate(coefs, nullptr, m);
+    if (niqe) {
+        aggd(m);
+        f[0] = static_cast<float>(a);
+        f[1] = static_cast<float>((left + right)*scale/2.0);
+    }
+    else {
+        double mean_abs = m.abs_sum / m.n;
+        double variance = m.sq_sum / m.n;
+        f[0] = static_cast<float>(mean_abs > 0.0 ? shape(variance / (mean_abs*mean_abs), false) : SHAPE_MIN);
+        f[1] = static_cast<float>(variance);
+    }
+
+    // AGGD of the products with the horizontal, vertical, main and
+    // secondary diagonal neighbours, wrapping around the region: shape,
+    // mean, and left and right variances (BRISQUE) or scales (NIQE)
+    int rows = coefs.rows, cols = coefs.cols;
+    cv::Mat wrapped;
+    cv::copyMakeBorder(coefs, wrapped, 1, 1, 1, 1, cv::BORDER_WRAP | cv::BORDER_ISOLATED);
+    static const int shifts[4][2] = {{0,1}, {1,0}, {1,1}, {1,-1}};
+    for (int o=0; o<4; o++) {
+        cv::Mat shifted = wrapped(cv::Rect(1-shifts[o][1], 1-shifts[o][0], cols, rows));
+        accumulate(coefs, &shifted, m);
+        aggd(m);
+        double mean = 0.0;
+        if (left > 0.0 && right > 0.0 && m.abs_sum > 0.0)
+            mean = (right - left)*exp(lgamma(2.0/a) - lgamma(1.0/a))*scale;
+        f[2+o*4]   = static_cast<float>(a);
+        f[2+o*4+1] = static_cast<float>(mean);
+        f[2+o*4+2] = static_cast<float>(niqe ? left*scale : left*left);
+        f[2+o*4+3] = static_cast<float>(niqe ? right*scale : right*right);
+    }
+}
+
+void NoReference::frameFeatures(float f[NFEATURES]) const
+{
+    features(mscn[0], f, false);
+    features(mscn[1], f + NFEATURES/2, false);
+}
+
+cv::Rect NoReference::patchArea() const
+{
+    return cv::Rect(0, 0, width/PATCH_SIZE*PATCH_SIZE, height/PATCH_SIZE*PATCH_SIZE);
+}
+
+void NoReference::patchFeatures(std::vector<float>& f, std::vector<float>& sharpness) const
+{
+    f.clear();
+    sharpness.clear();
+    int half = PATCH_SIZE/2;
+    for (int y=0; y+PATCH_SIZE<=height; y+=PATCH_SIZE) {
+        for (int x=0; x+PATCH_SIZE<=width; x+=PATCH_SIZE) {
+            size_t offset = f.size();
+            f.resize(offset + NFEATURES);
+            features(mscn[0](cv::Rect(x, y, PATCH_SIZE, PATCH_SIZE)), &f[offset], true);
+            features(mscn[1](cv::Rect(x/2, y/2, half, half)), &f[offset + NFEATURES/2], true);
+            sharpness.push_back(static_cast<float>(cv::mean(sigma[0](cv::Rect(x, y, PATCH_SIZE, PATCH_SIZE))).val[0]));
+        }
+    }
+}
+
+void NoReference::fit(const std::vector<float>& f, cv::Mat& mu, cv::Mat& cov)
+{
+    int n = static_cast<int>(f.size()) / NFEATURES;
+    cv::Mat samples;
+    cv::Mat(n, NFEATURES, CV_32F, const_cast<float *>(&f[0])).convertTo(samples, CV_64F);
+    cv::calcCovarMatrix(samples, cov, mu, cv::COVAR_NORMAL | cv::COVAR_ROWS, CV_64F);
+    // Unbiased estimate
+    if (n > 1)
+        cov /= static_cast<double>(n-1);
+}
+
+bool NoReference::saveModel(const std::string& path, const std::vector<float>& f)
+{
+    if (f.size() < 2*static_cast<size_t>(NFEATURES)) {
+        fprintf(stderr, "NR: not enough patches to train a model.\n");
+        return false;
+    }
+    cv::Mat mu, cov;
+    fit(f, mu, cov);
+
+    FILE *file = fopen(path.c_str(), "w");
+    if (file == nullptr) {
+        fprintf(stderr, "NR: cannot create model file (%s)\n", path.c_str());
+        return false;
+    }
+    // "NIQE n", then the mean and the n rows of the covariance
+    fprintf(file, "NIQE %d\n", NFEATURES);
+    for (int i=0; i<NFEATURES; i++)
+        fprintf(file, "%.9g%c", mu.at<double>(0,i), i < NFEATURES-1 ? ' ' : '\n');
+    for (int r=0; r<NFEATURES; r++) {
+        for (int i=0; i<NFEATURES; i++)
+            fprintf(file, "%.9g%c", cov.at<double>(r,i), i < NFEATURES-1 ? ' ' : '\n');
+    }
+    fclose(file);
+    return true;
+}
+
+bool NoReference::loadModel(const std::string& path)
+{
+    FILE *file = fopen(path.c_str(), "r");
+    if (file == nullptr) {
+        fprintf(stderr, "NR: cannot open model file (%s)\n", path.c_str());
+        return false;
+    }
+    int n = 0;
+    bool ok = fscanf(file, "NIQE %d", &n) == 1 && n == NFEATURES;
+    model_mu = cv::Mat(1, NFEATURES, CV_64F);
+    model_cov = cv::Mat(NFEATURES, NFEATURES, CV_64F);
+    for (int i=0; ok && i<NFEATURES; i++)
+        ok = fscanf(file, "%lf", &model_mu.at<double>(0,i)) == 1;
+    for (int i=0; ok && i<NFEATURES*NFEATURES; i++)
+        ok = fscanf(file, "%lf", &model_cov.at<double>(i/NFEATURES, i%NFEATURES)) == 1;
+    fclose(file);
+    if (!ok) {
+        fprintf(stderr, "NR: invalid model file (%s)\n", path.c_str());
+        model_mu.release();
+        model_cov.release();
+    }
+    return ok;
+}
+
+float NoReference::niqe(const std::vector<float>& f) const
+{
+    cv::Mat mu, cov;
+    fit(f, mu, cov);
+
+    // sqrt((mu1-mu2)' ((cov1+cov2)/2)^-1 (mu1-mu2)), pseudo-inverse
+    cv::Mat diff = model_mu - mu;
+    cv::Mat inv;
+    cv::invert((model_cov + cov) * 0.5, inv, cv::DECOMP_SVD);
+    cv::Mat d = diff * inv * diff.t();
+    return static_cast<float>(sqrt(std::max(d.at<double>(0,0), 0.0)));
+}
+
+bool NoReference::loadRegressor(const std::string& model, const std::string& range)
+{
+    // libsvm model: "key value" header lines up to "SV", then one line per
+    // support vector, "coef index:value ..."
+    std::ifstream model_file(model.c_str());
+    if (!model_file) {
+        fprintf(stderr, "NR: cannot open BRISQUE model file (%s)\n", model.c_str());
+        return false;
+    }
+    bool ok = false, rbf = false;
+    std::string line;
+    while (std::getline(model_file, line)) {
+        std::istringstream fields(line);
+        std::string key, value;
+        fields >> key >> value;
+        if (key == "SV") {
+            ok = true;
+            break;
+        }
+        if (key == "kernel_type")
+            rbf = value == "rbf";
+        else if (key == "gamma")
+            svr_gamma = atof(value.c_str());
+        else if (key == "rho")
+            svr_rho = atof(value.c_str());
+    }
+    if (!ok || !rbf) {
+        fprintf(stderr, "NR: invalid BRISQUE model file (%s), an RBF SVR is expected\n", model.c_str());
+        return false;
+    }
+    std::vector<double> vectors;
+    support_coefs.clear();
+    while (std::getline(model_file, line)) {
+        std::istringstream fields(line);
+        double coef;
+        if (!(fields >> coef))
+            continue;
+        support_coefs.push_back(coef);
+        vectors.resize(vectors.size() + NFEATURES, 0.0);
+        int index;
+        char colon;
+        double value;
+        while (fields >> index >> colon >> value) {
+            if (index >= 1 && index <= NFEATURES)
+                vectors[vectors.size() - NFEATURES + static_cast<size_t>(index-1)] = value;
+        }
+    }
+    if (support_coefs.empty()) {
+        fprintf(stderr, "NR: no support vector in the BRISQUE model file (%s)\n", model.c_str());
+        return false;
+    }
+    support = cv::Mat(static_cast<int>(support_coefs.size()), NFEATURES, CV_64F, &vectors[0]).clone();
+
+    // svm-scale ranges: an optional "y" section, then "x", the target
+    // range, and "index min max" lines
+    std::ifstream range_file(range.c_str());
+    if (!range_file) {
+        fprintf(stderr, "NR: cannot open BRISQUE range file (%s)\n", range.c_str());
+        return false;
+    }
+    std::string section;
+    range_file >> section;
+    if (section == "y") {
+        double skip;
+        range_file >> skip >> skip >> skip >> skip >> section;
+    }
+    ok = section == "x" && static_cast<bool>(range_file >> range_lower >> range_upper);
+    // A feature without range is left out (0), as by svm-scale
+    feature_min.assign(NFEATURES, 0.0);
+    feature_max.assign(NFEATURES, 0.0);
+    int index;
+    double lo, hi;
+    while (ok && range_file >> index >> lo >> hi) {
+        if (index >= 1 && index <= NFEATURES) {
+            feature_min[static_cast<size_t>(index-1)] = lo;
+            feature_max[static_cast<size_t>(index-1)] = hi;
+        }
+    }
+    if (!ok) {
+        fprintf(stderr, "NR: invalid BRISQUE range file (%s)\n", range.c_str());
+        support.release();
+    }
+    return ok;
+}
+
+float NoReference::brisque(const float f[NFEATURES]) const
+{
+    // Features scaled as by svm-scale (not clamped to the range)
+    double x[NFEATURES];
+    for (int i=0; i<NFEATURES; i++) {
+        double lo = feature_min[static_cast<size_t>(i)], hi = feature_max[static_cast<size_t>(i)];
+        x[i] = hi > lo ? range_lower + (range_upper-range_lower)*(static_cast<double>(f[i])-lo)/(hi-lo) : 0.0;
+    }
+
+    // SVR: sum of coef*exp(-gamma*|x-sv|^2) - rho
+    double score = -svr_rho;
+    for (int r=0; r<support.rows; r++) {
+        const double *sv = support.ptr<double>(r);
+        double distance = 0.0;
+        for (int i=0; i<NFEATURES; i++)
+            distance += (x[i]-sv[i])*(x[i]-sv[i]);
+        score += support_coefs[static_cast<size_t>(r)]*exp(-svr_gamma*distance);
+    }
+    return static_cast<float>(score);
+}
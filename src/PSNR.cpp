@@ -22,6 +22,7 @@
 // maintenance, support, updates, enhancements, or modifications.
 //
 
+#include <algorithm>
 #include "PSNR.hpp"
 
 PSNR::PSNR(int h, int w) : Metric(h, w)
@@ -30,8 +31,33 @@ PSNR::PSNR(int h, int w) : Metric(h, w)
 
 float PSNR::compute(const cv::Mat& original, const cv::Mat& processed)
 {
-    cv::Mat tmp(height,width,CV_32F);
+    cv::Mat tmp(original.rows,original.cols,CV_32F);
     cv::subtract(original, processed, tmp);
     cv::multiply(tmp, tmp, tmp);
     return float(10*log10(255*255/cv::mean(tmp).val[0]));
 }
+
+void PSNR::computeFrames(const std::vector<cv::Mat>& original, const std::vector<cv::Mat>& processed,
+                         std::vector<float>& results)
+{
+    results.resize(original.size());
+    if (original.empty())
+        return;
+
+    size_t per_stack = stackFrames(original[0]);
+    int h = original[0].rows;
+    double pixels = static_cast<double>(original[0].rows) * original[0].cols;
+    cv::Mat a, b, tmp;
+    for (size_t begin=0; begin<original.size(); begin+=per_stack) {
+        size_t end = std::min(begin+per_stack, original.size());
+        stack(original, begin, end, a);
+        stack(processed, begin, end, b);
+        cv::subtract(a, b, tmp);
+        cv::multiply(tmp, tmp, tmp);
+        for (size_t i=begin; i<end; i++) {
+            int y = static_cast<int>(i-begin)*h;
+            double mse = cv::sum(tmp.rowRange(y, y+h)).val[0] / pixels;
+            results[i] = float(10*log10(255*255/mse));
+        }
+    }
+}
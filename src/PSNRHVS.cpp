@@ -39,6 +39,7 @@
 //   Processing and Quality Metrics for Consumer Electronics, January 2007.
 //
 
+#include <algorithm>
 #include <cfloat>
 #include "PSNRHVS.hpp"
 
@@ -62,6 +63,13 @@ const float PSNRHVS::MASK[8][8] =	{{0.390625f, 0.826446f, 1.000000f, 0.390625f,
 
 PSNRHVS::PSNRHVS(int h, int w) : Metric(h, w)
 {
+    // Orthonormal DCT-II basis, as dct2 (and cv::dct) on 8x8 blocks
+    dct_matrix.create(8, 8, CV_32F);
+    for (int k=0; k<8; k++) {
+        double c = k == 0 ? sqrt(1.0/8.0) : sqrt(2.0/8.0);
+        for (int n=0; n<8; n++)
+            dct_matrix.at<float>(k,n) = static_cast<float>(c*cos(M_PI*(2*n+1)*k/16.0));
+    }
 }
 
 float PSNRHVS::getPSNRHVS()
@@ -76,61 +84,162 @@ float PSNRHVS::getPSNRHVSM()
 
 float PSNRHVS::compute(const cv::Mat& original, const cv::Mat& processed)
 {
+    int h = original.rows;
+    int w = original.cols;
     float s1 = 0.0f;
     float s2 = 0.0f;
-    float num = static_cast<float>(width*height);
-    float tmp;
     cv::Mat a(8,8,CV_32F), b(8,8,CV_32F), a_dct(8,8,CV_32F), b_dct(8,8,CV_32F);
+    cv::Mat a_part(8,8,CV_32F), b_part(8,8,CV_32F);
 
-    for (int y=0; y<height; y+=8) {
-        for (int x=0; x<width; x+=8) {
-            // a = img1(y:y+7,x:x+7);
-            a = original(cv::Range(y,y+8),cv::Range(x,x+8));
-            // b = img2(y:y+7,x:x+7);
-            b = processed(cv::Range(y,y+8),cv::Range(x,x+8));
+    for (int y=0; y<h; y+=8) {
+        for (int x=0; x<w; x+=8) {
+            int bh = h-y < 8 ? h-y : 8;
+            int bw = w-x < 8 ? w-x : 8;
+            if (bh == 8 && bw == 8) {
+                // a = img1(y:y+7,x:x+7);
+                a = original(cv::Range(y,y+8),cv::Range(x,x+8));
+                // b = img2(y:y+7,x:x+7);
+                b = processed(cv::Range(y,y+8),cv::Range(x,x+8));
+            }
+            else {
+                // Partial block at the right or bottom edge, completed by
+                // replicating its last column and row
+                cv::copyMakeBorder(original(cv::Rect(x,y,bw,bh)), a_part, 0, 8-bh, 0, 8-bw, cv::BORDER_REPLICATE);
+                cv::copyMakeBorder(processed(cv::Rect(x,y,bw,bh)), b_part, 0, 8-bh, 0, 8-bw, cv::BORDER_REPLICATE);
+                a = a_part;
+                b = b_part;
+            }
             // a_dct = dct2(a);
             cv::dct(a, a_dct);
             // b_dct = dct2(b);
             cv::dct(b, b_dct);
+            // The errors of a partial block count for its actual pixels
+            scoreBlock(a, b, a_dct, b_dct, static_cast<float>(bh*bw) / 64.0f, s1, s2);
+        }
+    }
+
+    toPSNR(s1, s2, static_cast<float>(h*w), psnrhvsm, psnrhvs);
+    return psnrhvsm;
+}
+
+void PSNRHVS::computeBatch(const std::vector<cv::Mat>& original, const std::vector<cv::Mat>& processed,
+                           std::vector<float>& results_hvsm, std::vector<float>& results_hvs)
+{
+    size_t n = original.size();
+    results_hvsm.resize(n);
+    results_hvs.resize(n);
+    if (n == 0)
+        return;
+
+    // Frames completed to whole blocks by replicating their last column and
+    // row, which gives the partial blocks of compute()
+    int h = original[0].rows;
+    int w = original[0].cols;
+    int padded_h = (h+7)/8*8;
+    int padded_w = (w+7)/8*8;
+    bool whole = padded_h == h && padded_w == w;
+
+    size_t per_stack = stackFrames(original[0]);
+    cv::Mat a, b, a_dct, b_dct;
+    for (size_t begin=0; begin<n; begin+=per_stack) {
+        size_t end = std::min(begin+per_stack, n);
+        if (whole) {
+            stack(original, begin, end, a);
+            stack(processed, begin, end, b);
+        }
+        else {
+            a.create(static_cast<int>(end-begin)*padded_h, padded_w, CV_32F);
+            b.create(static_cast<int>(end-begin)*padded_h, padded_w, CV_32F);
+            for (size_t i=begin; i<end; i++) {
+                int y = static_cast<int>(i-begin)*padded_h;
+                cv::Mat a_frame = a.rowRange(y, y+padded_h);
+                cv::Mat b_frame = b.rowRange(y, y+padded_h);
+                cv::copyMakeBorder(original[i], a_frame, 0, padded_h-h, 0, padded_w-w, cv::BORDER_REPLICATE);
+                cv::copyMakeBorder(processed[i], b_frame, 0, padded_h-h, 0, padded_w-w, cv::BORDER_REPLICATE);
+            }
+        }
+        // The DCTs of all the blocks of the stack in a few large calls
+        blockDCT(a, a_dct);
+        blockDCT(b, b_dct);
+
+        for (size_t i=begin; i<end; i++) {
+            int top = static_cast<int>(i-begin)*padded_h;
+            float s1 = 0.0f;
+            float s2 = 0.0f;
+            for (int y=0; y<h; y+=8) {
+                for (int x=0; x<w; x+=8) {
+                    int bh = h-y < 8 ? h-y : 8;
+                    int bw = w-x < 8 ? w-x : 8;
+                    cv::Rect block(x, top+y, 8, 8);
+                    scoreBlock(a(block), b(block), a_dct(block), b_dct(block), static_cast<float>(bh*bw) / 64.0f, s1, s2);
+                }
+            }
+            toPSNR(s1, s2, static_cast<float>(h*w), results_hvsm[i], results_hvs[i]);
+        }
+    }
+}
+
+void PSNRHVS::blockDCT(const cv::Mat& src, cv::Mat& dst)
+{
+    cv::Mat img = src.isContinuous() ? src : src.clone();
+    cv::Mat rows_dct, transposed;
+    // Rows of the blocks: each row of the image is cols/8 segments of 8
+    // samples, transformed by a single product
+    cv::gemm(img.reshape(1, static_cast<int>(img.total()/8)), dct_matrix, 1.0, cv::Mat(), 0.0, rows_dct, cv::GEMM_2_T);
+    // Columns of the blocks, as the rows of the transposed image
+    cv::transpose(rows_dct.reshape(1, img.rows), transposed);
+    cv::gemm(transposed.reshape(1, static_cast<int>(transposed.total()/8)), dct_matrix, 1.0, cv::Mat(), 0.0, rows_dct, cv::GEMM_2_T);
+    cv::transpose(rows_dct.reshape(1, transposed.rows), dst);
+}
+
+void PSNRHVS::scoreBlock(const cv::Mat& a, const cv::Mat& b, const cv::Mat& a_dct, const cv::Mat& b_dct,
+                         float weight, float& s1, float& s2)
+{
+    float tmp;
+    float block_s1 = 0.0f;
+    float block_s2 = 0.0f;
 
-            // mask_a = maskeff(a,a_dct);
-            float mask_a = maskeff(a,a_dct);
-            // mask_b = maskeff(b,b_dct);
-            float mask_b = maskeff(b,b_dct);
-
-            // if mask_b > mask_a: mask_a = mask_b;
-            mask_a = mask_b > mask_a ? mask_b : mask_a;
-
-            for (int k=0; k<8; k++) {
-                const float *ptr_a = a_dct.ptr<float>(k);
-                const float *ptr_b = b_dct.ptr<float>(k);
-                for (int l=0; l<8; l++) {
-                    // u = abs(a_dct(k,l)-b_dct(k,l));
-                    float u = std::abs(*ptr_a++ - *ptr_b++);
-                    // s2 = s2 + (u*CSF(k,l)).^2;
-                    tmp = u*CSF[k][l];
-                    s2 += tmp*tmp;
-                    // if (k~=1) | (l~=1)
-                    if (k != 0 || l !=0) {
-                        // if u < mask_a/mask(k,l)
-                        tmp = mask_a/MASK[k][l];
-                        if (u < tmp) {
-                            // u = 0;
-                            u = 0;
-                        }
-                        else {
-                            // u = u - mask_a/mask(k,l);
-                            u -= tmp;
-                        }
-                    }
-                    // s1 = s1 + (u*CSF(k,l)).^2;
-                    tmp = u*CSF[k][l];
-                    s1 += tmp*tmp;
+    // mask_a = maskeff(a,a_dct);
+    float mask_a = maskeff(a,a_dct);
+    // mask_b = maskeff(b,b_dct);
+    float mask_b = maskeff(b,b_dct);
+
+    // if mask_b > mask_a: mask_a = mask_b;
+    mask_a = mask_b > mask_a ? mask_b : mask_a;
+
+    for (int k=0; k<8; k++) {
+        const float *ptr_a = a_dct.ptr<float>(k);
+        const float *ptr_b = b_dct.ptr<float>(k);
+        for (int l=0; l<8; l++) {
+            // u = abs(a_dct(k,l)-b_dct(k,l));
+            float u = std::abs(*ptr_a++ - *ptr_b++);
+            // s2 = s2 + (u*CSF(k,l)).^2;
+            tmp = u*CSF[k][l];
+            block_s2 += tmp*tmp;
+            // if (k~=1) | (l~=1)
+            if (k != 0 || l !=0) {
+                // if u < mask_a/mask(k,l)
+                tmp = mask_a/MASK[k][l];
+                if (u < tmp) {
+                    // u = 0;
+                    u = 0;
+                }
+                else {
+                    // u = u - mask_a/mask(k,l);
+                    u -= tmp;
                 }
             }
+            // s1 = s1 + (u*CSF(k,l)).^2;
+            tmp = u*CSF[k][l];
+            block_s1 += tmp*tmp;
         }
     }
+    s1 += weight*block_s1;
+    s2 += weight*block_s2;
+}
 
+void PSNRHVS::toPSNR(float s1, float s2, float num, float& hvsm, float& hvs)
+{
     // s1 = s1/num;
     s1 /= num;
     // s2 = s2/num;
@@ -138,12 +247,10 @@ float PSNRHVS::compute(const cv::Mat& original, const cv::Mat& processed)
 
     // if s1 == 0: p_hvs_m = 100000;
     // else: p_hvs_m = 10*log10(255*255/s1);
-    psnrhvsm = s1 <= FLT_EPSILON ? 100000.0f : float(10*log10(255*255/s1));
+    hvsm = s1 <= FLT_EPSILON ? 100000.0f : float(10*log10(255*255/s1));
     // if s2 == 0: p_hvs = 100000;
     // else: p_hvs = 10*log10(255*255/s2);
-    psnrhvs = s2 <= FLT_EPSILON ? 100000.0f : float(10*log10(255*255/s2));
-
-    return psnrhvsm;
+    hvs = s2 <= FLT_EPSILON ? 100000.0f : float(10*log10(255*255/s2));
 }
 
 float PSNRHVS::maskeff(const cv::Mat &z, const cv::Mat &zdct)
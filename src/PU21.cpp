@@ -0,0 +1,94 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+//
+// Please refer to the following paper:
+// - R.K. Mantiuk and M. Azimi, "PU21: A novel perceptually uniform encoding
+//   for adapting existing quality metrics for HDR," Picture Coding
+//   Symposium (PCS), 2021.
+//
+
+#include <math.h>
+
+#include "PU21.hpp"
+
+// Parameters of the banding + glare variant
+const double PU21::PAR[7] = {0.353487901, 0.3734658629, 8.277049286e-05, 0.9062562627,
+                             0.09150303166, 0.9099517204, 596.3148142};
+const double PU21::L_MIN = 0.005;
+const double PU21::L_MAX = 10000.0;
+
+float PU21::encode(double luminance)
+{
+    double y = luminance < L_MIN ? L_MIN : (luminance > L_MAX ? L_MAX : luminance);
+    double yp = pow(y, PAR[3]);
+    return float(PAR[6] * (pow((PAR[0] + PAR[1]*yp) / (1.0 + PAR[2]*yp), PAR[4]) - PAR[5]));
+}
+
+double PU21::pqToLuminance(double signal)
+{
+    // SMPTE ST 2084 EOTF
+    const double m1 = 2610.0/16384.0;
+    const double m2 = 2523.0/4096.0*128.0;
+    const double c1 = 3424.0/4096.0;
+    const double c2 = 2413.0/4096.0*32.0;
+    const double c3 = 2392.0/4096.0*32.0;
+
+    double ep = pow(signal, 1.0/m2);
+    double num = ep - c1 > 0.0 ? ep - c1 : 0.0;
+    return 10000.0 * pow(num / (c2 - c3*ep), 1.0/m1);
+}
+
+double PU21::hlgToLuminance(double signal)
+{
+    // BT.2100 inverse OETF
+    const double a = 0.17883277;
+    const double b = 1.0 - 4.0*a;
+    const double c = 0.5 - a*log(4.0*a);
+    double e = signal <= 0.5 ? signal*signal/3.0 : (exp((signal-c)/a) + b) / 12.0;
+
+    // OOTF on luma, nominal 1000 cd/m2 display (gamma 1.2)
+    return 1000.0 * pow(e, 1.2);
+}
+
+std::vector<float> PU21::lut(int bitdepth, int transfer, bool full_range)
+{
+    size_t ncodes = size_t(1) << bitdepth;
+    double scale = static_cast<double>(1 << (bitdepth-8));
+    std::vector<float> table(ncodes);
+
+    for (size_t code=0; code<ncodes; code++) {
+        double v = static_cast<double>(code);
+        if (transfer == TRANSFER_SDR) {
+            table[code] = float(v / scale);
+            continue;
+        }
+        double signal = full_range ? v / static_cast<double>(ncodes-1) : (v/scale - 16.0) / 219.0;
+        signal = signal < 0.0 ? 0.0 : (signal > 1.0 ? 1.0 : signal);
+        double luminance = transfer == TRANSFER_PQ ? pqToLuminance(signal) : hlgToLuminance(signal);
+        table[code] = encode(luminance);
+    }
+
+    return table;
+}
@@ -0,0 +1,116 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+#include "ReadScheduler.hpp"
+
+ReadScheduler::ReadScheduler(VideoYUV *orig, VideoYUV *proc, int nbframes, size_t budget)
+{
+    original = orig;
+    processed = proc;
+    remaining = nbframes;
+
+    size_t bytes = original->frameBytes() + processed->frameBytes();
+    max_chunk = static_cast<int>(budget / bytes);
+    if (max_chunk < 1)
+        max_chunk = 1;
+    if (max_chunk > nbframes && nbframes > 0)
+        max_chunk = nbframes;
+
+    // Start small and let adapt() find the best size
+    chunk = 1;
+    best_chunk = 1;
+    best_throughput = 0.0;
+
+    original->setPoolSize(max_chunk);
+    processed->setPoolSize(max_chunk);
+}
+
+void ReadScheduler::restart(int nbframes)
+{
+    remaining = nbframes;
+}
+
+bool ReadScheduler::readOneFrame()
+{
+    if (original->bufferedFrames() == 0 || processed->bufferedFrames() == 0) {
+        if (!refill())
+            return false;
+    }
+
+    return original->readOneFrame() && processed->readOneFrame();
+}
+
+int ReadScheduler::getChunkSize() const
+{
+    return chunk;
+}
+
+bool ReadScheduler::refill()
+{
+    int n = chunk < remaining ? chunk : remaining;
+    if (n < 1)
+        return false;
+
+    double start = static_cast<double>(cv::getTickCount());
+
+    // The pools are consumed in lockstep, so both are normally empty here.
+    size_t bytes = 0;
+    int got_orig = original->bufferedFrames();
+    int got_proc = processed->bufferedFrames();
+    if (got_orig == 0) {
+        got_orig = original->fillChunk(n);
+        bytes += static_cast<size_t>(got_orig)*original->frameBytes();
+    }
+    if (got_proc == 0) {
+        got_proc = processed->fillChunk(n);
+        bytes += static_cast<size_t>(got_proc)*processed->frameBytes();
+    }
+
+    double elapsed = (static_cast<double>(cv::getTickCount()) - start) / cv::getTickFrequency();
+    if (got_orig < 1 || got_proc < 1)
+        return false;
+
+    remaining -= got_orig < got_proc ? got_orig : got_proc;
+    if (elapsed > 0.0 && n == chunk)
+        adapt(static_cast<double>(bytes) / elapsed);
+
+    return true;
+}
+
+void ReadScheduler::adapt(double throughput)
+{
+    // Let old measurements fade so that the size keeps tracking the storage
+    best_throughput *= 0.98;
+
+    if (throughput >= best_throughput * 1.05) {
+        // Larger requests still pay off, keep growing
+        best_throughput = throughput;
+        best_chunk = chunk;
+        chunk = chunk*2 < max_chunk ? chunk*2 : max_chunk;
+    }
+    else if (throughput < best_throughput * 0.9) {
+        // Past the sweet spot (e.g. cache or readahead window exceeded)
+        chunk = best_chunk;
+    }
+}
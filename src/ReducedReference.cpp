@@ -0,0 +1,151 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+#include <string.h>
+#include "ReducedReference.hpp"
+
+const double ReducedReference::C1 = 6.5025;
+const double ReducedReference::C2 = 58.5225;
+const float ReducedReference::SIGMA_NSQ = 0.1f;
+const char ReducedReference::MAGIC[8] = {'V', 'Q', 'M', 'T', 'R', 'R', '0', '1'};
+
+ReducedReference::ReducedReference(int h, int w, int b) : Metric(h, w)
+{
+    block = b;
+    // Blocks cover the region where the 11x11 window is valid
+    blocks_x = (w-10) / block;
+    blocks_y = (h-10) / block;
+    if (blocks_x < 1 || blocks_y < 1) {
+        fprintf(stderr, "RR: the block size is larger than the frame.\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+size_t ReducedReference::signatureSize() const
+{
+    return 3*static_cast<size_t>(blocks_x*blocks_y);
+}
+
+void ReducedReference::extract(const cv::Mat& original, std::vector<float>& signature)
+{
+    size_t n = static_cast<size_t>(blocks_x*blocks_y);
+    signature.resize(3*n);
+    blockStatistics(original, &signature[0], &signature[n], &signature[2*n]);
+}
+
+float ReducedReference::compute(const cv::Mat& original, const cv::Mat& processed)
+{
+    std::vector<float> signature;
+    extract(original, signature);
+    return float(score(signature, processed).val[0]);
+}
+
+cv::Scalar ReducedReference::score(const std::vector<float>& signature, const cv::Mat& processed)
+{
+    size_t n = static_cast<size_t>(blocks_x*blocks_y);
+    std::vector<float> stats(3*n);
+    blockStatistics(processed, &stats[0], &stats[n], &stats[2*n]);
+
+    const float *mu1 = &signature[0];
+    const float *sigma1_sq = &signature[n];
+    const float *entropy1 = &signature[2*n];
+    const float *mu2 = &stats[0];
+    const float *sigma2_sq = &stats[n];
+    const float *entropy2 = &stats[2*n];
+
+    double rrssim = 0.0;
+    double rred = 0.0;
+    for (size_t i=0; i<n; i++) {
+        double m1 = mu1[i], m2 = mu2[i];
+        double s1 = sigma1_sq[i] > 0.0f ? double(sigma1_sq[i]) : 0.0;
+        double s2 = sigma2_sq[i] > 0.0f ? double(sigma2_sq[i]) : 0.0;
+        // (2*mu1*mu2 + C1)/(mu1^2 + mu2^2 + C1) * (2*sigma1*sigma2 + C2)/(sigma1^2 + sigma2^2 + C2)
+        rrssim += (2*m1*m2 + C1)/(m1*m1 + m2*m2 + C1) * (2*sqrt(s1*s2) + C2)/(s1 + s2 + C2);
+        rred += fabs(static_cast<double>(entropy1[i] - entropy2[i]));
+    }
+
+    return cv::Scalar(rrssim/static_cast<double>(n), rred/static_cast<double>(n));
+}
+
+bool ReducedReference::writeHeader(FILE *file, int first)
+{
+    int geometry[4] = {height, width, block, first};
+    return fwrite(MAGIC, 1, sizeof(MAGIC), file) == sizeof(MAGIC)
+        && fwrite(geometry, sizeof(int), 4, file) == 4;
+}
+
+bool ReducedReference::readHeader(FILE *file, int& first)
+{
+    char magic[8];
+    int geometry[4];
+    if (fread(magic, 1, sizeof(magic), file) != sizeof(magic) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+        fprintf(stderr, "RR: not a signature file.\n");
+        return false;
+    }
+    if (fread(geometry, sizeof(int), 4, file) != 4
+        || geometry[0] != height || geometry[1] != width || geometry[2] != block) {
+        fprintf(stderr, "RR: signatures were extracted for another geometry or block size.\n");
+        return false;
+    }
+    first = geometry[3];
+    return true;
+}
+
+void ReducedReference::blockStatistics(const cv::Mat& img, float *mu, float *sigma_sq, float *entropy)
+{
+    cv::Mat mu_map, sigma_sq_map, tmp;
+
+    // mu = filter2(window, img, 'valid');
+    applyGaussianBlur(img, mu_map, 11, 1.5);
+    // sigma_sq = filter2(window, img.*img, 'valid') - mu.*mu;
+    cv::multiply(img, img, tmp);
+    applyGaussianBlur(tmp, sigma_sq_map, 11, 1.5);
+    cv::multiply(mu_map, mu_map, tmp);
+    sigma_sq_map -= tmp;
+
+    // Band-pass residual: the image minus its local mean
+    cv::Mat residual = img(cv::Range(5, img.rows-5), cv::Range(5, img.cols-5)) - mu_map;
+    cv::multiply(residual, residual, residual);
+
+    cv::Size blocks(blocks_x, blocks_y);
+    cv::Rect area(0, 0, blocks_x*block, blocks_y*block);
+    cv::Mat mu_blocks, sigma_sq_blocks, residual_blocks;
+    cv::resize(mu_map(area), mu_blocks, blocks, 0, 0, cv::INTER_AREA);
+    cv::resize(sigma_sq_map(area), sigma_sq_blocks, blocks, 0, 0, cv::INTER_AREA);
+    cv::resize(residual(area), residual_blocks, blocks, 0, 0, cv::INTER_AREA);
+
+    for (int i=0, k=0; i<blocks_y; i++) {
+        const float *ptr_mu = mu_blocks.ptr<float>(i);
+        const float *ptr_sigma = sigma_sq_blocks.ptr<float>(i);
+        const float *ptr_res = residual_blocks.ptr<float>(i);
+        for (int j=0; j<blocks_x; j++, k++) {
+            mu[k] = ptr_mu[j];
+            sigma_sq[k] = ptr_sigma[j];
+            // Entropy of the Gaussian residual, scaled by log2(1+variance)
+            double var = ptr_res[j] > 0.0f ? double(ptr_res[j]) : 0.0;
+            double h = 0.5*log2(2*M_PI*M_E*(var + double(SIGMA_NSQ)));
+            entropy[k] = float(log2(1.0 + var) * h);
+        }
+    }
+}
@@ -0,0 +1,279 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Roofline.hpp"
+#include "Benchmark.hpp"
+#include "VideoYUV.hpp"
+#include "PSNR.hpp"
+#include "SSIM.hpp"
+#include "MSSSIM.hpp"
+#include "VIFP.hpp"
+#include "PSNRHVS.hpp"
+#include "WSPSNR.hpp"
+
+// Minimum duration of each measurement, in seconds
+static const double MIN_TIME = 0.5;
+
+// Widest vector extension the build targets, which bounds the measured
+// compute peak (the default x86-64 build only uses SSE2)
+#if defined(__AVX512F__)
+static const char *const ISA = "AVX-512";
+#elif defined(__AVX2__) && defined(__FMA__)
+static const char *const ISA = "AVX2+FMA";
+#elif defined(__AVX__)
+static const char *const ISA = "AVX";
+#elif defined(__SSE2__) || defined(_M_X64)
+static const char *const ISA = "SSE2";
+#elif defined(__ARM_NEON)
+static const char *const ISA = "NEON";
+#else
+static const char *const ISA = "scalar";
+#endif
+
+struct Kernel {
+    std::string name;
+    double bytes;		// per frame
+    double flops;		// per frame
+    std::function<void()> run;
+};
+
+// Per-pixel models of the kernels, in bytes moved and floating-point
+// operations. A full-plane pass is one CV_32F plane read or written
+// (4 bytes per pixel); a separable blur with an n-tap kernel costs 4n
+// operations per pixel and four passes (filter and 'valid' crop).
+
+// One SSIM map: 5 blurs (11 taps), 51 passes and 23 operations of
+// element-wise arithmetic
+static const double SSIM_PASSES = 5*4 + 51;
+static const double SSIM_FLOPS  = 5*4*11 + 23;
+static const int MSSSIM_LEVELS = 5;
+
+// VIFp at one scale: 5 blurs (n taps), 108 passes and 40 operations of
+// element-wise arithmetic
+static const double VIFP_PASSES = 5*4 + 108;
+static const double VIFP_FLOPS  = 40;
+static const int VIFP_SCALES = 4;
+
+Roofline::Roofline(int h, int w, int threads)
+{
+    height = h;
+    width = w;
+    nthreads = threads < 1 ? 1 : threads;
+}
+
+double Roofline::measureBandwidth() const
+{
+    // Three arrays well beyond the last-level cache
+    const size_t n = size_t(1) << 23;
+    std::vector<double> a(n), b(n), c(n);
+    size_t slice = n / static_cast<size_t>(nthreads);
+
+    auto parallel = [&](const std::function<void(size_t, size_t)>& fn) {
+        std::vector<std::thread> threads;
+        for (int t=0; t<nthreads; t++) {
+            size_t first = slice*static_cast<size_t>(t);
+            size_t last = t == nthreads-1 ? n : first+slice;
+            threads.push_back(std::thread(fn, first, last));
+        }
+        for (auto& t : threads)
+            t.join();
+    };
+
+    // First touch by the threads that use the pages
+    parallel([&](size_t first, size_t last) {
+        for (size_t i=first; i<last; i++) {
+            a[i] = 0.0;
+            b[i] = 1.0;
+            c[i] = 2.0;
+        }
+    });
+
+    // a = b + s*c, 24 bytes per element
+    const double s = 3.0;
+    double seconds = Benchmark::time([&]() {
+        parallel([&](size_t first, size_t last) {
+            for (size_t i=first; i<last; i++)
+                a[i] = b[i] + s*c[i];
+        });
+    }, MIN_TIME);
+
+    return 24.0*static_cast<double>(n) / seconds;
+}
+
+double Roofline::measureCompute() const
+{
+    // Independent multiply-add chains, enough of them to hide the latency
+    // and fill the vector units
+    const int chains = 64;
+    const int iterations = 1 << 20;
+    std::vector<float> sink(static_cast<size_t>(nthreads));
+
+    double seconds = Benchmark::time([&]() {
+        std::vector<std::thread> threads;
+        for (int t=0; t<nthreads; t++) {
+            threads.push_back(std::thread([&sink, t]() {
+                float v[chains];
+                for (int k=0; k<chains; k++)
+                    v[k] = static_cast<float>(k);
+                for (int i=0; i<iterations; i++) {
+                    for (int k=0; k<chains; k++)
+                        v[k] = v[k]*0.999999f + 0.5f;
+                }
+                float sum = 0.0f;
+                for (int k=0; k<chains; k++)
+                    sum += v[k];
+                sink[static_cast<size_t>(t)] = sum;
+            }));
+        }
+        for (auto& t : threads)
+            t.join();
+    }, MIN_TIME);
+
+    return 2.0*chains*iterations*nthreads / seconds;
+}
+
+void Roofline::run()
+{
+    cv::setNumThreads(nthreads);
+
+    double bandwidth = measureBandwidth();
+    double compute = measureCompute();
+    double ridge = compute / bandwidth;
+
+    printf("Threads: %d\n", nthreads);
+    printf("Peak bandwidth: %.1f GB/s (STREAM triad)\n", bandwidth*1e-9);
+    printf("Peak compute: %.1f GFLOP/s (multiply-add, %s build; -march=native may raise it)\n", compute*1e-9, ISA);
+    printf("Ridge point: %.2f flop/byte\n\n", ridge);
+
+    cv::Mat original, processed;
+    Benchmark::syntheticFrames(height, width, original, processed);
+    double pixels = static_cast<double>(height)*width;
+
+    PSNR psnr(height, width);
+    SSIM ssim(height, width);
+    MSSSIM msssim(height, width);
+    VIFP vifp(height, width);
+    PSNRHVS phvs(height, width);
+    WSPSNR wspsnr(height, width);
+
+    std::vector<Kernel> kernels;
+
+    // subtract, multiply, mean
+    kernels.push_back({"PSNR", 4*7*pixels, 3*pixels,
+                       [&]() { psnr.compute(original, processed); }});
+    // weights, subtract, multiply twice, mean
+    kernels.push_back({"WSPSNR", 4*10*pixels, 5*pixels,
+                       [&]() { wspsnr.compute(original, processed); }});
+    kernels.push_back({"SSIM", 4*SSIM_PASSES*pixels, SSIM_FLOPS*pixels,
+                       [&]() { ssim.compute(original, processed); }});
+
+    // SSIM at each level, and bilinear decimation of both planes
+    double ms_passes = 0.0, ms_flops = 0.0;
+    for (int l=0; l<MSSSIM_LEVELS; l++) {
+        double area = 1.0 / (1 << (2*l));
+        ms_passes += area*SSIM_PASSES;
+        ms_flops += area*SSIM_FLOPS;
+        if (l < MSSSIM_LEVELS-1) {
+            ms_passes += area*2*1.25;
+            ms_flops += area*2*0.25*4;
+        }
+    }
+    kernels.push_back({"MSSSIM", 4*ms_passes*pixels, ms_flops*pixels,
+                       [&]() { msssim.compute(original, processed); }});
+
+    // VIFp at each scale, and the blur and decimation of both planes
+    // building the next one
+    double vifp_passes = 0.0, vifp_flops = 0.0;
+    for (int scale=0; scale<VIFP_SCALES; scale++) {
+        int n = (2 << (VIFP_SCALES-scale-1)) + 1;
+        double area = 1.0 / (1 << (2*scale));
+        vifp_passes += area*VIFP_PASSES;
+        vifp_flops += area*(VIFP_FLOPS + 5*4*n);
+        if (scale > 0) {
+            vifp_passes += 4*area*2*(4+0.5);
+            vifp_flops += 4*area*2*4*n;
+        }
+    }
+    kernels.push_back({"VIFP", 4*vifp_passes*pixels, vifp_flops*pixels,
+                       [&]() { vifp.compute(original, processed); }});
+
+    // Both frames read once, blocks stay in cache: two 8x8 DCTs (separable,
+    // 32 operations per pixel each), masking and weighting
+    kernels.push_back({"PSNRHVS", 4*2*pixels, 92*pixels,
+                       [&]() { phvs.compute(original, processed); }});
+
+    // Reader: luma-only frames from a file in the page cache, copied to the
+    // frame pool and converted to CV_32F (read, write, read, 4-byte write)
+    char path[] = "/tmp/vqmt-roofline-XXXXXX";
+    int fd = mkstemp(path);
+    const int nframes = 8;
+    std::vector<imgpel> frame(static_cast<size_t>(height*width), 128);
+    bool ok = fd >= 0;
+    for (int f=0; ok && f<nframes; f++)
+        ok = write(fd, &frame[0], frame.size()) == static_cast<ssize_t>(frame.size());
+    if (fd >= 0)
+        close(fd);
+    VideoYUV *video = ok ? new VideoYUV(path, height, width, nframes, CHROMA_SUBSAMP_400) : nullptr;
+    int position = 0;
+    cv::Mat luma;
+    if (video != nullptr) {
+        kernels.push_back({"reader", 7*pixels, 0.0, [&]() {
+            if (position == nframes) {
+                if (!video->seekFrame(0)) exit(EXIT_FAILURE);
+                position = 0;
+            }
+            if (!video->readOneFrame()) exit(EXIT_FAILURE);
+            video->getLuma(luma, CV_32F);
+            position++;
+        }});
+    }
+    else {
+        fprintf(stderr, "Roofline: cannot create a temporary file, reader skipped.\n");
+    }
+
+    printf("%-10s %10s %10s %10s %10s %8s %8s\n",
+           "kernel", "ms/frame", "GB/s*", "GFLOP/s*", "flop/byte*", "bound", "% roof");
+    for (auto& k : kernels) {
+        double seconds = Benchmark::time(k.run, MIN_TIME);
+        double intensity = k.flops / k.bytes;
+        double gbs = k.bytes / seconds;
+        double gflops = k.flops / seconds;
+        // Attainable performance at this intensity
+        bool memory = intensity < ridge;
+        double roof = memory ? 100.0*gbs/bandwidth : 100.0*gflops/compute;
+        printf("%-10s %10.3f %10.2f %10.2f %10.3f %8s %7.1f%%\n",
+               k.name.c_str(), seconds*1e3, gbs*1e-9, gflops*1e-9, intensity,
+               memory ? "memory" : "compute", roof);
+    }
+    printf("* estimates: measured time, modelled bytes and flops per frame (see src/Roofline.cpp)\n");
+
+    delete video;
+    unlink(path);
+}
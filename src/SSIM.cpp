@@ -33,6 +33,7 @@
 //   Transactions on Image Processing, vol. 13, no. 4, pp. 600–612, April 2004.
 //
 
+#include <algorithm>
 #include "SSIM.hpp"
 
 const double SSIM::C1 = 6.5025;
@@ -48,7 +49,45 @@ float SSIM::compute(const cv::Mat& original, const cv::Mat& processed)
     return float(res.val[0]);
 }
 
+void SSIM::computeFrames(const std::vector<cv::Mat>& original, const std::vector<cv::Mat>& processed,
+                         std::vector<float>& results)
+{
+    results.resize(original.size());
+    if (original.empty())
+        return;
+
+    size_t per_stack = stackFrames(original[0]);
+    int ht = original[0].rows;
+    cv::Mat img1, img2, ssim_map, cs_map;
+    for (size_t begin=0; begin<original.size(); begin+=per_stack) {
+        size_t end = std::min(begin+per_stack, original.size());
+        stack(original, begin, end, img1);
+        stack(processed, begin, end, img2);
+        computeMaps(img1, img2, ssim_map, cs_map);
+        // The first ht-10 rows of each frame, the others straddle two frames
+        for (size_t i=begin; i<end; i++) {
+            int y = static_cast<int>(i-begin)*ht;
+            results[i] = float(cv::mean(ssim_map.rowRange(y, y+ht-10)).val[0]);
+        }
+    }
+}
+
 cv::Scalar SSIM::computeSSIM(const cv::Mat& img1, const cv::Mat& img2)
+{
+    cv::Mat ssim_map, cs_map;
+    computeMaps(img1, img2, ssim_map, cs_map);
+
+    // mssim = mean2(ssim_map);
+    double mssim = cv::mean(ssim_map).val[0];
+    // mcs = mean2(cs_map);
+    double mcs = cv::mean(cs_map).val[0];
+
+    cv::Scalar res(mssim, mcs);
+
+    return res;
+}
+
+void SSIM::computeMaps(const cv::Mat& img1, const cv::Mat& img2, cv::Mat& ssim_map, cv::Mat& cs_map)
 {
 
     int ht = img1.rows;
@@ -61,7 +100,8 @@ cv::Scalar SSIM::computeSSIM(const cv::Mat& img1, const cv::Mat& img2)
     cv::Mat img1_sq(ht, wt, CV_32F), img2_sq(ht, wt, CV_32F), img1_img2(ht, wt, CV_32F);
     cv::Mat sigma1_sq(h, w, CV_32F), sigma2_sq(h, w, CV_32F), sigma12(h, w, CV_32F);
     cv::Mat tmp1(h, w, CV_32F), tmp2(h, w, CV_32F), tmp3(h, w, CV_32F);
-    cv::Mat ssim_map(h, w, CV_32F), cs_map(h, w, CV_32F);
+    ssim_map.create(h, w, CV_32F);
+    cs_map.create(h, w, CV_32F);
 
     // mu1 = filter2(window, img1, 'valid');
     applyGaussianBlur(img1, mu1, 11, 1.5);
@@ -102,13 +142,4 @@ cv::Scalar SSIM::computeSSIM(const cv::Mat& img1, const cv::Mat& img2)
     tmp3 = mu1_sq + mu2_sq + C1;
     cv::multiply(tmp2, tmp3, tmp2);
     cv::divide(tmp1, tmp2, ssim_map);
-
-    // mssim = mean2(ssim_map);
-    double mssim = cv::mean(ssim_map).val[0];
-    // mcs = mean2(cs_map);
-    double mcs = cv::mean(cs_map).val[0];
-
-    cv::Scalar res(mssim, mcs);
-
-    return res;
 }
@@ -0,0 +1,300 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+//
+// This is an OpenCV implementation of the reference implementation from
+// Jon Sneyers available from https://github.com/cloudinary/ssimulacra2.
+//
+
+#include <algorithm>
+#include "SSIMULACRA2.hpp"
+
+// Weights of the features: for X, Y and B, for each scale, for the L1 and
+// L4 norms, SSIM, edge artifacts and detail loss
+const double SSIMULACRA2::WEIGHT[] = {
+    0.0, 0.0007376606707406586, 0.0,
+    0.0, 0.0007793481682867309, 0.0,
+    0.0, 0.0004371155730107379, 0.0,
+    1.1041726426657346, 0.00066284834129271, 0.00015231632783718752,
+    0.0, 0.0016406437456599754, 0.0,
+    1.8422455520539298, 11.441172603757666, 0.0,
+    0.0007989109436015163, 0.000176816438078653, 0.0,
+    1.8787594979546387, 10.94906990605142, 0.0,
+    0.0007289346991508072, 0.9677937080626833, 0.0,
+    0.00014003424285435884, 0.9981766977854967, 0.00031949755934435053,
+    0.0004550992113792063, 0.0, 0.0,
+    0.0013648766163243398, 0.0, 0.0,
+    0.0, 0.0, 0.0,
+    7.466890328078848, 0.0, 17.445833984131262,
+    0.0006235601634041466, 0.0, 0.0,
+    6.683678146179332, 0.00037724407979611296, 1.027889937768264,
+    225.20515300849274, 0.0, 0.0,
+    19.213238186143016, 0.0011401524586618361, 0.001237755635509985,
+    176.39317598450694, 0.0, 0.0,
+    24.43300999870476, 0.28520802612117757, 0.0004485436923833408,
+    0.0, 0.0, 0.0,
+    34.77906344483772, 44.835625328877896, 0.0,
+    0.0, 0.0, 0.0,
+    0.0, 0.0, 0.0,
+    0.0, 0.0008680556573291698, 0.0,
+    0.0, 0.0, 0.0,
+    0.0, 0.0005313191874358747, 0.0,
+    0.00016533814161379112, 0.0, 0.0,
+    0.0, 0.0, 0.0,
+    0.0004179171803251336, 0.0017290828234722833, 0.0,
+    0.0020827005846636437, 0.0, 0.0,
+    8.826982764996862, 23.19243343998926, 0.0,
+    95.1080498811086, 0.9863978034400682, 0.9834382792465353,
+    0.0012286405048278493, 171.2667255897307, 0.9807858872435379,
+    0.0, 0.0, 0.0,
+    0.0005130064588990679, 0.0, 0.00010854057858411537
+};
+
+// Opsin absorbance bias of XYB
+static const float OPSIN_BIAS = 0.0037930732552754493f;
+// Stabilizing constant of the SSIM maps
+static const float C2 = 0.0009f;
+
+SSIMULACRA2::SSIMULACRA2(int h, int w, ThreadPool *p) : Metric(h, w)
+{
+    pool = p;
+
+    to_linear.resize(LUT_SIZE+2);
+    for (int i=0; i<LUT_SIZE+2; i++) {
+        double v = std::min(1.0, static_cast<double>(i) / LUT_SIZE);
+        to_linear[static_cast<size_t>(i)] = static_cast<float>(v <= 0.04045 ? v / 12.92 : pow((v + 0.055) / 1.055, 2.4));
+    }
+
+    // Recursive Gaussian of libjxl (Charalampidis, truncated cosines of
+    // orders 1, 3 and 5 over a radius N) for sigma = 1.5; its recursion is
+    // exactly the FIR sum_k beta_k cos(omega_k m), |m| <= N, zero outside
+    // the image, which is applied here
+    const double sigma = 1.5;
+    double radius = floor(3.2795*sigma + 0.2546 + 0.5);
+    double omega[3], cot[3], r[3], rho[3];
+    for (int k=0; k<3; k++) {
+        omega[k] = (2*k+1) * M_PI / (2.0*radius);
+        double sign = k == 1 ? -1.0 : 1.0;
+        cot[k] = sign / tan(0.5*omega[k]);
+        r[k] = sign * cot[k]*cot[k] / sin(omega[k]);
+        rho[k] = exp(-0.5*sigma*sigma*omega[k]*omega[k]) / radius;
+    }
+    double d13 = cot[0]*r[1] - r[0]*cot[1];
+    double d35 = cot[1]*r[2] - r[1]*cot[2];
+    double d51 = cot[2]*r[0] - r[2]*cot[0];
+    double zeta15 = d35 / d13;
+    double zeta35 = d51 / d13;
+
+    // beta solves A beta = gamma (Cramer's rule)
+    double a[3][3] = {{cot[0], cot[1], cot[2]}, {r[0], r[1], r[2]}, {zeta15, zeta35, 1.0}};
+    double gamma[3] = {1.0, radius*radius - sigma*sigma, zeta15*rho[0] + zeta35*rho[1] + rho[2]};
+    auto det = [](const double m[3][3]) {
+        return m[0][0]*(m[1][1]*m[2][2] - m[1][2]*m[2][1])
+             - m[0][1]*(m[1][0]*m[2][2] - m[1][2]*m[2][0])
+             + m[0][2]*(m[1][0]*m[2][1] - m[1][1]*m[2][0]);
+    };
+    double det_a = det(a);
+    double beta[3];
+    for (int k=0; k<3; k++) {
+        double m[3][3];
+        for (int i=0; i<3; i++)
+            for (int j=0; j<3; j++)
+                m[i][j] = j == k ? gamma[i] : a[i][j];
+        beta[k] = det(m) / det_a;
+    }
+
+    int n = static_cast<int>(radius);
+    kernel.create(2*n+1, 1, CV_32F);
+    for (int m=-n; m<=n; m++) {
+        double g = 0.0;
+        for (int k=0; k<3; k++)
+            g += beta[k]*cos(omega[k]*m);
+        kernel.at<float>(m+n) = static_cast<float>(g);
+    }
+}
+
+void SSIMULACRA2::linearize(const cv::Mat& src, cv::Mat& dst) const
+{
+    // Lookup with linear interpolation, luma is scaled to 0-1 on the fly
+    float scale = src.channels() == 1 ? LUT_SIZE / 255.0f : static_cast<float>(LUT_SIZE);
+    cv::Mat linear(src.rows, src.cols, src.type());
+    const float *table = &to_linear[0];
+    int n = src.cols*src.channels();
+    for (int y=0; y<src.rows; y++) {
+        const float *s = src.ptr<float>(y);
+        float *d = linear.ptr<float>(y);
+        for (int i=0; i<n; i++) {
+            float v = std::min(std::max(s[i]*scale, 0.0f), static_cast<float>(LUT_SIZE));
+            int k = static_cast<int>(v);
+            d[i] = table[k] + (v - static_cast<float>(k))*(table[k+1] - table[k]);
+        }
+    }
+
+    if (src.channels() == 1) {
+        cv::Mat planes[] = {linear, linear, linear};
+        cv::merge(planes, 3, dst);
+    }
+    else {
+        dst = linear;
+    }
+}
+
+void SSIMULACRA2::toXYB(const cv::Mat& linear, cv::Mat& xyb)
+{
+    // Opsin absorbance (LMS-like mix of linear RGB)
+    static const float opsin[] = {
+        0.30f, 0.622f, 0.078f, OPSIN_BIAS,
+        0.23f, 0.692f, 0.078f, OPSIN_BIAS,
+        0.24342268924547819f, 0.20476744424496821f, 0.55180986651495360f, OPSIN_BIAS
+    };
+    // X = 14*(L-M)/2 + 0.42, Y = (L+M)/2 + 0.01, B = S - Y + 0.55 on the
+    // cube roots minus the cube root of the bias (offsets folded)
+    float bias = std::cbrt(OPSIN_BIAS);
+    const float mix[] = {
+        7.0f, -7.0f, 0.0f, 0.42f,
+        0.5f, 0.5f, 0.0f, 0.01f - bias,
+        -0.5f, -0.5f, 1.0f, 0.55f
+    };
+
+    cv::Mat mixed;
+    cv::transform(linear, mixed, cv::Mat(3, 4, CV_32F, const_cast<float *>(opsin)));
+    int n = mixed.cols*3;
+    for (int y=0; y<mixed.rows; y++) {
+        float *p = mixed.ptr<float>(y);
+        for (int i=0; i<n; i++)
+            p[i] = std::cbrt(std::max(p[i], 0.0f));
+    }
+    cv::transform(mixed, xyb, cv::Mat(3, 4, CV_32F, const_cast<float *>(mix)));
+}
+
+void SSIMULACRA2::blur(const cv::Mat& src, cv::Mat& dst) const
+{
+    cv::sepFilter2D(src, dst, CV_32F, kernel, kernel, cv::Point(-1, -1), 0, cv::BORDER_CONSTANT);
+}
+
+// Pool the SSIM and edge maps of one scale
+// ssim[c*2+n]: L1 and L4 norms of 1-SSIM, edge[c*4+n]: L1 and L4 norms of
+// the edge artifacts, edge[c*4+2+n]: of the detail loss
+static void poolMaps(const cv::Mat& img1, const cv::Mat& img2, const cv::Mat& mu1, const cv::Mat& mu2,
+                     const cv::Mat& s11, const cv::Mat& s22, const cv::Mat& s12, double ssim[6], double edge[12])
+{
+    double sum[3][6] = {{0.0}};
+    for (int y=0; y<img1.rows; y++) {
+        const float *i1 = img1.ptr<float>(y), *i2 = img2.ptr<float>(y);
+        const float *m1 = mu1.ptr<float>(y), *m2 = mu2.ptr<float>(y);
+        const float *v11 = s11.ptr<float>(y), *v22 = s22.ptr<float>(y), *v12 = s12.ptr<float>(y);
+        for (int x=0; x<img1.cols; x++) {
+            for (int c=0; c<3; c++) {
+                int i = x*3+c;
+                // No luminance term, 1-(mu1-mu2)^2 instead
+                float mu_diff = m1[i] - m2[i];
+                float num_m = 1.0f - mu_diff*mu_diff;
+                float num_s = 2.0f*(v12[i] - m1[i]*m2[i]) + C2;
+                float denom_s = (v11[i] - m1[i]*m1[i]) + (v22[i] - m2[i]*m2[i]) + C2;
+                double d = std::max(1.0f - num_m*num_s/denom_s, 0.0f);
+                sum[c][0] += d;
+                sum[c][1] += (d*d)*(d*d);
+
+                // Edges added (artifacts) or removed (detail loss)
+                float e = (1.0f + fabsf(i2[i] - m2[i])) / (1.0f + fabsf(i1[i] - m1[i])) - 1.0f;
+                double artifact = std::max(e, 0.0f);
+                double loss = std::max(-e, 0.0f);
+                sum[c][2] += artifact;
+                sum[c][3] += (artifact*artifact)*(artifact*artifact);
+                sum[c][4] += loss;
+                sum[c][5] += (loss*loss)*(loss*loss);
+            }
+        }
+    }
+
+    double npix = static_cast<double>(img1.rows)*img1.cols;
+    for (int c=0; c<3; c++) {
+        ssim[c*2] = sum[c][0] / npix;
+        ssim[c*2+1] = sqrt(sqrt(sum[c][1] / npix));
+        edge[c*4] = sum[c][2] / npix;
+        edge[c*4+1] = sqrt(sqrt(sum[c][3] / npix));
+        edge[c*4+2] = sum[c][4] / npix;
+        edge[c*4+3] = sqrt(sqrt(sum[c][5] / npix));
+    }
+}
+
+float SSIMULACRA2::compute(const cv::Mat& original, const cv::Mat& processed)
+{
+    cv::Mat lin1, lin2;
+    linearize(original, lin1);
+    linearize(processed, lin2);
+
+    double ssim[NSCALES][6], edge[NSCALES][12];
+    int nscales = 0;
+    for (int scale=0; scale<NSCALES; scale++) {
+        // As the reference, stop when the image is too small to be
+        // downsampled, the last scale may be 4 to 7 pixels
+        if (lin1.cols < 8 || lin1.rows < 8)
+            break;
+        if (scale > 0) {
+            // 2x2 averaging, as the MS-SSIM pyramid, of linear RGB
+            cv::Mat down1, down2;
+            downsample(lin1, down1);
+            downsample(lin2, down2);
+            lin1 = down1;
+            lin2 = down2;
+        }
+
+        cv::Mat img1, img2;
+        toXYB(lin1, img1);
+        toXYB(lin2, img2);
+
+        cv::Mat mu1, mu2, s11, s22, s12;
+        TaskGroup tasks(pool);
+        tasks.run([this, &img1, &mu1] { blur(img1, mu1); });
+        tasks.run([this, &img2, &mu2] { blur(img2, mu2); });
+        tasks.run([this, &img1, &s11] { blur(img1.mul(img1), s11); });
+        tasks.run([this, &img2, &s22] { blur(img2.mul(img2), s22); });
+        tasks.run([this, &img1, &img2, &s12] { blur(img1.mul(img2), s12); });
+        tasks.wait();
+
+        poolMaps(img1, img2, mu1, mu2, s11, s22, s12, ssim[scale], edge[scale]);
+        nscales++;
+    }
+
+    // Weighted sum of the features (the weights of the missing scales of
+    // small images are shifted, as in the reference implementation)
+    double score = 0.0;
+    int i = 0;
+    for (int c=0; c<3; c++) {
+        for (int scale=0; scale<nscales; scale++) {
+            for (int n=0; n<2; n++) {
+                score += WEIGHT[i++] * fabs(ssim[scale][c*2+n]);
+                score += WEIGHT[i++] * fabs(edge[scale][c*4+n]);
+                score += WEIGHT[i++] * fabs(edge[scale][c*4+n+2]);
+            }
+        }
+    }
+
+    score *= 0.9562382616834844;
+    score = 2.326765642916932*score - 0.020884521182843837*score*score + 6.248496625763138e-05*score*score*score;
+    score = score > 0.0 ? 100.0 - 10.0*pow(score, 0.6276336467831387) : 100.0;
+
+    return static_cast<float>(score);
+}
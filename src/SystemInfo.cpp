@@ -0,0 +1,172 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+#include <math.h>
+#ifdef HAVE_SCHED_GETAFFINITY
+#include <sched.h>
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "SystemInfo.hpp"
+
+// First line of a file, empty if it cannot be read
+static std::string readLine(const std::string& path)
+{
+    std::ifstream file(path.c_str());
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+std::string SystemInfo::cgroupFile(const std::string& controller, const std::string& file)
+{
+    // Cgroup of the process: "id:controllers:path" lines, "0::path" for v2
+    std::string path;
+    bool found = false;
+    std::ifstream cgroup("/proc/self/cgroup");
+    std::string line;
+    while (!found && std::getline(cgroup, line)) {
+        size_t first = line.find(':');
+        size_t second = line.find(':', first+1);
+        if (first == std::string::npos || second == std::string::npos)
+            continue;
+        std::string controllers = "," + line.substr(first+1, second-first-1) + ",";
+        if (controller.empty() ? controllers == ",," : controllers.find("," + controller + ",") != std::string::npos) {
+            path = line.substr(second+1);
+            found = true;
+        }
+    }
+    if (!found)
+        return "";
+
+    // Mount point of the hierarchy, and the cgroup at its root (the cgroup
+    // of a container is usually mounted as the root of the hierarchy)
+    std::ifstream mountinfo("/proc/self/mountinfo");
+    while (std::getline(mountinfo, line)) {
+        size_t dash = line.find(" - ");
+        if (dash == std::string::npos)
+            continue;
+        std::istringstream fields(line.substr(0, dash));
+        std::istringstream fs(line.substr(dash+3));
+        std::string id, parent, device, root, mount, type, source, options;
+        fields >> id >> parent >> device >> root >> mount;
+        fs >> type >> source >> options;
+        bool match = controller.empty() ? type == "cgroup2" :
+                     type == "cgroup" && ("," + options + ",").find("," + controller + ",") != std::string::npos;
+        if (!match)
+            continue;
+        std::string relative = path;
+        if (root != "/" && relative.compare(0, root.size(), root) == 0)
+            relative = relative.substr(root.size());
+        // Limits are inherited, the file of the cgroup is tried first
+        // then the one at the root of the mount
+        std::string candidate = mount + relative + "/" + file;
+        if (!readLine(candidate).empty())
+            return candidate;
+        return mount + "/" + file;
+    }
+    return "";
+}
+
+SystemInfo::SystemInfo()
+{
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    host_cpus = online > 0 ? static_cast<int>(online) : 1;
+
+    // Without an affinity mask, the CPUs the runtime reports as usable
+    unsigned concurrency = std::thread::hardware_concurrency();
+    affinity_cpus = concurrency > 0 ? static_cast<int>(concurrency) : host_cpus;
+#ifdef HAVE_SCHED_GETAFFINITY
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if (sched_getaffinity(0, sizeof(mask), &mask) == 0)
+        affinity_cpus = CPU_COUNT(&mask);
+#endif
+
+    // CPU quota: "quota period" in cpu.max (v2), cpu.cfs_quota_us and
+    // cpu.cfs_period_us (v1), a quota of "max" or -1 means no limit
+    quota_cpus = 0.0;
+    std::istringstream cpu_max(readLine(cgroupFile("", "cpu.max")));
+    std::string quota;
+    double period = 0.0;
+    if (cpu_max >> quota >> period) {
+        if (quota != "max" && period > 0.0)
+            quota_cpus = atof(quota.c_str()) / period;
+    }
+    else {
+        double cfs_quota = atof(readLine(cgroupFile("cpu", "cpu.cfs_quota_us")).c_str());
+        double cfs_period = atof(readLine(cgroupFile("cpu", "cpu.cfs_period_us")).c_str());
+        if (cfs_quota > 0.0 && cfs_period > 0.0)
+            quota_cpus = cfs_quota / cfs_period;
+    }
+
+    int64_t pages = sysconf(_SC_PHYS_PAGES);
+    int64_t page_size = sysconf(_SC_PAGESIZE);
+    host_memory = pages > 0 && page_size > 0 ? pages * page_size : 0;
+
+    // Memory limit: memory.max (v2), memory.limit_in_bytes (v1), which is a
+    // value close to 2^63 when unlimited
+    limit_memory = 0;
+    std::string memory_max = readLine(cgroupFile("", "memory.max"));
+    if (memory_max.empty())
+        memory_max = readLine(cgroupFile("memory", "memory.limit_in_bytes"));
+    if (!memory_max.empty() && memory_max != "max") {
+        int64_t limit = strtoll(memory_max.c_str(), nullptr, 10);
+        if (limit > 0 && (host_memory == 0 || limit < host_memory))
+            limit_memory = limit;
+    }
+}
+
+int SystemInfo::getCpus() const
+{
+    int cpus = affinity_cpus;
+    if (quota_cpus > 0.0 && quota_cpus < cpus)
+        cpus = static_cast<int>(ceil(quota_cpus));
+    return cpus > 0 ? cpus : 1;
+}
+
+int64_t SystemInfo::getMemory() const
+{
+    return limit_memory > 0 ? limit_memory : host_memory;
+}
+
+void SystemInfo::print() const
+{
+    printf("CPUs: %d (host: %d, affinity: %d, quota: ", getCpus(), host_cpus, affinity_cpus);
+    if (quota_cpus > 0.0)
+        printf("%.2f)", quota_cpus);
+    else
+        printf("none)");
+    printf(", memory: %lld MB (", static_cast<long long>(getMemory() >> 20));
+    if (limit_memory > 0)
+        printf("cgroup limit)\n");
+    else
+        printf("physical)\n");
+}
@@ -0,0 +1,169 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+#include "ThreadPool.hpp"
+
+// Pool and queue of the calling thread, when it is a worker
+static thread_local const ThreadPool *current_pool = nullptr;
+static thread_local size_t current_queue = 0;
+
+ThreadPool::ThreadPool(int nthreads)
+{
+    stopping = false;
+    next_queue = 0;
+    queued = 0;
+    for (int i=0; i<(nthreads > 0 ? nthreads : 1); i++)
+        queues.push_back(std::unique_ptr<Queue>(new Queue()));
+    for (int i=0; i<nthreads; i++)
+        workers.push_back(std::thread(&ThreadPool::run, this, static_cast<size_t>(i)));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cond.notify_all();
+    for (size_t i=0; i<workers.size(); i++)
+        workers[i].join();
+}
+
+int ThreadPool::size() const
+{
+    return static_cast<int>(workers.size());
+}
+
+std::future<void> ThreadPool::submit(std::function<void()> task)
+{
+    std::packaged_task<void()> packaged(task);
+    std::future<void> future = packaged.get_future();
+    size_t index;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (current_pool == this) {
+            index = current_queue;
+        }
+        else {
+            index = next_queue;
+            next_queue = (next_queue+1) % queues.size();
+        }
+        queued++;
+    }
+    {
+        std::unique_lock<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(packaged));
+    }
+    cond.notify_one();
+    return future;
+}
+
+bool ThreadPool::take(size_t index, std::packaged_task<void()>& task)
+{
+    for (size_t i=0; i<queues.size(); i++) {
+        Queue& queue = *queues[(index+i) % queues.size()];
+        std::unique_lock<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+            continue;
+        // Newest task of its own queue, oldest task of the others
+        if (i == 0) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+        else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::run(size_t index)
+{
+    current_pool = this;
+    current_queue = index;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [this] { return stopping || queued > 0; });
+            if (queued == 0)
+                return;
+        }
+        // The task counted may already have been taken by another worker
+        std::packaged_task<void()> task;
+        if (!take(index, task))
+            continue;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            queued--;
+        }
+        task();
+    }
+}
+
+TaskGroup::TaskGroup(ThreadPool *p)
+{
+    pool = p;
+}
+
+TaskGroup::~TaskGroup()
+{
+    wait();
+}
+
+void TaskGroup::run(std::function<void()> task)
+{
+    if (pool == nullptr) {
+        task();
+        return;
+    }
+    pending.push_back(pool->submit(task));
+}
+
+void TaskGroup::defer(std::function<void()> task)
+{
+    deferred.push_back(task);
+}
+
+void TaskGroup::flush()
+{
+    if (deferred.empty())
+        return;
+
+    std::vector<std::function<void()>> batch;
+    batch.swap(deferred);
+    run([batch] {
+        for (size_t i=0; i<batch.size(); i++)
+            batch[i]();
+    });
+}
+
+void TaskGroup::wait()
+{
+    flush();
+    for (size_t i=0; i<pending.size(); i++)
+        pending[i].get();
+    pending.clear();
+}
@@ -0,0 +1,374 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+//              Laboratory for Image and Video Engineering (LIVE),
+//              The University of Texas at Austin
+//              http://live.ece.utexas.edu
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without license or royalty fees,
+// to use, copy, modify, and distribute this code (the source files) and its documentation for
+// research purpose only, provided that the copyright notice and the original authors' names in
+// its entirety appear in all copies of this code, and the original source of this code is 
+// acknowledged in any publication that reports research using this code.
+// The research is to be cited in the bibliography as:
+//
+// H.R. Sheikh and A.C. Bovik, "Image information and visual quality," IEEE Transactions on
+// Image Processing, vol. 15, no. 2, pp. 430-444, February 2006.
+//
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL) be liable to any party
+// for direct, indirect, special, incidental, or consequential damages arising out of the use of
+// the software and its documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole Polytechnique Fédérale de
+// Lausanne (EPFL) has no obligation to provide maintenance, support, updates, enhancements, or
+// modifications.
+//
+// In no event shall the University of Texas at Austin be liable to any party for direct, 
+// indirect, special, incidental, or consequential damages arising out of the use of this 
+// database and its documentation, even if the University of Texas at austin has been advised
+// of the possibility of such damage.
+// The University of Texas at Austin specifically disclaims any warranties, including, but not
+// limited to, the implied warranties of merchantability and fitness for a particular purpose.
+// the database provided hereunder is on an "as is" basis, and the University of Texas at Austin
+// has no obligation to provide maintenance, support, updates, enhancements, or modifications.
+
+//
+// This is an OpenCV implementation of the original Matlab implementation of the wavelet-domain
+// Visual Information Fidelity (VIF, vifvec) from H.R. Sheikh available from
+// http://live.ece.utexas.edu/research/quality/.
+// Please refer to the following paper:
+// - H.R. Sheikh and A.C. Bovik, "Image information and visual quality," IEEE Transactions on
+//   Image Processing, vol. 15, no. 2, pp. 430-444, February 2006.
+//
+
+#include "VIF.hpp"
+
+const double VIF::SIGMA_NSQ = 0.4;
+
+// Frequency of DFT index k in a level of size n, relative to the DC (the
+// layout of fftshift, negative frequencies in the second half)
+static int frequency(int k, int n)
+{
+    return k < (n+1)/2 ? k : k-n;
+}
+
+// Raised cosine transitions of buildSFpyr over one octave, u in [-1, 0]
+// being the transition band: high-pass rising from 0 to 1, low-pass falling
+// from 1 to 0, sqrt(1-high^2)
+static double highPass(double u)
+{
+    return u >= 0.0 ? 1.0 : u <= -1.0 ? 0.0 : cos(M_PI*u/2);
+}
+
+static double lowPass(double u)
+{
+    return u <= -1.0 ? 1.0 : u >= 0.0 ? 0.0 : fabs(sin(M_PI*u/2));
+}
+
+// Central size.height x size.width frequencies of a spectrum (cv::dft
+// layout), i.e. fftshift, crop around the centre and ifftshift
+static void cropSpectrum(const cv::Mat& src, cv::Size size, cv::Mat& dst)
+{
+    dst.create(size, src.type());
+    int rows[2] = {(size.height+1)/2, size.height - (size.height+1)/2};
+    int cols[2] = {(size.width+1)/2, size.width - (size.width+1)/2};
+    for (int i=0; i<2; i++) {
+        for (int j=0; j<2; j++) {
+            if (rows[i] == 0 || cols[j] == 0)
+                continue;
+            cv::Rect from(j == 0 ? 0 : src.cols-cols[j], i == 0 ? 0 : src.rows-rows[i], cols[j], rows[i]);
+            cv::Rect to(j == 0 ? 0 : cols[0], i == 0 ? 0 : rows[0], cols[j], rows[i]);
+            cv::Mat target = dst(to);
+            src(from).copyTo(target);
+        }
+    }
+}
+
+VIF::VIF(int h, int w, ThreadPool *p) : Metric(h, w)
+{
+    pool = p;
+}
+
+float VIF::compute(const cv::Mat& original, const cv::Mat& processed)
+{
+    if (original.size() != masks_size)
+        computeMasks(original.size());
+
+    // The two pyramids are built together
+    cv::Mat ref_bands[NLEVELS][NBANDS];
+    cv::Mat dist_bands[NLEVELS][NBANDS];
+    {
+        TaskGroup pyramids(pool);
+        pyramids.run([this, &original, &ref_bands] { computeSubbands(original, ref_bands); });
+        computeSubbands(processed, dist_bands);
+        pyramids.wait();
+    }
+
+    double num[NLEVELS*NBANDS];
+    double den[NLEVELS*NBANDS];
+    TaskGroup tasks(pool);
+    for (int l=0; l<NLEVELS; l++) {
+        for (int b=0; b<NBANDS; b++) {
+            cv::Mat r = ref_bands[l][b];
+            cv::Mat d = dist_bands[l][b];
+            // lev=ceil((sub-1)/6): 1 for the coarsest level
+            int lev = NLEVELS-l;
+            double *n = &num[l*NBANDS+b];
+            double *dn = &den[l*NBANDS+b];
+            tasks.run([this, r, d, lev, n, dn] { computeSubband(r, d, lev, *n, *dn); });
+        }
+    }
+    tasks.wait();
+
+    double sum_num = 0.0;
+    double sum_den = 0.0;
+    for (int b=0; b<NLEVELS*NBANDS; b++) {
+        sum_num += num[b];
+        sum_den += den[b];
+    }
+
+    // vif=sum(num)/sum(den);
+    return float(sum_num/sum_den);
+}
+
+void VIF::computeMasks(cv::Size size)
+{
+    masks_size = size;
+
+    // Angular masks of order 5: const = 2^(2*order)*(order!)^2/(nbands*(2*order)!)
+    const int ORDER = 5;
+    const int ORIENTATIONS[NBANDS] = {0, 3};	// of 6, bands 1 and 4 of vifvec
+    double factorial = 1.0, factorial2 = 1.0;
+    for (int k=2; k<=2*ORDER; k++) {
+        if (k <= ORDER)
+            factorial *= k;
+        factorial2 *= k;
+    }
+    double gain = sqrt(pow(2.0, 2*ORDER) * factorial*factorial / ((ORDER+1) * factorial2));
+
+    // The frequencies keep the scale of the full size frame at every level
+    // (log_rad and angle of buildSFpyr are cropped, not recomputed)
+    double half_height = size.height / 2.0;
+    double half_width = size.width / 2.0;
+    int h = size.height;
+    int w = size.width;
+    for (int l=0; l<NLEVELS; l++) {
+        if (l > 0) {
+            // lodims=ceil((dims-0.5)/2);
+            h = (h+1)/2;
+            w = (w+1)/2;
+        }
+        low_masks[l].create(h, w, CV_64F);
+        for (int b=0; b<NBANDS; b++)
+            band_masks[l][b].create(h, w, CV_64F);
+
+        for (int i=0; i<h; i++) {
+            double fy = frequency(i, h) / half_height;
+            double *low = low_masks[l].ptr<double>(i);
+            double *band[NBANDS];
+            for (int b=0; b<NBANDS; b++)
+                band[b] = band_masks[l][b].ptr<double>(i);
+            for (int j=0; j<w; j++) {
+                double fx = frequency(j, w) / half_width;
+                double rad = sqrt(fx*fx + fy*fy);
+                // log_rad(ctr(1),ctr(2)) = log_rad(ctr(1),ctr(2)-1);
+                if (i == 0 && j == 0)
+                    rad = 1.0 / half_width;
+                double angle = atan2(fy, fx);
+                // Origin of the transitions shifted by 1 octave per level,
+                // the low-pass of level l taking the frame down to its size
+                double u = log2(rad) + l;
+                low[j] = lowPass(u);
+                for (int b=0; b<NBANDS; b++) {
+                    double c = cos(angle - M_PI*ORIENTATIONS[b]/(ORDER+1));
+                    band[b][j] = highPass(u+1) * gain * c*c*c*c*c;
+                }
+            }
+        }
+    }
+}
+
+void VIF::computeSubbands(const cv::Mat& img, cv::Mat bands[NLEVELS][NBANDS])
+{
+    cv::Mat tmp, spectrum, level, band_spectrum, band;
+    img.convertTo(tmp, CV_64F);
+    cv::dft(tmp, spectrum, cv::DFT_COMPLEX_OUTPUT);
+
+    for (int l=0; l<NLEVELS; l++) {
+        const cv::Mat& low = low_masks[l];
+        if (l > 0)
+            cropSpectrum(spectrum, low.size(), level);
+        else
+            level = spectrum;
+        // lodft = lomask .* lodft; (lo0mask at the top)
+        for (int i=0; i<level.rows; i++) {
+            double *ptr = level.ptr<double>(i);
+            const double *mask = low.ptr<double>(i);
+            for (int j=0; j<level.cols; j++) {
+                ptr[2*j] *= mask[j];
+                ptr[2*j+1] *= mask[j];
+            }
+        }
+
+        for (int b=0; b<NBANDS; b++) {
+            // banddft = ((-sqrt(-1))^order) .* lodft .* anglemask .* himask;
+            const cv::Mat& mask = band_masks[l][b];
+            band_spectrum.create(level.size(), level.type());
+            for (int i=0; i<level.rows; i++) {
+                const double *ptr = level.ptr<double>(i);
+                const double *m = mask.ptr<double>(i);
+                double *dst = band_spectrum.ptr<double>(i);
+                for (int j=0; j<level.cols; j++) {
+                    dst[2*j] = m[j]*ptr[2*j+1];
+                    dst[2*j+1] = -m[j]*ptr[2*j];
+                }
+            }
+            // band = real(ifft2(ifftshift(banddft)));
+            cv::dft(band_spectrum, band, cv::DFT_INVERSE | cv::DFT_SCALE);
+            cv::extractChannel(band, bands[l][b], 0);
+        }
+        spectrum = level;
+    }
+}
+
+void VIF::computeSubband(const cv::Mat& ref, const cv::Mat& dist, int lev, double& num, double& den)
+{
+    const int K = M*M;
+    const double TOL = 1e-15;
+
+    // Subbands cropped to a multiple of M
+    int bh = ref.rows / M;
+    int bw = ref.cols / M;
+    cv::Rect crop(0, 0, bw*M, bh*M);
+    cv::Mat y = ref(crop).clone();
+    cv::Mat yn = dist(crop).clone();
+
+    // Distortion channel (vifsub_est_M): sums over winsize x winsize windows
+    // reflected at the edges, at the centre of each block
+    int winsize = (1 << lev) + 1;
+    double n = winsize*winsize;
+    cv::Size window(winsize, winsize);
+    cv::Mat sum_x, sum_y, sum_xy, sum_xx, sum_yy, tmp;
+    cv::boxFilter(y, sum_x, CV_64F, window, cv::Point(-1,-1), false, cv::BORDER_REFLECT_101);
+    cv::boxFilter(yn, sum_y, CV_64F, window, cv::Point(-1,-1), false, cv::BORDER_REFLECT_101);
+    cv::multiply(y, yn, tmp);
+    cv::boxFilter(tmp, sum_xy, CV_64F, window, cv::Point(-1,-1), false, cv::BORDER_REFLECT_101);
+    cv::multiply(y, y, tmp);
+    cv::boxFilter(tmp, sum_xx, CV_64F, window, cv::Point(-1,-1), false, cv::BORDER_REFLECT_101);
+    cv::multiply(yn, yn, tmp);
+    cv::boxFilter(tmp, sum_yy, CV_64F, window, cv::Point(-1,-1), false, cv::BORDER_REFLECT_101);
+
+    cv::Mat g(bh, bw, CV_64F), vv(bh, bw, CV_64F);
+    for (int i=0; i<bh; i++) {
+        int r = M*i + M/2;
+        double *ptr_g = g.ptr<double>(i);
+        double *ptr_vv = vv.ptr<double>(i);
+        for (int j=0; j<bw; j++) {
+            int c = M*j + M/2;
+            double mean_x = sum_x.at<double>(r,c) / n;
+            double mean_y = sum_y.at<double>(r,c) / n;
+            double cov_xy = sum_xy.at<double>(r,c) - n*mean_x*mean_y;
+            double ss_x = sum_xx.at<double>(r,c) - n*mean_x*mean_x;
+            double ss_y = sum_yy.at<double>(r,c) - n*mean_y*mean_y;
+            if (ss_x < 0.0) ss_x = 0.0;
+            if (ss_y < 0.0) ss_y = 0.0;
+            // g = cov_xy./(ss_x+tol); vv = (ss_y - g.*cov_xy)/(sum(win(:)));
+            double gg = cov_xy / (ss_x + TOL);
+            double v = (ss_y - gg*cov_xy) / n;
+            if (ss_x < TOL) {
+                gg = 0.0;
+                v = ss_y;
+            }
+            if (ss_y < TOL) {
+                gg = 0.0;
+                v = 0.0;
+            }
+            if (gg < 0.0) {
+                v = ss_y;
+                gg = 0.0;
+            }
+            ptr_g[j] = gg;
+            ptr_vv[j] = v <= TOL ? TOL : v;
+        }
+    }
+
+    // Reference (refparams_vecgsm): covariance C_u of ALL the MxM blocks,
+    // overlapping ones included, element k being at row k%M, column k/M
+    int rows = y.rows - M + 1;
+    int cols = y.cols - M + 1;
+    double count = static_cast<double>(rows) * cols;
+    cv::Mat blocks[K];
+    double mean[K];
+    for (int k=0; k<K; k++) {
+        blocks[k] = y(cv::Rect(k/M, k%M, cols, rows));
+        mean[k] = cv::sum(blocks[k])[0] / count;
+    }
+    cv::Mat cu(K, K, CV_64F);
+    for (int a=0; a<K; a++) {
+        for (int b=a; b<K; b++)
+            cu.at<double>(a,b) = cu.at<double>(b,a) = blocks[a].dot(blocks[b]) / count - mean[a]*mean[b];
+    }
+    cv::Mat cu_inv;
+    if (cv::invert(cu, cu_inv, cv::DECOMP_LU) == 0)
+        cv::invert(cu, cu_inv, cv::DECOMP_SVD);
+    cv::Mat lambda;
+    cv::eigen(cu, lambda);
+
+    // S field on the non-overlapping blocks: ss=sum((inv(cu)*temp).*temp)./(M*M);
+    cv::Mat x[K];
+    for (int k=0; k<K; k++) {
+        x[k].create(bh, bw, CV_64F);
+        for (int i=0; i<bh; i++) {
+            const double *ptr = y.ptr<double>(M*i + k%M) + k/M;
+            double *ptr_x = x[k].ptr<double>(i);
+            for (int j=0; j<bw; j++)
+                ptr_x[j] = ptr[M*j];
+        }
+    }
+    cv::Mat ss = cv::Mat::zeros(bh, bw, CV_64F);
+    for (int a=0; a<K; a++) {
+        for (int b=a; b<K; b++) {
+            double coef = cu_inv.at<double>(a,b) * (a == b ? 1 : 2) / K;
+            cv::multiply(x[a], x[b], tmp);
+            cv::scaleAdd(tmp, coef, ss, ss);
+        }
+    }
+
+    // Only the blocks away from the borders: offset=ceil(((winsize-1)/2)/M);
+    int offset = ((winsize-1)/2 + M-1) / M;
+    num = 0.0;
+    den = 0.0;
+    if (bh <= 2*offset || bw <= 2*offset)
+        return;
+    cv::Range valid_rows(offset, bh-offset), valid_cols(offset, bw-offset);
+    g = g(valid_rows, valid_cols);
+    vv = vv(valid_rows, valid_cols);
+    ss = ss(valid_rows, valid_cols);
+
+    // g.*g.*ss./(vv+sigma_nsq) and ss./sigma_nsq, times each eigenvalue
+    cv::Mat a, b;
+    cv::multiply(g, g, a);
+    cv::multiply(a, ss, a);
+    tmp = vv + SIGMA_NSQ;
+    cv::divide(a, tmp, a);
+    b = ss / SIGMA_NSQ;
+
+    for (int k=0; k<K; k++) {
+        // Eigenvalues of a covariance, only rounding makes them negative
+        double l = lambda.at<double>(k);
+        if (l <= 0.0)
+            continue;
+        // temp1=temp1+sum(sum((log2(1+g.*g.*ss.*lambda(j)./(vv+sigma_nsq)))));
+        tmp = 1.0 + l*a;
+        cv::log(tmp, tmp);
+        num += cv::sum(tmp)[0] / log(2.0);
+        // temp2=temp2+sum(sum((log2(1+ss.*lambda(j)./(sigma_nsq)))));
+        tmp = 1.0 + l*b;
+        cv::log(tmp, tmp);
+        den += cv::sum(tmp)[0] / log(2.0);
+    }
+}
@@ -49,53 +49,87 @@
 
 const float VIFP::SIGMA_NSQ = 2.0f;
 
-VIFP::VIFP(int h, int w) : Metric(h, w)
+VIFP::VIFP(int h, int w, ThreadPool *p) : Metric(h, w)
 {
+    pool = p;
 }
 
 float VIFP::compute(const cv::Mat& original, const cv::Mat& processed)
 {
-    double num = 0.0;
-    double den = 0.0;
+    std::vector<float> res;
+    computeBatch(std::vector<cv::Mat>(1, original), std::vector<cv::Mat>(1, processed), res);
 
-    cv::Mat ref[NLEVS];
-    cv::Mat dist[NLEVS];
-    cv::Mat tmp1, tmp2;
+    return res[0];
+}
 
-    int w = width;
-    int h = height;
+void VIFP::computeBatch(const std::vector<cv::Mat>& original, const std::vector<cv::Mat>& processed,
+                        std::vector<float>& vifp)
+{
+    size_t nframes = original.size();
+
+    // Coefficients of each subband of each frame
+    std::vector<double> num(nframes*NLEVS, 0.0);
+    std::vector<double> den(nframes*NLEVS, 0.0);
+
+    TaskGroup tasks(pool);
+
+    for (size_t f=0; f<nframes; f++) {
+        cv::Mat ref[NLEVS];
+        cv::Mat dist[NLEVS];
+        cv::Mat tmp1, tmp2;
+
+        int w = original[f].cols;
+        int h = original[f].rows;
+
+        // for scale=1:4
+        for (int scale=0; scale<NLEVS; scale++) {
+            // N=2^(4-scale+1)+1;
+            int N = (2 << (NLEVS-scale-1)) + 1;
+
+            if (scale == 0) {
+                ref[scale] = original[f];
+                dist[scale] = processed[f];
+            }
+            else {
+                // ref=filter2(win,ref,'valid');
+                applyGaussianBlur(ref[scale-1], tmp1, N, N/5.0);
+                // dist=filter2(win,dist,'valid');
+                applyGaussianBlur(dist[scale-1], tmp2, N, N/5.0);
+
+                // ref=ref(1:2:end,1:2:end);
+                decimate(tmp1, ref[scale]);
+                // dist=dist(1:2:end,1:2:end);
+                decimate(tmp2, dist[scale]);
+
+                w = ref[scale].cols;
+                h = ref[scale].rows;
+            }
+
+            // The next subband is built while this one is computed
+            cv::Mat a = ref[scale];
+            cv::Mat b = dist[scale];
+            double *n = &num[f*NLEVS+static_cast<size_t>(scale)];
+            double *d = &den[f*NLEVS+static_cast<size_t>(scale)];
+            std::function<void()> task = [this, a, b, N, n, d] { computeVIFP(a, b, N, *n, *d); };
+            if (h*w >= SMALL_LEVEL)
+                tasks.run(task);
+            else
+                tasks.defer(task);
+        }
+    }
 
-    // for scale=1:4
-    for (int scale=0; scale<NLEVS; scale++) {
-        // N=2^(4-scale+1)+1;
-        int N = (2 << (NLEVS-scale-1)) + 1;
+    tasks.wait();
 
-        if (scale == 0) {
-            original.copyTo(ref[scale]);
-            processed.copyTo(dist[scale]);
+    vifp.resize(nframes);
+    for (size_t f=0; f<nframes; f++) {
+        double sum_num = 0.0;
+        double sum_den = 0.0;
+        for (size_t scale=0; scale<NLEVS; scale++) {
+            sum_num += num[f*NLEVS+scale];
+            sum_den += den[f*NLEVS+scale];
         }
-        else {
-            // ref=filter2(win,ref,'valid');
-            applyGaussianBlur(ref[scale-1], tmp1, N, N/5.0);
-            // dist=filter2(win,dist,'valid');
-            applyGaussianBlur(dist[scale-1], tmp2, N, N/5.0);
-
-            w = (w-(N-1)) / 2;
-            h = (h-(N-1)) / 2;
-
-            ref[scale] = cv::Mat(h,w,CV_32F);
-            dist[scale] = cv::Mat(h,w,CV_32F);
-
-            // ref=ref(1:2:end,1:2:end);
-            cv::resize(tmp1, ref[scale], cv::Size(w,h), 0, 0, cv::INTER_NEAREST);
-            // dist=dist(1:2:end,1:2:end);
-            cv::resize(tmp2, dist[scale], cv::Size(w,h), 0, 0, cv::INTER_NEAREST);
-        }
-
-        computeVIFP(ref[scale], dist[scale], N, num, den);
+        vifp[f] = float(sum_num/sum_den);
     }
-
-    return float(num/den);
 }
 
 void VIFP::computeVIFP(const cv::Mat& ref, const cv::Mat& dist, int N, double& num, double& den)
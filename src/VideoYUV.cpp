@@ -22,19 +22,38 @@
 // maintenance, support, updates, enhancements, or modifications.
 //
 
+#include <sys/stat.h>
+
+#ifndef _WIN32
+#include <glob.h>
+#endif /* _WIN32 */
+
+#include <opencv2/imgproc/imgproc.hpp>
+
 #include "VideoYUV.hpp"
+#include "Trace.hpp"
 
-VideoYUV::VideoYUV(const char *f, int h, int w, int nbf, int chroma_format)
+VideoYUV::VideoYUV(const char *f, int h, int w, int nbf, int chroma_format, int bd)
+    : VideoYUV(std::vector<std::string>(1, f), h, w, nbf, chroma_format, bd)
+{
+}
+
+VideoYUV::VideoYUV(const std::vector<std::string>& files, int h, int w, int nbf, int chroma_format, int bd)
 {
-    file = open(f, O_RDONLY | O_BINARY);
-    if (!file) {
-        fprintf(stderr, "readOneFrame: cannot open input file (%s)\n", f);
-        exit(EXIT_FAILURE);
-    }
     height = h;
     width  = w;
     nbframes = nbf;
 
+    if (bd < 8 || bd > 16) {
+        fprintf(stderr, "VideoYUV: 'bitdepth' has to be between 8 and 16.\n");
+        exit(EXIT_FAILURE);
+    }
+    bitdepth = bd;
+    sample_bytes = bd > 8 ? 2 : 1;
+    full_range = false;
+    if (bitdepth > 8)
+        lut = PU21::lut(bitdepth, TRANSFER_SDR, false);
+
     comp_height[0] = h;
     comp_width [0] = w;
     if (chroma_format == CHROMA_SUBSAMP_400) {
@@ -71,44 +90,452 @@ VideoYUV::VideoYUV(const char *f, int h, int w, int nbf, int chroma_format)
 
     size = comp_size[0]+comp_size[1]+comp_size[2];
 
-    data = new imgpel[size];
-    luma = data;
-    chroma[0] = data+comp_size[0];
-    chroma[1] = data+comp_size[0]+comp_size[1];
+    file = nullptr;
+    next_file = nullptr;
+    segment_ahead = -1;
+    if (!open(files))
+        exit(EXIT_FAILURE);
+
+    pool = nullptr;
+    setPoolSize(1);
 }
 
 VideoYUV::~VideoYUV()
 {
-    delete[] data;
-    close(file);
+    delete[] pool;
+    delete file;
+    delete next_file;
 }
 
-bool VideoYUV::readOneFrame()
+bool VideoYUV::open(const std::vector<std::string>& files)
 {
-    imgpel *ptr_data = data;
+    if (files.empty()) {
+        fprintf(stderr, "VideoYUV: no input file given.\n");
+        return false;
+    }
 
-    for (int j=0; j<3; j++) {
-        int read_size = comp_width[j];
-        if (read_size <= 0)
-            continue;
-        for (int i=0; i<comp_height[j]; i++) {
-            if (read(file, ptr_data, static_cast<size_t>(read_size)) != read_size) {
-                fprintf(stderr, "readOneFrame: cannot read %d bytes from input file, unexpected EOF.\n", read_size);
+    // Global index: byte offset of each segment in the logical stream, which
+    // is the concatenation of all segments.
+    std::vector<Segment> index;
+    int64_t start = 0;
+    bool regular = true;
+    for (size_t i=0; i<files.size(); i++) {
+        struct stat st;
+        if (stat(files[i].c_str(), &st) != 0) {
+            fprintf(stderr, "VideoYUV: cannot open input file (%s)\n", files[i].c_str());
+            return false;
+        }
+        Segment seg;
+        seg.path = files[i];
+        seg.start = start;
+        seg.bytes = st.st_size;
+        if (!S_ISREG(st.st_mode)) {
+            // Pipes and devices: size unknown, read until EOF
+            if (files.size() > 1) {
+                fprintf(stderr, "VideoYUV: %s is not a regular file and cannot be a segment.\n", files[i].c_str());
                 return false;
             }
-            ptr_data += read_size;
+            regular = false;
+            seg.bytes = -1;
+        }
+        else if (files.size() > 1 && seg.bytes % static_cast<int64_t>(frameBytes()) != 0) {
+            fprintf(stderr, "VideoYUV: warning, %s does not hold a whole number of frames.\n", files[i].c_str());
+        }
+        index.push_back(seg);
+        start += seg.bytes;
+    }
+    segments = index;
+    seekable = regular;
+
+    delete file;
+    delete next_file;
+    file = nullptr;
+    next_file = nullptr;
+    segment_ahead = -1;
+    openSegment(0);
+    next_read = 0;
+
+    // The frame pool is kept, its frames belong to the previous stream
+    pool_count = 0;
+    pool_pos = 0;
+    return true;
+}
+
+std::vector<std::string> VideoYUV::expandPath(const std::string& path)
+{
+    std::vector<std::string> files;
+
+    if (!path.empty() && path[0] == '@') {
+        // List file, one segment per line
+        FILE *list = fopen(path.c_str()+1, "r");
+        if (list == nullptr) {
+            fprintf(stderr, "VideoYUV: cannot open list file (%s)\n", path.c_str()+1);
+            exit(EXIT_FAILURE);
+        }
+        char line[4096];
+        while (fgets(line, sizeof(line), list) != nullptr) {
+            std::string name(line);
+            name.erase(name.find_last_not_of(" \t\r\n")+1);
+            if (!name.empty() && name[0] != '#')
+                files.push_back(name);
+        }
+        fclose(list);
+    }
+#ifndef _WIN32
+    else if (path.find_first_of("*?[") != std::string::npos) {
+        // Glob, segments in lexicographic order
+        glob_t g;
+        if (glob(path.c_str(), 0, nullptr, &g) == 0) {
+            for (size_t i=0; i<g.gl_pathc; i++)
+                files.push_back(g.gl_pathv[i]);
+        }
+        globfree(&g);
+        if (files.empty()) {
+            fprintf(stderr, "VideoYUV: no input file matches %s\n", path.c_str());
+            exit(EXIT_FAILURE);
+        }
+    }
+#endif /* _WIN32 */
+    else {
+        files.push_back(path);
+    }
+
+    return files;
+}
+
+IOBackend *VideoYUV::openFile(int index)
+{
+    const std::string& path = segments[static_cast<size_t>(index)].path;
+    IOBackend *io = IOBackend::create(seekable ? IO_AUTO : IO_READ);
+    if (!io->open(path)) {
+        delete io;
+        if (!seekable || IOBackend::selected() == IO_READ)
+            return nullptr;
+        // O_DIRECT is not supported by all file systems
+        fprintf(stderr, "VideoYUV: %s backend cannot read %s, using read.\n", IOBackend::name(IOBackend::selected()), path.c_str());
+        io = IOBackend::create(IO_READ);
+        if (!io->open(path)) {
+            delete io;
+            return nullptr;
+        }
+    }
+    return io;
+}
+
+void VideoYUV::openSegment(int index)
+{
+    delete file;
+
+    segment = index;
+    if (next_file != nullptr && index == segment_ahead) {
+        file = next_file;
+    }
+    else {
+        delete next_file;
+        file = openFile(index);
+        if (file == nullptr) {
+            fprintf(stderr, "VideoYUV: cannot open input file (%s)\n", segments[static_cast<size_t>(index)].path.c_str());
+            exit(EXIT_FAILURE);
+        }
+    }
+    next_file = nullptr;
+    segment_ahead = -1;
+
+    // Open the following segment now and ask the kernel to start reading it,
+    // so that crossing the boundary does not stall on open() and cold reads.
+    if (static_cast<size_t>(index)+1 < segments.size()) {
+        next_file = openFile(index+1);
+        if (next_file != nullptr) {
+            segment_ahead = index+1;
+            next_file->willNeed();
+        }
+    }
+}
+
+int VideoYUV::getTotalFrames() const
+{
+    if (!seekable)
+        return -1;
+    const Segment& last = segments.back();
+    return static_cast<int>((last.start + last.bytes) / static_cast<int64_t>(frameBytes()));
+}
+
+bool VideoYUV::seekFrame(int frame)
+{
+    if (!seekable || frame < 0 || frame >= getTotalFrames()) {
+        fprintf(stderr, "seekFrame: cannot seek to frame %d.\n", frame);
+        return false;
+    }
+
+    int64_t offset = static_cast<int64_t>(frame) * static_cast<int64_t>(frameBytes());
+
+    // Last segment starting at or before the offset
+    size_t index = 0;
+    for (size_t lo=0, hi=segments.size(); lo<hi; ) {
+        size_t mid = (lo+hi)/2;
+        if (segments[mid].start <= offset) {
+            index = mid;
+            lo = mid+1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    // Skip empty segments
+    while (index+1 < segments.size() && segments[index].start + segments[index].bytes <= offset)
+        index++;
+
+    if (static_cast<int>(index) != segment)
+        openSegment(static_cast<int>(index));
+    if (!file->seek(offset - segments[index].start)) {
+        fprintf(stderr, "seekFrame: cannot seek to frame %d.\n", frame);
+        return false;
+    }
+
+    // Buffered frames are no longer the next ones
+    pool_count = 0;
+    pool_pos = 0;
+    next_read = frame;
+    return true;
+}
+
+void VideoYUV::setPoolSize(int nframes)
+{
+    delete[] pool;
+    pool_frames = nframes < 1 ? 1 : nframes;
+    pool = new imgpel[frameBytes()*static_cast<size_t>(pool_frames)];
+    pool_count = 0;
+    pool_pos = 0;
+
+    data = pool;
+    luma = data;
+    chroma[0] = data+static_cast<size_t>(comp_size[0]*sample_bytes);
+    chroma[1] = data+static_cast<size_t>((comp_size[0]+comp_size[1])*sample_bytes);
+}
+
+int VideoYUV::fillChunk(int nframes)
+{
+    if (nframes > pool_frames)
+        nframes = pool_frames;
+
+    // A single request for the whole chunk (frames are stored contiguously,
+    // component after component), so that the storage sees one long
+    // sequential extent instead of one request per row.
+    size_t frame_bytes = frameBytes();
+    size_t want = frame_bytes*static_cast<size_t>(nframes);
+    size_t got = 0;
+    TRACE_READ_START(this, next_read, nframes);
+    // Reads continue into the following segment, so a chunk may straddle a
+    // boundary.
+    while (got < want) {
+        ssize_t ret = file->read(pool+got, want-got);
+        if (ret < 0)
+            break;
+        if (ret == 0) {
+            if (static_cast<size_t>(segment)+1 >= segments.size())
+                break;
+            openSegment(segment+1);
+            continue;
         }
+        got += static_cast<size_t>(ret);
+    }
+
+    if (got % frame_bytes != 0) {
+        fprintf(stderr, "fillChunk: incomplete frame at the end of input file, ignored.\n");
+    }
+
+    pool_count = static_cast<int>(got / frame_bytes);
+    pool_pos = 0;
+    TRACE_READ_END(this, next_read, pool_count);
+    next_read += pool_count;
+    return pool_count;
+}
+
+int VideoYUV::bufferedFrames() const
+{
+    return pool_count - pool_pos;
+}
+
+size_t VideoYUV::frameBytes() const
+{
+    return static_cast<size_t>(size)*static_cast<size_t>(sample_bytes);
+}
+
+int VideoYUV::getHeight() const
+{
+    return height;
+}
+
+int VideoYUV::getWidth() const
+{
+    return width;
+}
+
+bool VideoYUV::readOneFrame()
+{
+    if (pool_pos >= pool_count && fillChunk(1) < 1) {
+        fprintf(stderr, "readOneFrame: cannot read %zu bytes from input file, unexpected EOF.\n", frameBytes());
+        return false;
     }
+
+    data = pool + frameBytes()*static_cast<size_t>(pool_pos);
+    luma = data;
+    chroma[0] = data+static_cast<size_t>(comp_size[0]*sample_bytes);
+    chroma[1] = data+static_cast<size_t>((comp_size[0]+comp_size[1])*sample_bytes);
+    pool_pos++;
+
     return true;
 }
 
+FrameRef VideoYUV::readFrame(FramePool& frames)
+{
+    if (!readOneFrame())
+        return FrameRef();
+    return getLuma(frames);
+}
+
+// Longest wait for a consumer to release a frame of a pool, in seconds
+static const double FRAME_WAIT = 10.0;
+
+// Free frame of the pool for the frame read last, or a null reference
+static FrameRef acquireFrame(FramePool& frames, int number)
+{
+    FrameRef frame = frames.acquire(FRAME_WAIT);
+    if (!frame) {
+        fprintf(stderr, "VideoYUV: no frame of the pool released within %.0f s for frame %d.\n", FRAME_WAIT, number);
+        return frame;
+    }
+    frame.fill()->number = number;
+    return frame;
+}
+
+FrameRef VideoYUV::getLuma(FramePool& frames)
+{
+    FrameRef frame = acquireFrame(frames, next_read - bufferedFrames() - 1);
+    if (frame)
+        getLuma(frame.fill()->image, frames.type());
+    return frame;
+}
+
+FrameRef VideoYUV::getRGB(FramePool& frames)
+{
+    FrameRef frame = acquireFrame(frames, next_read - bufferedFrames() - 1);
+    if (frame)
+        getRGB(frame.fill()->image);
+    return frame;
+}
+
 void VideoYUV::getLuma(cv::Mat& local_luma, int type)
 {
-    cv::Mat tmp(height, width, CV_8UC1, this->luma);
-    if (type == CV_8UC1) {
-        tmp.copyTo(local_luma);
+    if (lut.empty()) {
+        cv::Mat tmp(height, width, CV_8UC1, this->luma);
+        if (type == CV_8UC1) {
+            tmp.copyTo(local_luma);
+        }
+        else {
+            tmp.convertTo(local_luma, type);
+        }
+        return;
+    }
+
+    // Lookup and conversion in a single pass, straight into the destination
+    // when it is CV_32F
+    cv::Mat values;
+    if (type == CV_32F) {
+        local_luma.create(height, width, CV_32F);
+        values = local_luma;
     }
     else {
-        tmp.convertTo(local_luma, type);
+        values.create(height, width, CV_32F);
     }
+    const float *table = &lut[0];
+    int max_code = static_cast<int>(lut.size())-1;
+    for (int y=0; y<height; y++) {
+        float *dst = values.ptr<float>(y);
+        if (sample_bytes == 1) {
+            const imgpel *src = luma + static_cast<size_t>(y*width);
+            for (int x=0; x<width; x++)
+                dst[x] = table[src[x]];
+        }
+        else {
+            const imgpel *src = luma + static_cast<size_t>(2*y*width);
+            for (int x=0; x<width; x++) {
+                int code = src[2*x] | (src[2*x+1] << 8);
+                dst[x] = table[code < max_code ? code : max_code];
+            }
+        }
+    }
+
+    if (type != CV_32F) {
+        values.convertTo(local_luma, type);
+    }
+}
+
+void VideoYUV::getRGB(cv::Mat& rgb)
+{
+    // Components as CV_32F codes, at the luma resolution (no chroma is
+    // neutral grey)
+    float neutral = static_cast<float>(1 << (bitdepth-1));
+    cv::Mat planes[3];
+    for (int c=0; c<3; c++) {
+        if (comp_size[c] == 0) {
+            planes[c] = cv::Mat(height, width, CV_32F, cv::Scalar(neutral));
+            continue;
+        }
+        const imgpel *src = c == 0 ? luma : chroma[c-1];
+        cv::Mat plane(comp_height[c], comp_width[c], CV_32F);
+        for (int y=0; y<comp_height[c]; y++) {
+            float *dst = plane.ptr<float>(y);
+            const imgpel *row = src + static_cast<size_t>(y*comp_width[c]*sample_bytes);
+            if (sample_bytes == 1) {
+                for (int x=0; x<comp_width[c]; x++)
+                    dst[x] = row[x];
+            }
+            else {
+                for (int x=0; x<comp_width[c]; x++)
+                    dst[x] = static_cast<float>(row[2*x] | (row[2*x+1] << 8));
+            }
+        }
+        if (comp_height[c] != height || comp_width[c] != width)
+            cv::resize(plane, planes[c], cv::Size(width, height), 0, 0, cv::INTER_NEAREST);
+        else
+            planes[c] = plane;
+    }
+
+    // Y'CbCr codes to R'G'B' in a single affine transform
+    double kr = height >= 720 ? 0.2126 : 0.299;
+    double kb = height >= 720 ? 0.0722 : 0.114;
+    double kg = 1.0 - kr - kb;
+    double scale = static_cast<double>(1 << (bitdepth-8));
+    double max_code = static_cast<double>((1 << bitdepth) - 1);
+    double y_gain = full_range ? 1.0/max_code : 1.0/(219.0*scale);
+    double y_offset = full_range ? 0.0 : -16.0*scale*y_gain;
+    double c_gain = full_range ? 1.0/max_code : 1.0/(224.0*scale);
+    double c_offset = -static_cast<double>(neutral)*c_gain;
+    double r_cr = 2.0*(1.0-kr)*c_gain;
+    double g_cb = -2.0*kb*(1.0-kb)/kg*c_gain;
+    double g_cr = -2.0*kr*(1.0-kr)/kg*c_gain;
+    double b_cb = 2.0*(1.0-kb)*c_gain;
+    float m[] = {
+        static_cast<float>(y_gain), 0.0f, static_cast<float>(r_cr),
+        static_cast<float>(y_offset + 2.0*(1.0-kr)*c_offset),
+        static_cast<float>(y_gain), static_cast<float>(g_cb), static_cast<float>(g_cr),
+        static_cast<float>(y_offset + (g_cb + g_cr)/c_gain*c_offset),
+        static_cast<float>(y_gain), static_cast<float>(b_cb), 0.0f,
+        static_cast<float>(y_offset + 2.0*(1.0-kb)*c_offset)
+    };
+    cv::Mat ycbcr;
+    cv::merge(planes, 3, ycbcr);
+    cv::transform(ycbcr, rgb, cv::Mat(3, 4, CV_32F, m));
+    cv::min(rgb, 1.0, rgb);
+    cv::max(rgb, 0.0, rgb);
+}
+
+void VideoYUV::setTransfer(int transfer, bool range)
+{
+    full_range = range;
+    if (transfer == TRANSFER_SDR && bitdepth == 8)
+        lut.clear();
+    else
+        lut = PU21::lut(bitdepth, transfer, range);
 }
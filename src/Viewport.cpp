@@ -0,0 +1,87 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+#include <math.h>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "Viewport.hpp"
+
+Viewport::Viewport(int erp_height, int erp_width, double yaw, double pitch, double fov, int h, int w)
+{
+    height = h;
+    width = w;
+
+    const double deg = M_PI/180.0;
+    double tan_x = tan(fov*deg/2);
+    double tan_y = tan_x*h/w;
+    double cy = cos(yaw*deg), sy = sin(yaw*deg);
+    double cp = cos(pitch*deg), sp = sin(pitch*deg);
+
+    cv::Mat map_x(h, w, CV_32F), map_y(h, w, CV_32F);
+    for (int v=0; v<h; v++) {
+        float *px = map_x.ptr<float>(v);
+        float *py = map_y.ptr<float>(v);
+        for (int u=0; u<w; u++) {
+            // Ray through the pixel, camera looking along +z, y up
+            double x = (2.0*(u+0.5)/w - 1.0)*tan_x;
+            double y = (1.0 - 2.0*(v+0.5)/h)*tan_y;
+            double z = 1.0;
+
+            // Pitch (around x), then yaw (around y)
+            double y1 = y*cp + z*sp;
+            double z1 = -y*sp + z*cp;
+            double x2 = x*cy + z1*sy;
+            double z2 = -x*sy + z1*cy;
+
+            double lon = atan2(x2, z2);
+            double lat = atan2(y1, sqrt(x2*x2 + z2*z2));
+
+            // ERP sample positions, longitude wraps around, latitude is
+            // clamped so that the poles do not wrap to the other side
+            double ex = (lon/(2*M_PI) + 0.5)*erp_width - 0.5;
+            double ey = (0.5 - lat/M_PI)*erp_height - 0.5;
+            ey = ey < 0.0 ? 0.0 : (ey > erp_height-1 ? erp_height-1 : ey);
+            px[u] = static_cast<float>(ex);
+            py[u] = static_cast<float>(ey);
+        }
+    }
+
+    // Fixed-point maps take the fast path of remap()
+    cv::convertMaps(map_x, map_y, map_xy, map_frac, CV_16SC2);
+}
+
+void Viewport::render(const cv::Mat& erp, cv::Mat& view) const
+{
+    cv::remap(erp, view, map_xy, map_frac, cv::INTER_LINEAR, cv::BORDER_WRAP);
+}
+
+int Viewport::getHeight() const
+{
+    return height;
+}
+
+int Viewport::getWidth() const
+{
+    return width;
+}
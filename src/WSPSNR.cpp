@@ -31,12 +31,14 @@ WSPSNR::WSPSNR(int h, int w) : Metric(h, w)
 
 float WSPSNR::compute(const cv::Mat& original, const cv::Mat& processed)
 {
-    cv::Mat tmp (height, width,  CV_32F);
-    cv::Mat weights (height, width, CV_32F);
+    int h = original.rows;
+    int w = original.cols;
+    cv::Mat tmp (h, w,  CV_32F);
+    cv::Mat weights (h, w, CV_32F);
 
-    for (int j = 0; j < height; j++)
-        for (int i = 0; i < width; i++)
-            weights.at<float>(j, i) = static_cast<float> (cos ((j + 0.5 - (height / 2.0)) * M_PI / height));
+    for (int j = 0; j < h; j++)
+        for (int i = 0; i < w; i++)
+            weights.at<float>(j, i) = static_cast<float> (cos ((j + 0.5 - (h / 2.0)) * M_PI / h));
 
     cv::subtract(original, processed, tmp);
 
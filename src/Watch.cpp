@@ -0,0 +1,187 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+#ifdef HAVE_SYS_INOTIFY_H
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <vector>
+
+#include "Watch.hpp"
+
+// Set by SIGINT and SIGTERM
+static volatile sig_atomic_t stop_requested = 0;
+
+static void requestStop(int)
+{
+    stop_requested = 1;
+}
+
+Watch::Watch(const std::string& d, const std::string& e)
+{
+    dir = d;
+    ext = e;
+
+    fd = inotify_init1(IN_CLOEXEC);
+    if (fd < 0 || inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        fprintf(stderr, "Watch: cannot watch %s (%s)\n", dir.c_str(), strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    // Files already there are not handed over
+    scan(nullptr);
+}
+
+Watch::~Watch()
+{
+    close(fd);
+}
+
+int Watch::run(const std::function<void(const std::string&)>& handler)
+{
+    // No SA_RESTART, so that read() returns when a signal arrives
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = requestStop;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    printf("Watch: waiting for *%s files in %s.\n", ext.c_str(), dir.c_str());
+    fflush(stdout);
+
+    // Events are queued by the kernel while a file is handled
+    alignas(struct inotify_event) char buffer[64*1024];
+    while (!stop_requested) {
+        ssize_t len = read(fd, buffer, sizeof(buffer));
+        if (len < 0) {
+            if (errno == EINTR)
+                continue;
+            fprintf(stderr, "Watch: %s\n", strerror(errno));
+            return EXIT_FAILURE;
+        }
+
+        for (ssize_t pos=0; pos<len && !stop_requested; ) {
+            const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(buffer + pos);
+            pos += static_cast<ssize_t>(sizeof(struct inotify_event) + event->len);
+            if (event->mask & IN_Q_OVERFLOW) {
+                // Events were lost, the directory tells which files changed
+                fprintf(stderr, "Watch: event queue overflow, scanning %s again.\n", dir.c_str());
+                scan(&handler);
+                continue;
+            }
+            if (event->len == 0 || (event->mask & IN_ISDIR))
+                continue;
+            std::string name(event->name);
+            // Skip the events of the files already handled by a scan
+            if (!matches(name) || !update(name))
+                continue;
+            handler(dir + "/" + name);
+            fflush(stdout);
+        }
+    }
+
+    printf("Watch: stopped.\n");
+    return EXIT_SUCCESS;
+}
+
+bool Watch::matches(const std::string& name) const
+{
+    return name.size() > ext.size() && name.compare(name.size()-ext.size(), ext.size(), ext) == 0;
+}
+
+bool Watch::update(const std::string& name)
+{
+    struct stat st;
+    if (stat((dir + "/" + name).c_str(), &st) != 0) {
+        // Gone already, the handler reports it
+        seen.erase(name);
+        return true;
+    }
+    Stamp stamp;
+    stamp.bytes = st.st_size;
+    stamp.sec = st.st_mtim.tv_sec;
+    stamp.nsec = st.st_mtim.tv_nsec;
+
+    auto it = seen.find(name);
+    if (it != seen.end() && it->second.bytes == stamp.bytes && it->second.sec == stamp.sec && it->second.nsec == stamp.nsec)
+        return false;
+    seen[name] = stamp;
+    return true;
+}
+
+void Watch::scan(const std::function<void(const std::string&)> *handler)
+{
+    DIR *d = opendir(dir.c_str());
+    if (d == nullptr) {
+        fprintf(stderr, "Watch: cannot scan %s (%s)\n", dir.c_str(), strerror(errno));
+        return;
+    }
+    std::vector<std::string> names;
+    for (struct dirent *entry=readdir(d); entry!=nullptr; entry=readdir(d)) {
+        std::string name(entry->d_name);
+        if (matches(name))
+            names.push_back(name);
+    }
+    closedir(d);
+
+    // In name order, as a listing would show them
+    std::sort(names.begin(), names.end());
+    for (auto name : names) {
+        struct stat st;
+        if (stat((dir + "/" + name).c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+            continue;
+        if (update(name) && handler != nullptr && !stop_requested) {
+            (*handler)(dir + "/" + name);
+            fflush(stdout);
+        }
+    }
+}
+
+std::string Watch::reference(const std::string& pattern, const std::string& path)
+{
+    size_t slash = path.find_last_of('/');
+    std::string file = slash == std::string::npos ? path : path.substr(slash+1);
+    size_t dot = file.find_last_of('.');
+    std::string name = dot == std::string::npos ? file : file.substr(0, dot);
+    std::string prefix = name.substr(0, name.find('_'));
+
+    std::string result = pattern;
+    const std::string keys[2] = {"{name}", "{prefix}"};
+    const std::string values[2] = {name, prefix};
+    for (int k=0; k<2; k++) {
+        for (size_t at=result.find(keys[k]); at!=std::string::npos; at=result.find(keys[k], at+values[k].size()))
+            result.replace(at, keys[k].size(), values[k]);
+    }
+    return result;
+}
+
+#endif /* HAVE_SYS_INOTIFY_H */
@@ -40,6 +40,9 @@
    - SSIM: Structural Similarity (SSIM)
    - MSSSIM: Multi-Scale Structural Similarity (MS-SSIM)
    - VIFP: Visual Information Fidelity, pixel domain version (VIFp)
+   - VIF: Visual Information Fidelity, wavelet domain version (VIF)
+   - GMSD: Gradient Magnitude Similarity Deviation (GMSD)
+   - SSIMULACRA2: SSIMULACRA 2, on the colour components
    - PSNRHVS: Peak Signal-to-Noise Ratio taking into account Contrast Sensitivity Function (CSF) (PSNR-HVS)
    - PSNRHVSM: Peak Signal-to-Noise Ratio taking into account Contrast Sensitivity Function (CSF) and between-coefficient contrast masking of DCT basis functions (PSNR-HVS-M)
 
@@ -56,9 +59,11 @@ And also Spherical metrics:
 
  Notes:
  - SSIM comes for free when MSSSIM is computed (but you still need to specify it to get the output)
+ - GMSD shares the first MS-SSIM downsampling when both are computed
  - PSNRHVS and PSNRHVSM are always computed at the same time (but you still need to specify both to get the two outputs)
- - When using MSSSIM, the height and width of the video have to be multiple of 16
- - When using VIFP, the height and width of the video have to be multiple of 8
+ - When using MSSSIM, the height and width of the video have to be at least 161
+ - When using VIFP, the height and width of the video have to be at least 41
+ - When using VIF, the height and width of the video have to be at least 65
 
  Changes in version 1.1 (since 1.0) on 30/3/13
  - Added support for large files (>2GB)
@@ -69,7 +74,11 @@ And also Spherical metrics:
 #include <iostream>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include <string>
+#include <algorithm>
+#include <chrono>
 #include <opencv2/core/core.hpp>
 
 //Boost::program_options
@@ -77,186 +86,845 @@ And also Spherical metrics:
 namespace po = boost::program_options;
 
 #include "VideoYUV.hpp"
-#include "PSNR.hpp"
-#include "SSIM.hpp"
-#include "MSSSIM.hpp"
-#include "VIFP.hpp"
-#include "PSNRHVS.hpp"
-
-// Spherical metrics
-#include "WSPSNR.hpp"
-
-enum Metrics {
-    METRIC_PSNR = 0,
-    METRIC_SSIM,
-    METRIC_MSSSIM,
-    METRIC_VIFP,
-    METRIC_PSNRHVS,
-    METRIC_PSNRHVSM,
-
-    METRIC_WSPSNR,
-    METRIC_WSSSIM,
-    METRIC_WSMMSSSIM,
-    METRIC_SIZE
-};
-
-std::map<std::string, Metrics> metric2index = {
-    {"PSNR", METRIC_PSNR},
-    {"SSIM", METRIC_SSIM},
-    {"MSSSIM", METRIC_MSSSIM},
-    {"VIFP", METRIC_VIFP},
-    {"PSNRHVS", METRIC_PSNRHVS},
-    {"PSNRHVSM", METRIC_PSNRHVSM},
-    {"WSPSNR", METRIC_WSPSNR},
-};
+#include "IOBackend.hpp"
+#include "ReadScheduler.hpp"
+#include "ThreadPool.hpp"
+#include "MetricEngine.hpp"
+#ifndef _WIN32
+#include "Cluster.hpp"
+#endif
+#include "Roofline.hpp"
+#include "ReducedReference.hpp"
+#include "Analysis.hpp"
+#include "NoReference.hpp"
+#include "AdaptiveSampler.hpp"
+#include "LoadShedder.hpp"
+#include "Viewport.hpp"
+#include "Alignment.hpp"
+#include "Watch.hpp"
+#include "ImageScorer.hpp"
+#include "SystemInfo.hpp"
+#include "Trace.hpp"
 
-int main (int argc, const char *argv[])
+// Open a stream, check the number of frames to process and position the
+// stream on the first one
+static VideoYUV *openStream(const std::string& path, int height, int width, int chroma, int bitdepth,
+                            int transfer, bool full_range, int start, int& nbframes)
 {
-    po::options_description desc("Allowed options");
-    desc.add_options()
-      ("help",          "produce this help message")
-      ("original,i",    po::value<std::string>(), "Original video stream (YUV)")
-      ("processed,p",   po::value<std::string>(), "Processed video stream (YUV)")
-      ("width,w",       po::value<int>(), "Width")
-      ("height,h",      po::value<int>(), "Height")
-      ("frames,f",      po::value<int>(), "Number of frames")
-      ("chroma,c",      po::value<int>(), "Chroma format")
-      ("results,r",     po::value<std::string>(), "Output dir for results")
-      ("metrics,m",     po::value<std::vector<std::string>>()->multitoken(), "Metrics to compute")
-      ;
+    VideoYUV *video = new VideoYUV(VideoYUV::expandPath(path), height, width, nbframes, chroma, bitdepth);
+    video->setTransfer(transfer, full_range);
 
-    po::variables_map vm;
-    po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
-    po::notify(vm);
+    if (nbframes < 0) {
+        int total = video->getTotalFrames();
+        if (total < 0) {
+            fprintf(stderr, "'frames' is required when reading from a pipe.\n");
+            exit(EXIT_FAILURE);
+        }
+        nbframes = total - start;
+    }
 
-    if (vm.count("help")) {
-        std::cout << desc << "\n";
-        return 1;
+    if (start > 0 && !video->seekFrame(start)) {
+        exit(EXIT_FAILURE);
     }
 
-    double duration = static_cast<double>(cv::getTickCount());
+    return video;
+}
 
-    // Input parameters.
-    int width    = vm["width"].as<int>();
-    int height   = vm["height"].as<int>();
-    int nbframes = vm["frames"].as<int>();
-    int chroma   = vm["chroma"].as<int>();
+#ifdef HAVE_SYS_INOTIFY_H
+// Watch mode: open a completed file like openStream(), or return nullptr
+// after reporting why it cannot be scored, so that the resident process
+// goes on with the next files
+static bool openWatchedStream(VideoYUV *&video, const std::string& path, int height, int width, int chroma, int bitdepth,
+                              int transfer, bool full_range, int start, int& nbframes)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode) || access(path.c_str(), R_OK) != 0) {
+        fprintf(stderr, "Watch: cannot read %s, skipped.\n", path.c_str());
+        return false;
+    }
 
-    std::string orig_path = vm["original"].as<std::string>();
-    std::string proc_path = vm["processed"].as<std::string>();
-    std::string results_path = vm["processed"].as<std::string>();
+    // The stream of the first file is reopened on the following ones,
+    // keeping its buffers
+    if (video == nullptr) {
+        video = new VideoYUV(std::vector<std::string>(1, path), height, width, nbframes, chroma, bitdepth);
+        video->setTransfer(transfer, full_range);
+    }
+    else if (!video->open(std::vector<std::string>(1, path))) {
+        fprintf(stderr, "Watch: cannot read %s, skipped.\n", path.c_str());
+        return false;
+    }
 
-    // Input video streams.
-    VideoYUV *original  = new VideoYUV(orig_path.c_str(), height, width, nbframes, chroma);
-    VideoYUV *processed = new VideoYUV(proc_path.c_str(), height, width, nbframes, chroma);
+    int total = video->getTotalFrames();
+    if (nbframes < 0)
+        nbframes = total - start;
+    if (nbframes < 1 || start + nbframes > total || (start > 0 && !video->seekFrame(start))) {
+        fprintf(stderr, "Watch: %s has %d frames, frames %d to %d cannot be read, skipped.\n",
+                path.c_str(), total, start, start+nbframes-1);
+        return false;
+    }
 
-    // Output files for results.
-    FILE *result_file[METRIC_SIZE] = {nullptr};
-    char *str = new char[256];
-    for (auto metric : vm["metrics"].as<std::vector<std::string>>()) {
+    return true;
+}
+#endif /* HAVE_SYS_INOTIFY_H */
+
+// Known metrics of a list, without duplicates
+static std::vector<std::string> selectMetrics(const std::vector<std::string>& names)
+{
+    std::vector<std::string> metrics;
+    for (auto metric : names) {
         if (metric2index.count (metric)) {
-            sprintf(str, "%s_%s.csv", results_path.c_str(), metric.c_str ());
-            result_file[metric2index[metric]] = fopen(str, "w");
+            if (!std::count(metrics.begin(), metrics.end(), metric))
+                metrics.push_back(metric);
         }
         else {
             printf ("Warning: Metric %s not recognized and will be ignored.\n", metric.c_str() );
         }
     }
-    delete[] str;
+    return metrics;
+}
+
+// Why the frame is too small for the smallest level of the metrics, or
+// nullptr if it is large enough
+static const char *sizeError(const std::vector<std::string>& metrics, int height, int width)
+{
+    // Check size for VIFp downsampling (3x3 window on the 4th scale): each
+    // scale is filtered 'valid' (9, 5 and 3 taps) then decimated, so
+    // 41 -> 17 -> 7 -> 3.
+    if (std::count(metrics.begin(), metrics.end(), "VIFP") && (height < 41 || width < 41))
+        return "VIFp: 'height' and 'width' have to be at least 41.";
 
-    // Check size for VIFp downsampling.
-    if (result_file[METRIC_VIFP] != nullptr && (height % 8 != 0 || width % 8 != 0)) {
-        fprintf(stderr, "VIFp: 'height' and 'width' have to be multiple of 8.\n");
+    // Check size for the VIF pyramid (blocks away from the borders on the
+    // 4th level): 65 -> 33 -> 17 -> 9.
+    if (std::count(metrics.begin(), metrics.end(), "VIF") && (height < VIF::MIN_SIZE || width < VIF::MIN_SIZE))
+        return "VIF: 'height' and 'width' have to be at least 65.";
+
+    // Check size for MS-SSIM downsampling (11x11 window on the 5th level).
+    if (std::count(metrics.begin(), metrics.end(), "MSSSIM") && (height < 161 || width < 161))
+        return "MS-SSIM: 'height' and 'width' have to be at least 161.";
+
+    return nullptr;
+}
+
+// Check that the frame is large enough for the smallest level of the
+// metrics
+static void checkSize(const std::vector<std::string>& metrics, int height, int width)
+{
+    const char *error = sizeError(metrics, height, width);
+    if (error != nullptr) {
+        fprintf(stderr, "%s\n", error);
         exit(EXIT_FAILURE);
     }
+}
 
-    // Check size for MS-SSIM downsampling.
-    if (result_file[METRIC_MSSSIM] != nullptr && (height % 16 != 0 || width % 16 != 0)) {
-        fprintf(stderr, "MS-SSIM: 'height' and 'width' have to be multiple of 16.\n");
+// Alignment pre-pass: estimate the offset between the streams on their
+// first frames, then position both streams back on the first frame
+static Alignment *estimateAlignment(VideoYUV *original, VideoYUV *processed, int start, int nbframes, int nframes,
+                                    int max_shift, bool subpixel)
+{
+    if (original->getTotalFrames() < 0 || processed->getTotalFrames() < 0) {
+        fprintf(stderr, "Alignment: the inputs have to be files.\n");
         exit(EXIT_FAILURE);
     }
 
-    // Print header to file.
-    for (int m=0; m<METRIC_SIZE; m++) {
-        if (result_file[m] != nullptr) {
-            fprintf(result_file[m], "frame,value\n");
+    Alignment *alignment = new Alignment(max_shift, subpixel);
+    cv::Mat original_frame, processed_frame;
+    for (int i=0; i<nframes && i<nbframes; i++) {
+        if (!original->readOneFrame() || !processed->readOneFrame()) exit(EXIT_FAILURE);
+        original->getLuma(original_frame, CV_32F);
+        processed->getLuma(processed_frame, CV_32F);
+        alignment->addFrames(original_frame, processed_frame);
+    }
+    if (!alignment->estimate()) exit(EXIT_FAILURE);
+    if (!original->seekFrame(start) || !processed->seekFrame(start)) exit(EXIT_FAILURE);
+
+    printf("Alignment: offset (%.2f, %.2f), metrics on %dx%d\n", alignment->getOffsetX(), alignment->getOffsetY(),
+           alignment->getWidth(), alignment->getHeight());
+    return alignment;
+}
+
+// Reduced-reference pass on the original stream: store the signatures
+static int extractSignatures(VideoYUV *original, int start, int nbframes, ReducedReference& rr, const std::string& path)
+{
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        fprintf(stderr, "RR: cannot create signature file (%s)\n", path.c_str());
+        return EXIT_FAILURE;
+    }
+    bool written = rr.writeHeader(file, start);
+
+    cv::Mat frame;
+    std::vector<float> signature;
+    for (int f=start; written && f<start+nbframes; f++) {
+        printf ("Extracting signature for frame %d.\n", f);
+        if (!original->readOneFrame()) exit(EXIT_FAILURE);
+        original->getLuma(frame, CV_32F);
+        rr.extract(frame, signature);
+        written = fwrite(&signature[0], sizeof(float), signature.size(), file) == signature.size();
+    }
+
+    // A truncated signature file would be misread by --rr-score
+    if (fclose(file) != 0)
+        written = false;
+    if (!written) {
+        fprintf(stderr, "RR: cannot write signature file (%s)\n", path.c_str());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+// Pre-analysis of a single stream: per-frame statistics and per-block maps
+static int analyzeSource(VideoYUV *original, int start, int nbframes, size_t readahead, FramePool& frames,
+                         Analysis& analysis, const std::string& path)
+{
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        fprintf(stderr, "Analysis: cannot create analysis file (%s)\n", path.c_str());
+        return EXIT_FAILURE;
+    }
+    bool written = analysis.writeHeader(file, start);
+
+    // Large reads, the analysis itself is a few passes over each frame
+    int chunk = static_cast<int>(std::min(readahead / original->frameBytes(), static_cast<size_t>(nbframes)));
+    if (chunk < 1)
+        chunk = 1;
+    original->setPoolSize(chunk);
+
+    std::vector<float> stats;
+    std::vector<uint16_t> variance, activity;
+    float si_max = 0.0f, ti_max = 0.0f;
+    int scenes = 0;
+    for (int f=start; written && f<start+nbframes; f++) {
+        if (original->bufferedFrames() == 0)
+            original->fillChunk(std::min(chunk, start+nbframes-f));
+        FrameRef frame = original->readFrame(frames);
+        if (!frame) exit(EXIT_FAILURE);
+        analysis.analyze(frame, stats, variance, activity);
+        written = fwrite(&stats[0], sizeof(float), stats.size(), file) == stats.size()
+               && fwrite(&variance[0], sizeof(uint16_t), variance.size(), file) == variance.size()
+               && fwrite(&activity[0], sizeof(uint16_t), activity.size(), file) == activity.size();
+        si_max = std::max(si_max, stats[2]);
+        ti_max = std::max(ti_max, stats[3]);
+        if (stats[4] > 0.0f) {
+            printf("Scene %d starts at frame %d.\n", scenes, f);
+            scenes++;
         }
     }
 
-    PSNR *psnr     = new PSNR(height, width);
-    SSIM *ssim     = new SSIM(height, width);
-    MSSSIM *msssim = new MSSSIM(height, width);
-    VIFP *vifp     = new VIFP(height, width);
-    PSNRHVS *phvs  = new PSNRHVS(height, width);
+    // A full disk may only show when the buffered data is flushed
+    if (fclose(file) != 0)
+        written = false;
+    if (!written) {
+        fprintf(stderr, "Analysis: cannot write analysis file (%s)\n", path.c_str());
+        return EXIT_FAILURE;
+    }
 
-    // Spherical metrics.
-    WSPSNR *wspsnr = new WSPSNR(height, width);
+    printf("SI: %.2f, TI: %.2f, scenes: %d\n", static_cast<double>(si_max), static_cast<double>(ti_max), scenes);
+    return EXIT_SUCCESS;
+}
 
-    cv::Mat original_frame(height,width,CV_32F), processed_frame(height,width,CV_32F);
-    float result[METRIC_SIZE] = {0};
-    float result_avg[METRIC_SIZE] = {0};
+// Reduced-reference pass on the processed stream: score against the signatures
+static int scoreSignatures(VideoYUV *processed, int start, int nbframes, ReducedReference& rr,
+                           const std::string& path, const std::string& results_path, const std::string& prefix)
+{
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        fprintf(stderr, "RR: cannot open signature file (%s)\n", path.c_str());
+        return EXIT_FAILURE;
+    }
+    int first;
+    if (!rr.readHeader(file, first)) exit(EXIT_FAILURE);
+    long header = ftell(file);
+    size_t sig_size = rr.signatureSize();
 
-    for (int frame=0; frame<nbframes; frame++) {
-        printf ("Computing metrics for frame %d.\n", frame);
+    const char *names[2] = {"RRSSIM", "RRED"};
+    FILE *result_file[2];
+    for (int m=0; m<2; m++) {
+        std::string name = results_path + "_" + prefix + names[m] + ".csv";
+        result_file[m] = fopen(name.c_str(), "w");
+        if (result_file[m] == nullptr) {
+            fprintf(stderr, "RR: cannot create results file (%s)\n", name.c_str());
+            exit(EXIT_FAILURE);
+        }
+        fprintf(result_file[m], "frame,value\n");
+    }
 
+    cv::Mat frame;
+    std::vector<float> signature(sig_size);
+    double result_avg[2] = {0.0, 0.0};
+    for (int f=start; f<start+nbframes; f++) {
+        printf ("Computing RR metrics for frame %d.\n", f);
+        long offset = header + (f-first)*static_cast<long>(sig_size*sizeof(float));
+        if (f < first || fseek(file, offset, SEEK_SET) != 0
+            || fread(&signature[0], sizeof(float), sig_size, file) != sig_size) {
+            fprintf(stderr, "RR: no signature for frame %d.\n", f);
+            exit(EXIT_FAILURE);
+        }
+
+        if (!processed->readOneFrame()) exit(EXIT_FAILURE);
+        processed->getLuma(frame, CV_32F);
+        cv::Scalar res = rr.score(signature, frame);
+
+        for (int m=0; m<2; m++) {
+            result_avg[m] += res.val[m];
+            fprintf(result_file[m], "%d,%.6f\n", f, res.val[m]);
+        }
+    }
+
+    for (int m=0; m<2; m++) {
+        fprintf(result_file[m], "average,%.6f", result_avg[m] / nbframes);
+        fclose(result_file[m]);
+    }
+    fclose(file);
+    return EXIT_SUCCESS;
+}
+
+// No-reference training: NIQE model of the sharpest patches of pristine
+// frames
+static int trainModel(VideoYUV *original, int start, int nbframes, NoReference& nr, const std::string& path)
+{
+    cv::Mat frame;
+    std::vector<float> features, patches, sharpness;
+    for (int f=start; f<start+nbframes; f++) {
+        printf ("Extracting NR features for frame %d.\n", f);
         if (!original->readOneFrame()) exit(EXIT_FAILURE);
-        original->getLuma(original_frame, CV_32F);
+        original->getLuma(frame, CV_32F);
+        nr.analyze(frame(nr.patchArea()));
+        nr.patchFeatures(patches, sharpness);
+
+        float threshold = 0.75f * *std::max_element(sharpness.begin(), sharpness.end());
+        for (size_t p=0; p<sharpness.size(); p++) {
+            if (sharpness[p] > threshold) {
+                const float *patch = &patches[p*NoReference::NFEATURES];
+                features.insert(features.end(), patch, patch + NoReference::NFEATURES);
+            }
+        }
+    }
+    return NoReference::saveModel(path, features) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
 
+// Create a no-reference results file
+static FILE *createNoReferenceFile(const std::string& name)
+{
+    FILE *file = fopen(name.c_str(), "w");
+    if (file == nullptr) {
+        fprintf(stderr, "NR: cannot create results file (%s)\n", name.c_str());
+        exit(EXIT_FAILURE);
+    }
+    return file;
+}
+
+// No-reference pass on the processed stream: BRISQUE features, the BRISQUE
+// score if a regressor is given, and NIQE against a pristine model if one
+// is given
+static int scoreNoReference(VideoYUV *processed, int start, int nbframes, NoReference& nr, bool brisque, bool niqe,
+                            const std::string& results_path, const std::string& prefix)
+{
+    FILE *features_file = createNoReferenceFile(results_path + "_" + prefix + "BRISQUEFEATURES.csv");
+    fprintf(features_file, "frame");
+    for (int i=0; i<NoReference::NFEATURES; i++)
+        fprintf(features_file, ",f%d", i+1);
+    fprintf(features_file, "\n");
+
+    FILE *brisque_file = nullptr;
+    if (brisque) {
+        brisque_file = createNoReferenceFile(results_path + "_" + prefix + "BRISQUE.csv");
+        fprintf(brisque_file, "frame,value\n");
+    }
+
+    FILE *niqe_file = nullptr;
+    if (niqe) {
+        niqe_file = createNoReferenceFile(results_path + "_" + prefix + "NIQE.csv");
+        fprintf(niqe_file, "frame,value\n");
+    }
+
+    cv::Mat frame;
+    float features[NoReference::NFEATURES];
+    std::vector<float> patches, sharpness;
+    double brisque_avg = 0.0, niqe_avg = 0.0;
+    for (int f=start; f<start+nbframes; f++) {
+        printf ("Computing NR metrics for frame %d.\n", f);
         if (!processed->readOneFrame()) exit(EXIT_FAILURE);
-        processed->getLuma(processed_frame, CV_32F);
+        processed->getLuma(frame, CV_32F);
+        nr.analyze(frame);
+
+        nr.frameFeatures(features);
+        fprintf(features_file, "%d", f);
+        for (int i=0; i<NoReference::NFEATURES; i++)
+            fprintf(features_file, ",%.6f", static_cast<double>(features[i]));
+        fprintf(features_file, "\n");
 
-        // Compute PSNR
-        if (result_file[METRIC_PSNR] != nullptr) {
-            result[METRIC_PSNR] = psnr->compute(original_frame, processed_frame);
+        if (brisque) {
+            double value = static_cast<double>(nr.brisque(features));
+            brisque_avg += value;
+            fprintf(brisque_file, "%d,%.6f\n", f, value);
         }
 
-        // Compute SSIM and MS-SSIM
-        if (result_file[METRIC_SSIM] != nullptr && result_file[METRIC_MSSSIM] == nullptr) {
-            result[METRIC_SSIM] = ssim->compute(original_frame, processed_frame);
+        if (niqe) {
+            // NIQE normalizes the frame cropped to whole patches
+            cv::Rect area = nr.patchArea();
+            if (area.width != frame.cols || area.height != frame.rows)
+                nr.analyze(frame(area));
+            nr.patchFeatures(patches, sharpness);
+            double value = static_cast<double>(nr.niqe(patches));
+            niqe_avg += value;
+            fprintf(niqe_file, "%d,%.6f\n", f, value);
         }
+    }
+
+    fclose(features_file);
+    if (brisque) {
+        fprintf(brisque_file, "average,%.6f", brisque_avg / nbframes);
+        fclose(brisque_file);
+    }
+    if (niqe) {
+        fprintf(niqe_file, "average,%.6f", niqe_avg / nbframes);
+        fclose(niqe_file);
+    }
+    return EXIT_SUCCESS;
+}
+
+// Adaptive mode: PSNR on every frame, the other metrics on a stratified
+// sample of the frames, and estimates of their averages
+static int adaptiveScoring(VideoYUV *original, VideoYUV *processed, ReadScheduler *reader, int height, int width,
+                           int start, int nbframes, const std::vector<std::string>& metrics, double fraction,
+                           const std::string& results_path, const std::string& prefix, MetricEngine& engine)
+{
+    PSNR psnr(height, width);
+    std::vector<cv::Mat> original_frames(1), processed_frames(1);
+
+    // Cheap pass over all the frames
+    std::vector<float> cheap(static_cast<size_t>(nbframes));
+    for (int i=0; i<nbframes; i++) {
+        printf ("Computing PSNR for frame %d.\n", start+i);
+        if (!reader->readOneFrame()) exit(EXIT_FAILURE);
+        original->getLuma(original_frames[0], CV_32F);
+        processed->getLuma(processed_frames[0], CV_32F);
+        cheap[static_cast<size_t>(i)] = psnr.compute(original_frames[0], processed_frames[0]);
+    }
 
-        if (result_file[METRIC_MSSSIM] != nullptr) {
-            msssim->compute(original_frame, processed_frame);
+    AdaptiveSampler sampler(fraction);
+    std::vector<int> chosen = sampler.select(cheap);
 
-            if (result_file[METRIC_SSIM] != nullptr) {
-                result[METRIC_SSIM] = msssim->getSSIM();
+    // Expensive pass over the chosen frames
+    std::vector<std::vector<float>> values(METRIC_SIZE);
+    std::vector<float> results;
+    int position = start+nbframes;
+    for (int i : chosen) {
+        int frame = start+i;
+        printf ("Computing metrics for frame %d.\n", frame);
+        if (frame != position && (!original->seekFrame(frame) || !processed->seekFrame(frame))) exit(EXIT_FAILURE);
+        if (!original->readOneFrame() || !processed->readOneFrame()) exit(EXIT_FAILURE);
+        position = frame+1;
+        original->getLuma(original_frames[0], CV_32F);
+        processed->getLuma(processed_frames[0], CV_32F);
+        engine.computeBatch(frame, original_frames, processed_frames, results);
+        for (int m=0; m<METRIC_SIZE; m++) {
+            if (engine.isEnabled(m))
+                values[static_cast<size_t>(m)].push_back(results[static_cast<size_t>(m)]);
+        }
+    }
+
+    for (auto metric : metrics) {
+        std::string name = results_path + "_" + prefix + metric + ".csv";
+        FILE *result_file = fopen(name.c_str(), "w");
+        if (result_file == nullptr) {
+            fprintf(stderr, "Adaptive: cannot create results file (%s)\n", name.c_str());
+            exit(EXIT_FAILURE);
+        }
+        fprintf(result_file, "frame,value\n");
+        int m = metric2index.at(metric);
+
+        if (m == METRIC_PSNR) {
+            double avg = 0.0;
+            for (int i=0; i<nbframes; i++) {
+                avg += double(cheap[static_cast<size_t>(i)]);
+                fprintf(result_file, "%d,%.6f\n", start+i, double(cheap[static_cast<size_t>(i)]));
             }
+            fprintf(result_file, "average,%.6f", avg / nbframes);
+        }
+        else {
+            const std::vector<float>& v = values[static_cast<size_t>(m)];
+            double mean, ci95;
+            sampler.estimate(v, mean, ci95);
+            for (size_t i=0; i<chosen.size(); i++)
+                fprintf(result_file, "%d,%.6f\n", start+chosen[i], double(v[i]));
+            fprintf(result_file, "ci95,%.6f\n", ci95);
+            fprintf(result_file, "average,%.6f", mean);
+            printf("%s%s: %.6f +/- %.6f (95%% CI, %zu of %d frames)\n", prefix.c_str(), metric.c_str(), mean, ci95, chosen.size(), nbframes);
+        }
+        fclose(result_file);
+    }
+
+    return EXIT_SUCCESS;
+}
 
-            result[METRIC_MSSSIM] = msssim->getMSSSIM();
+// Real-time mode: each metric has its own engine (for the full and half
+// resolution frames alike), so that it can be timed and shed on its own
+// when the frames are not scored as fast as they arrive (see LoadShedder)
+// reader: reads one frame at a time, so that each frame is timed when it
+// arrives
+static int realtimeScoring(VideoYUV *original, VideoYUV *processed, ReadScheduler *reader, int height, int width,
+                           int start, int nbframes, const std::vector<std::string>& metrics, double fps,
+                           const std::string& results_path, const std::string& prefix, ThreadPool *pool)
+{
+    int half_height = (height+1)/2;
+    int half_width = (width+1)/2;
+    size_t nmetrics = metrics.size();
+    std::vector<int> indexes;
+    std::vector<bool> half;
+    std::vector<MetricEngine *> engines;
+    std::vector<FILE *> result_files;
+    for (auto metric : metrics) {
+        int m = metric2index.at(metric);
+        bool enabled[METRIC_SIZE] = {false};
+        enabled[m] = true;
+        bool fits = sizeError(std::vector<std::string>(1, metric), half_height, half_width) == nullptr;
+        indexes.push_back(m);
+        half.push_back(fits);
+        engines.push_back(new MetricEngine(height, width, enabled, pool));
+        std::string name = results_path + "_" + prefix + metric + ".csv";
+        result_files.push_back(fopen(name.c_str(), "w"));
+        if (result_files.back() == nullptr) {
+            fprintf(stderr, "Realtime: cannot create results file (%s)\n", name.c_str());
+            exit(EXIT_FAILURE);
         }
+        // The resolution the value was computed at: full or half
+        fprintf(result_files.back(), "frame,value,resolution\n");
+    }
+    std::string log_name = results_path + "_" + prefix + "REALTIME.csv";
+    FILE *log_file = fopen(log_name.c_str(), "w");
+    if (log_file == nullptr) {
+        fprintf(stderr, "Realtime: cannot create log file (%s)\n", log_name.c_str());
+        exit(EXIT_FAILURE);
+    }
+    fprintf(log_file, "frame,lag_ms");
+    for (auto metric : metrics)
+        fprintf(log_file, ",%s", metric.c_str());
+    fprintf(log_file, "\n");
+
+    LoadShedder shedder(fps, indexes, half);
+    std::vector<cv::Mat> original_frames(1), processed_frames(1), original_half(1), processed_half(1);
+    std::vector<cv::Mat> original_rgb(1), processed_rgb(1), original_rgb_half(1), processed_rgb_half(1);
+    std::vector<float> results;
+    std::vector<double> sums(nmetrics, 0.0);
+    std::vector<long> computed(nmetrics, 0);
 
-        // Compute VIFp,
-        if (result_file[METRIC_VIFP] != nullptr) {
-            result[METRIC_VIFP] = vifp->compute(original_frame, processed_frame);
+    std::chrono::steady_clock::time_point t0;
+    for (int i=0; i<nbframes; i++) {
+        int frame = start+i;
+        if (!reader->readOneFrame()) exit(EXIT_FAILURE);
+        // Arrival of the frame, real time starts with the first one
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (i == 0)
+            t0 = now;
+        double lag = std::chrono::duration<double>(now - t0).count() - i/fps;
+
+        if (shedder.plan(i, lag)) {
+            printf("Realtime: frame %d, %.0f ms late:", frame, lag*1000.0);
+            for (size_t k=0; k<nmetrics; k++)
+                printf(" %s %s%s", metrics[k].c_str(), shedder.describe(k).c_str(), k+1<nmetrics ? "," : "\n");
         }
 
-        // Compute PSNR-HVS and PSNR-HVS-M,
-        if (result_file[METRIC_PSNRHVS] != nullptr || result_file[METRIC_PSNRHVSM] != nullptr) {
-            phvs->compute(original_frame, processed_frame);
+        original->getLuma(original_frames[0], CV_32F);
+        processed->getLuma(processed_frames[0], CV_32F);
+        bool frames_rgb = false, frames_half = false, frames_rgb_half = false;
+        fprintf(log_file, "%d,%.1f", frame, lag*1000.0);
+        for (size_t k=0; k<nmetrics; k++) {
+            if (!shedder.runs(k)) {
+                fprintf(log_file, ",shed");
+                continue;
+            }
+            bool halved = shedder.halved(k);
+            MetricEngine *engine = engines[k];
+            // Inputs converted once per frame, when a metric needs them
+            if (engine->needsColor() && !frames_rgb) {
+                original->getRGB(original_rgb[0]);
+                processed->getRGB(processed_rgb[0]);
+                frames_rgb = true;
+            }
+            if (halved && !frames_half) {
+                cv::Size size(half_width, half_height);
+                cv::resize(original_frames[0], original_half[0], size, 0, 0, cv::INTER_AREA);
+                cv::resize(processed_frames[0], processed_half[0], size, 0, 0, cv::INTER_AREA);
+                frames_half = true;
+            }
+            if (halved && engine->needsColor() && !frames_rgb_half) {
+                cv::Size size(half_width, half_height);
+                cv::resize(original_rgb[0], original_rgb_half[0], size, 0, 0, cv::INTER_AREA);
+                cv::resize(processed_rgb[0], processed_rgb_half[0], size, 0, 0, cv::INTER_AREA);
+                frames_rgb_half = true;
+            }
+
+            std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+            const std::vector<cv::Mat>& o = halved ? original_half : original_frames;
+            const std::vector<cv::Mat>& p = halved ? processed_half : processed_frames;
+            if (engine->needsColor())
+                engine->computeBatch(frame, o, p, halved ? original_rgb_half : original_rgb,
+                                     halved ? processed_rgb_half : processed_rgb, results);
+            else
+                engine->computeBatch(frame, o, p, results);
+            shedder.record(k, std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+
+            float value = results[static_cast<size_t>(indexes[k])];
+            fprintf(result_files[k], "%d,%.6f,%s\n", frame, static_cast<double>(value), halved ? "half" : "full");
+            fprintf(log_file, ",%s", halved ? "half" : "full");
+            sums[k] += static_cast<double>(value);
+            computed[k]++;
+        }
+        fprintf(log_file, "\n");
+    }
 
-            if (result_file[METRIC_PSNRHVS] != nullptr) {
-                result[METRIC_PSNRHVS] = phvs->getPSNRHVS();
+    for (size_t k=0; k<nmetrics; k++) {
+        long full, halves, shed;
+        shedder.counts(k, full, halves, shed);
+        printf("Realtime: %s%s on %ld frames at full and %ld at half resolution, %ld shed, %.2f ms per frame.\n",
+               prefix.c_str(), metrics[k].c_str(), full, halves, shed, shedder.cost(k)*1000.0);
+        fprintf(result_files[k], "average,%.6f", computed[k] > 0 ? sums[k] / static_cast<double>(computed[k]) : 0.0);
+        fclose(result_files[k]);
+        delete engines[k];
+    }
+    fclose(log_file);
+    return EXIT_SUCCESS;
+}
+
+// Viewport mode: the metrics on rectilinear viewports of ERP frames, one
+// engine per viewport, viewports computed in parallel
+static int viewportScoring(VideoYUV *original, VideoYUV *processed, ReadScheduler *reader, int height, int width,
+                           int start, int nbframes, const std::vector<std::string>& metrics,
+                           const std::vector<std::string>& directions, double fov, int size,
+                           const std::string& results_path, const std::string& prefix, ThreadPool *pool)
+{
+    // Cube faces by default
+    std::vector<std::string> dirs = directions;
+    if (dirs.size() == 1 && dirs[0] == "cube")
+        dirs = {"0,0", "90,0", "180,0", "-90,0", "0,90", "0,-90"};
+
+    // Same angular resolution as the center of the ERP frame by default
+    if (size <= 0)
+        size = static_cast<int>(width*fov/360.0);
+    checkSize(metrics, size, size);
+
+    bool enabled[METRIC_SIZE] = {false};
+    for (auto metric : metrics)
+        enabled[metric2index.at(metric)] = true;
+
+    std::vector<Viewport *> viewports;
+    std::vector<MetricEngine *> engines;
+    for (auto dir : dirs) {
+        double yaw, pitch;
+        if (sscanf(dir.c_str(), "%lf,%lf", &yaw, &pitch) != 2) {
+            fprintf(stderr, "Viewport: invalid direction %s, expected YAW,PITCH in degrees.\n", dir.c_str());
+            exit(EXIT_FAILURE);
+        }
+        viewports.push_back(new Viewport(height, width, yaw, pitch, fov, size, size));
+        // Viewports run in parallel on the pool, their metrics inline
+        engines.push_back(new MetricEngine(size, size, enabled, nullptr));
+    }
+    size_t nviews = viewports.size();
+
+    // One file per viewport and metric, and the pooled (mean) values
+    std::vector<FILE *> result_files;
+    for (size_t v=0; v<=nviews; v++) {
+        for (auto metric : metrics) {
+            std::string name = results_path + (v < nviews ? "_vp" + std::to_string(v) : "_vp") + "_" + prefix + metric + ".csv";
+            FILE *result_file = fopen(name.c_str(), "w");
+            if (result_file == nullptr) {
+                fprintf(stderr, "Viewport: cannot create results file (%s)\n", name.c_str());
+                exit(EXIT_FAILURE);
             }
+            fprintf(result_file, "frame,value\n");
+            result_files.push_back(result_file);
+        }
+    }
 
-            if (result_file[METRIC_PSNRHVSM] != nullptr) {
-                result[METRIC_PSNRHVSM] = phvs->getPSNRHVSM();
+    // The ERP frames are decoded into pools and held by the viewport tasks
+    FramePool original_frames(1, height, width, CV_32F);
+    FramePool processed_frames(1, height, width, CV_32F);
+    std::vector<std::vector<cv::Mat>> original_views(nviews, std::vector<cv::Mat>(1));
+    std::vector<std::vector<cv::Mat>> processed_views(nviews, std::vector<cv::Mat>(1));
+    std::vector<std::vector<float>> results(nviews);
+    std::vector<double> result_avg(result_files.size(), 0.0);
+
+    for (int frame=start; frame<start+nbframes; frame++) {
+        printf ("Computing metrics for frame %d.\n", frame);
+        if (!reader->readOneFrame()) exit(EXIT_FAILURE);
+        FrameRef original_frame = original->getLuma(original_frames);
+        FrameRef processed_frame = processed->getLuma(processed_frames);
+        if (!original_frame || !processed_frame) exit(EXIT_FAILURE);
+
+        TaskGroup tasks(pool);
+        for (size_t v=0; v<nviews; v++) {
+            tasks.run([&, v, frame, original_frame, processed_frame] {
+                viewports[v]->render(original_frame->image, original_views[v][0]);
+                viewports[v]->render(processed_frame->image, processed_views[v][0]);
+                engines[v]->computeBatch(frame, original_views[v], processed_views[v], results[v]);
+            });
+        }
+        tasks.wait();
+
+        for (size_t m=0; m<metrics.size(); m++) {
+            int index = metric2index.at(metrics[m]);
+            double pooled = 0.0;
+            for (size_t v=0; v<nviews; v++) {
+                double value = double(results[v][static_cast<size_t>(index)]);
+                pooled += value;
+                result_avg[v*metrics.size()+m] += value;
+                fprintf(result_files[v*metrics.size()+m], "%d,%.6f\n", frame, value);
             }
+            pooled /= static_cast<double>(nviews);
+            result_avg[nviews*metrics.size()+m] += pooled;
+            fprintf(result_files[nviews*metrics.size()+m], "%d,%.6f\n", frame, pooled);
+        }
+    }
+
+    for (size_t i=0; i<result_files.size(); i++) {
+        fprintf(result_files[i], "average,%.6f", result_avg[i] / nbframes);
+        fclose(result_files[i]);
+    }
+    for (size_t v=0; v<nviews; v++) {
+        delete viewports[v];
+        delete engines[v];
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// Frames of the batches of scoreStreams(), one pool per stream (and per
+// stream for the colour metrics) of one batch each, allocated once by the
+// caller: a pool is a single buffer, so that the frames of a batch are
+// stacked without copies (see Metric::stack())
+struct BatchFrames {
+    BatchFrames(const VideoYUV *original_video, const VideoYUV *processed_video, int batch, bool color)
+        : original(batch, original_video->getHeight(), original_video->getWidth(), CV_32F),
+          processed(batch, processed_video->getHeight(), processed_video->getWidth(), CV_32F),
+          original_rgb(color ? batch : 0, original_video->getHeight(), original_video->getWidth(), CV_32FC3),
+          processed_rgb(color ? batch : 0, processed_video->getHeight(), processed_video->getWidth(), CV_32FC3)
+    {
+    }
+    FramePool original;
+    FramePool processed;
+    FramePool original_rgb;
+    FramePool processed_rgb;
+};
+
+// Drop the references of a batch from its last frame to its first, so that
+// the pool hands them out again in the order of its buffer
+static void releaseBatch(std::vector<FrameRef>& frames)
+{
+    while (!frames.empty())
+        frames.pop_back();
+}
+
+// Score the processed stream against the original with the engine, and
+// write one results file per metric
+// frames: pools of at least batch frames, colour ones if the engine needs
+// colour
+// alignment: the overlap of the streams is scored, if given
+// Returns false, the error being reported, if a results file cannot be
+// created or a frame cannot be read
+static bool scoreStreams(VideoYUV *original, VideoYUV *processed, ReadScheduler *reader, int start, int nbframes,
+                         int batch, const std::vector<std::string>& metrics, MetricEngine& engine, BatchFrames& frames,
+                         Alignment *alignment, const std::string& results_path, const std::string& prefix)
+{
+    // Output files for results.
+    FILE *result_file[METRIC_SIZE] = {nullptr};
+    bool ok = true;
+    for (auto metric : metrics) {
+        std::string name = results_path + "_" + prefix + metric + ".csv";
+        result_file[metric2index.at(metric)] = fopen(name.c_str(), "w");
+        if (result_file[metric2index.at(metric)] == nullptr) {
+            fprintf(stderr, "Cannot create results file (%s)\n", name.c_str());
+            ok = false;
+        }
+    }
+
+    // Print header to file.
+    for (int m=0; m<METRIC_SIZE; m++) {
+        if (result_file[m] != nullptr) {
+            fprintf(result_file[m], "frame,value\n");
         }
+    }
+
+    // The frames of a batch are held by reference in the pools, the
+    // metrics get views of them (ROIs of their overlap when aligned)
+    std::vector<FrameRef> original_refs, processed_refs;
+    std::vector<cv::Mat> original_frames, processed_frames;
+    // Colour frames, for the colour metrics
+    bool color = engine.needsColor();
+    std::vector<cv::Mat> original_rgb, processed_rgb;
+    std::vector<float> results;
+    float result_avg[METRIC_SIZE] = {0};
 
-        // Compute WSPSNR,
-        if (result_file[METRIC_WSPSNR] != nullptr) {
-            result[METRIC_WSPSNR] = wspsnr->compute(original_frame, processed_frame);
+    for (int first=start; ok && first<start+nbframes; first+=batch) {
+        size_t n = static_cast<size_t>(start+nbframes-first < batch ? start+nbframes-first : batch);
+        releaseBatch(original_refs);
+        releaseBatch(processed_refs);
+        original_frames.resize(n);
+        processed_frames.resize(n);
+        if (color) {
+            original_rgb.resize(n);
+            processed_rgb.resize(n);
         }
 
-        printf ( "PSNR: %.3f, WSPSNR: %.3f\n",
-                 static_cast<double>(result[METRIC_PSNR]),
-                 static_cast<double>(result[METRIC_WSPSNR]) );
+        for (size_t i=0; ok && i<n; i++) {
+            ok = reader->readOneFrame();
+            if (!ok)
+                break;
+            FrameRef original_frame = original->getLuma(frames.original);
+            FrameRef processed_frame = processed->getLuma(frames.processed);
+            ok = original_frame && processed_frame;
+            if (!ok)
+                break;
+            if (alignment != nullptr) {
+                alignment->apply(original_frame->image, processed_frame->image, original_frames[i], processed_frames[i]);
+            }
+            else {
+                original_frames[i] = original_frame->image;
+                processed_frames[i] = processed_frame->image;
+            }
+            original_refs.push_back(original_frame);
+            processed_refs.push_back(processed_frame);
+            if (color) {
+                FrameRef original_color = original->getRGB(frames.original_rgb);
+                FrameRef processed_color = processed->getRGB(frames.processed_rgb);
+                ok = original_color && processed_color;
+                if (!ok)
+                    break;
+                if (alignment != nullptr) {
+                    alignment->apply(original_color->image, processed_color->image, original_rgb[i], processed_rgb[i]);
+                }
+                else {
+                    original_rgb[i] = original_color->image;
+                    processed_rgb[i] = processed_color->image;
+                }
+                original_refs.push_back(original_color);
+                processed_refs.push_back(processed_color);
+            }
+        }
+        if (!ok)
+            break;
 
-        // Print quality index to file
-        for (int m=0; m<METRIC_SIZE; m++) {
-            if (result_file[m] != nullptr) {
-                result_avg[m] += result[m];
-                fprintf(result_file[m], "%d,%.6f\n", frame, static_cast<double>(result[m]));
+        if (color)
+            engine.computeBatch(first, original_frames, processed_frames, original_rgb, processed_rgb, results);
+        else
+            engine.computeBatch(first, original_frames, processed_frames, results);
+
+        for (size_t i=0; i<n; i++) {
+            int frame = first+static_cast<int>(i);
+            const float *result = &results[i*METRIC_SIZE];
+
+            printf ("Computing metrics for frame %d.\n", frame);
+            printf ( "PSNR: %.3f, WSPSNR: %.3f\n",
+                     static_cast<double>(result[METRIC_PSNR]),
+                     static_cast<double>(result[METRIC_WSPSNR]) );
+
+            // Print quality index to file
+            for (int m=0; m<METRIC_SIZE; m++) {
+                if (result_file[m] != nullptr) {
+                    result_avg[m] += result[m];
+                    fprintf(result_file[m], "%d,%.6f\n", frame, static_cast<double>(result[m]));
+                    TRACE_RESULT_WRITE(frame, m);
+                }
             }
         }
     }
@@ -265,21 +933,454 @@ int main (int argc, const char *argv[])
     for (int m = 0; m < METRIC_SIZE; m++) {
         if (result_file[m] != nullptr) {
             result_avg[m] /= static_cast<float>(nbframes);
-            fprintf(result_file[m], "average,%.6f", static_cast<double>(result_avg[m]));
+            if (ok)
+                fprintf(result_file[m], "average,%.6f", static_cast<double>(result_avg[m]));
             fclose(result_file[m]);
         }
     }
+    return ok;
+}
+
+int main (int argc, const char *argv[])
+{
+    // CPUs and memory of the container, if any, rather than of the host
+    SystemInfo sysinfo;
+
+    po::options_description desc("Allowed options");
+    desc.add_options()
+      ("help",          "produce this help message")
+      ("original,i",    po::value<std::string>(), "Original video stream (YUV, glob or @list of segments)")
+      ("processed,p",   po::value<std::string>(), "Processed video stream (YUV, glob or @list of segments)")
+      ("width,w",       po::value<int>(), "Width")
+      ("height,h",      po::value<int>(), "Height")
+      ("frames,f",      po::value<int>(), "Number of frames (default: all)")
+      ("start,s",       po::value<int>()->default_value(0), "First frame to process")
+      ("chroma,c",      po::value<int>(), "Chroma format")
+      ("bitdepth",      po::value<int>()->default_value(8), "Bits per sample, samples of more than 8 bits are stored on two bytes (little endian)")
+      ("transfer",      po::value<std::string>()->default_value("sdr"), "Transfer function: sdr, or pq and hlg for HDR (metrics on PU21 values, PU- results)")
+      ("full-range",    "Samples use the full range of codes instead of the narrow (video) range")
+      ("results,r",     po::value<std::string>(), "Output dir for results")
+      ("metrics,m",     po::value<std::vector<std::string>>()->multitoken(), "Metrics to compute")
+      ("readahead",     po::value<int>()->default_value(256), "Read-ahead budget in MB for both streams")
+      ("io",            po::value<std::string>()->default_value("read"), "I/O backend: read, mmap, uring, direct, or auto to pick the fastest on the original stream")
+      ("io-probe",      po::value<int>()->default_value(256), "I/O: MB read to compare the backends in auto mode")
+      ("threads,t",     po::value<int>()->default_value(sysinfo.getCpus()), "Worker threads for MS-SSIM, VIFp and VIF levels")
+      ("batch,b",       po::value<int>(), "Frames computed together: stacked by PSNR, SSIM, GMSD and PSNR-HVS, levels grouped by MS-SSIM and VIFp (default: as many as fit in about 2 Mpixels)")
+      ("rr-extract",    po::value<std::string>(), "Reduced reference: write the signatures of the original to this file")
+      ("rr-score",      po::value<std::string>(), "Reduced reference: score the processed against the signatures in this file")
+      ("rr-block",      po::value<int>()->default_value(32), "Reduced reference: block size of the signatures")
+      ("analyze",       po::value<std::string>(), "Pre-analysis: write the per-frame SI/TI and scene cuts and the per-block variance and activity of the original to this file")
+      ("analyze-block", po::value<int>()->default_value(16), "Pre-analysis: block size of the maps")
+      ("nr",            "No reference: score the processed stream alone (BRISQUE features, BRISQUE with 'nr-brisque-model' and NIQE with 'nr-model')")
+      ("nr-brisque-model", po::value<std::string>(), "No reference: BRISQUE SVR, libsvm model file of the reference code (allmodel)")
+      ("nr-brisque-range", po::value<std::string>(), "No reference: BRISQUE feature ranges, svm-scale range file of the reference code (allrange)")
+      ("nr-model",      po::value<std::string>(), "No reference: NIQE model of pristine content")
+      ("nr-train",      po::value<std::string>(), "No reference: train a NIQE model on the original stream (pristine content) and write it to this file")
+      ("images",        po::value<std::string>(), "Score the still image pairs of this manifest (one 'original processed' pair per line), any format and size supported by OpenCV")
+      ("image-engines", po::value<int>()->default_value(64), "Images: metric engines kept for reuse, for images of any size")
+#ifdef HAVE_SYS_INOTIFY_H
+      ("watch",         po::value<std::string>(), "Score the files completed in this directory against the reference given by 'original', with {name} and {prefix} replaced (see README)")
+      ("watch-ext",     po::value<std::string>()->default_value(".yuv"), "Watch: extension of the files to score")
+#endif
+#ifndef _WIN32
+      ("coordinator",   po::value<int>(), "Distribute the job: hand out frame ranges to workers on this TCP port")
+      ("bind",          po::value<std::string>()->default_value(""), "Coordinator: address of the interface to listen on (default: all), there is no authentication")
+      ("cluster-timeout", po::value<int>()->default_value(300), "Coordinator: seconds without news from a worker before its range is handed out again, or without any worker before giving up")
+      ("worker",        po::value<std::string>(), "Score frame ranges for the coordinator at host:port")
+      ("range",         po::value<int>()->default_value(250), "Frames per range handed out by the coordinator")
+#endif
+      ("realtime",      po::value<double>(), "Real-time input at this frame rate (e.g. a FIFO): shed expensive metrics to half resolution or fewer frames when falling behind, reported in results_REALTIME.csv")
+      ("adaptive",      po::value<double>(), "Score the metrics other than PSNR on this fraction of the frames only, chosen from the PSNR of all frames")
+      ("viewports",     po::value<std::vector<std::string>>()->multitoken(), "360: metrics on the viewports of ERP frames, 'cube' or a list of YAW,PITCH directions in degrees")
+      ("fov",           po::value<double>()->default_value(90.0), "360: horizontal field of view of the viewports, in degrees")
+      ("viewport-size", po::value<int>()->default_value(0), "360: width and height of the viewports (default: width*fov/360, the ERP resolution at the centre)")
+      ("align",         "Compensate a spatial offset (shift or crop) between the streams, the metrics are computed on the overlap")
+      ("align-subpixel", "Alignment: estimate the offset to a fraction of a pixel, the processed frames are resampled")
+      ("align-frames",  po::value<int>()->default_value(5), "Alignment: frames used to estimate the offset")
+      ("align-max",     po::value<int>()->default_value(32), "Alignment: largest offset searched, in pixels")
+      ("proc-width",    po::value<int>(), "Width of the processed stream, if cropped (default: width)")
+      ("proc-height",   po::value<int>(), "Height of the processed stream, if cropped (default: height)")
+      ("roofline",      "Benchmark the metric kernels against the memory and compute peaks of the host")
+      ;
+
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 1;
+    }
+
+    double duration = static_cast<double>(cv::getTickCount());
+
+    // OpenCV parallel loops and buffers within the limits, the read-ahead
+    // uses at most a quarter of the memory
+    sysinfo.print();
+    cv::setNumThreads(sysinfo.getCpus());
+    size_t readahead = static_cast<size_t>(vm["readahead"].as<int>()) << 20;
+    if (sysinfo.getMemory() > 0 && readahead > static_cast<size_t>(sysinfo.getMemory() / 4)) {
+        readahead = static_cast<size_t>(sysinfo.getMemory() / 4);
+        printf("Read-ahead limited to %zu MB.\n", readahead >> 20);
+    }
+
+    // I/O backend of the input files
+    int io = IOBackend::parse(vm["io"].as<std::string>());
+    if (io < 0 || !IOBackend::available(io)) {
+        fprintf(stderr, "I/O backend %s is not %s.\n", vm["io"].as<std::string>().c_str(), io < 0 ? "known" : "available in this build");
+        exit(EXIT_FAILURE);
+    }
+    if (io == IO_AUTO) {
+        // Probed on the first segment of the original, split between the backends
+        std::vector<double> bandwidth;
+        if (vm.count("original"))
+            io = IOBackend::probe(VideoYUV::expandPath(vm["original"].as<std::string>()).front(),
+                                  static_cast<size_t>(vm["io-probe"].as<int>()) << 20, bandwidth);
+        else
+            io = IO_READ;
+        printf("I/O:");
+        for (int mode=IO_READ; mode<IO_MODES; mode++) {
+            if (!bandwidth.empty() && bandwidth[static_cast<size_t>(mode)] > 0.0)
+                printf(" %s %.0f MB/s", IOBackend::name(mode), bandwidth[static_cast<size_t>(mode)]);
+        }
+        printf(" -> %s\n", IOBackend::name(io));
+    }
+    IOBackend::select(io);
+
+#ifndef _WIN32
+    // Worker mode, the job comes from the coordinator
+    if (vm.count("worker")) {
+        Worker worker(vm["worker"].as<std::string>(), vm["threads"].as<int>(), readahead);
+        return worker.run();
+    }
+#endif
+
+    // Roofline report, on synthetic frames (default size: 1920x1080)
+    if (vm.count("roofline")) {
+        Roofline roofline(vm.count("height") ? vm["height"].as<int>() : 1080,
+                          vm.count("width") ? vm["width"].as<int>() : 1920,
+                          vm["threads"].as<int>());
+        roofline.run();
+        return EXIT_SUCCESS;
+    }
+
+    // Bulk image mode, each pair has its own size
+    if (vm.count("images")) {
+        std::vector<int> indexes;
+        for (auto metric : selectMetrics(vm["metrics"].as<std::vector<std::string>>()))
+            indexes.push_back(metric2index.at(metric));
+        std::string manifest = vm["images"].as<std::string>();
+        std::string name = (vm.count("results") ? vm["results"].as<std::string>() : manifest) + "_IMAGES.csv";
+        FILE *results = fopen(name.c_str(), "w");
+        if (results == nullptr) {
+            fprintf(stderr, "Images: cannot create results file (%s)\n", name.c_str());
+            exit(EXIT_FAILURE);
+        }
+        int nthreads = vm["threads"].as<int>();
+        ThreadPool *pool = nthreads > 1 ? new ThreadPool(nthreads) : nullptr;
+        ImageScorer scorer(indexes, static_cast<size_t>(vm["image-engines"].as<int>()));
+        long failed = scorer.run(manifest, pool, results);
+        delete pool;
+        fclose(results);
+        return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Input parameters.
+    int width    = vm["width"].as<int>();
+    int height   = vm["height"].as<int>();
+    int nbframes = vm.count("frames") ? vm["frames"].as<int>() : -1;
+    int chroma   = vm["chroma"].as<int>();
+    int start    = vm["start"].as<int>();
+    int nthreads = vm["threads"].as<int>();
+    // Small frames are batched by default, as many as the metrics stack
+    int batch    = vm.count("batch") ? vm["batch"].as<int>() : static_cast<int>(Metric::stackFrames(height, width));
+    if (batch < 1)
+        batch = 1;
+    int bitdepth = vm["bitdepth"].as<int>();
+    bool full_range = vm.count("full-range") > 0;
+
+    // HDR: the metrics are computed on PU21 values, and named accordingly
+    std::map<std::string, int> transfers = {{"sdr", TRANSFER_SDR}, {"pq", TRANSFER_PQ}, {"hlg", TRANSFER_HLG}};
+    if (!transfers.count(vm["transfer"].as<std::string>())) {
+        fprintf(stderr, "Transfer function %s not supported (sdr, pq or hlg).\n", vm["transfer"].as<std::string>().c_str());
+        exit(EXIT_FAILURE);
+    }
+    int transfer = transfers[vm["transfer"].as<std::string>()];
+    std::string prefix = transfer != TRANSFER_SDR ? "PU-" : "";
+
+    // Reduced-reference modes, a single stream is needed
+    if (vm.count("rr-extract") || vm.count("rr-score")) {
+        ReducedReference rr(height, width, vm["rr-block"].as<int>());
+        int ret;
+        if (vm.count("rr-extract")) {
+            VideoYUV *original = openStream(vm["original"].as<std::string>(), height, width, chroma, bitdepth,
+                                            transfer, full_range, start, nbframes);
+            ret = extractSignatures(original, start, nbframes, rr, vm["rr-extract"].as<std::string>());
+            delete original;
+        }
+        else {
+            std::string proc_path = vm["processed"].as<std::string>();
+            std::string results_path = vm.count("results") ? vm["results"].as<std::string>() : proc_path;
+            VideoYUV *processed = openStream(proc_path, height, width, chroma, bitdepth, transfer, full_range, start, nbframes);
+            ret = scoreSignatures(processed, start, nbframes, rr, vm["rr-score"].as<std::string>(), results_path, prefix);
+            delete processed;
+        }
+        return ret;
+    }
+
+    // Pre-analysis of the original alone
+    if (vm.count("analyze")) {
+        // Frames shared with the analysis, which keeps the previous one
+        // (the pool outlives the analysis)
+        FramePool frames(3, height, width, CV_32F);
+        Analysis analysis(height, width, vm["analyze-block"].as<int>());
+        VideoYUV *original = openStream(vm["original"].as<std::string>(), height, width, chroma, bitdepth,
+                                        transfer, full_range, start, nbframes);
+        int ret = analyzeSource(original, start, nbframes, readahead, frames, analysis, vm["analyze"].as<std::string>());
+        delete original;
+        return ret;
+    }
+
+    // No-reference modes, a single stream is needed
+    if (vm.count("nr") || vm.count("nr-train")) {
+        NoReference nr(height, width);
+        bool niqe = vm.count("nr-model") > 0 || vm.count("nr-train") > 0;
+        if (niqe && (height < NoReference::PATCH_SIZE || width < NoReference::PATCH_SIZE)) {
+            fprintf(stderr, "NIQE: 'height' and 'width' have to be at least %d.\n", NoReference::PATCH_SIZE);
+            exit(EXIT_FAILURE);
+        }
+        int ret;
+        if (vm.count("nr-train")) {
+            VideoYUV *original = openStream(vm["original"].as<std::string>(), height, width, chroma, bitdepth,
+                                            transfer, full_range, start, nbframes);
+            ret = trainModel(original, start, nbframes, nr, vm["nr-train"].as<std::string>());
+            delete original;
+        }
+        else {
+            if (vm.count("nr-model") && !nr.loadModel(vm["nr-model"].as<std::string>())) exit(EXIT_FAILURE);
+            bool brisque = vm.count("nr-brisque-model") > 0;
+            if (brisque != (vm.count("nr-brisque-range") > 0)) {
+                fprintf(stderr, "BRISQUE: 'nr-brisque-model' and 'nr-brisque-range' go together.\n");
+                exit(EXIT_FAILURE);
+            }
+            if (brisque && !nr.loadRegressor(vm["nr-brisque-model"].as<std::string>(), vm["nr-brisque-range"].as<std::string>()))
+                exit(EXIT_FAILURE);
+            std::string proc_path = vm["processed"].as<std::string>();
+            std::string results_path = vm.count("results") ? vm["results"].as<std::string>() : proc_path;
+            VideoYUV *processed = openStream(proc_path, height, width, chroma, bitdepth, transfer, full_range, start, nbframes);
+            ret = scoreNoReference(processed, start, nbframes, nr, brisque, vm.count("nr-model") > 0, results_path, prefix);
+            delete processed;
+        }
+        return ret;
+    }
+
+    // Metrics to compute.
+    std::vector<std::string> metrics = selectMetrics(vm["metrics"].as<std::vector<std::string>>());
+
+    // SSIMULACRA 2 is defined on SDR content
+    if (std::count(metrics.begin(), metrics.end(), "SSIMULACRA2") && transfer != TRANSFER_SDR) {
+        fprintf(stderr, "SSIMULACRA2: only supported with the 'sdr' transfer function.\n");
+        exit(EXIT_FAILURE);
+    }
+
+#ifdef HAVE_SYS_INOTIFY_H
+    // Watch mode, the files completed in a directory are scored against
+    // their reference ('original' is the pattern of its path, see
+    // Watch::reference()) by an engine set up once
+    if (vm.count("watch")) {
+        checkSize(metrics, height, width);
+        bool enabled[METRIC_SIZE] = {false};
+        for (auto metric : metrics)
+            enabled[metric2index.at(metric)] = true;
+        ThreadPool *pool = nthreads > 1 ? new ThreadPool(nthreads) : nullptr;
+        MetricEngine *engine = new MetricEngine(height, width, enabled, pool);
+
+        std::string pattern = vm["original"].as<std::string>();
+        Watch watch(vm["watch"].as<std::string>(), vm["watch-ext"].as<std::string>());
+        // Streams, reader and batch frames of the first file, reused for
+        // the following ones (all the files have the same geometry)
+        VideoYUV *original = nullptr;
+        VideoYUV *processed = nullptr;
+        ReadScheduler *reader = nullptr;
+        BatchFrames *batch_frames = nullptr;
+        int ret = watch.run([&](const std::string& path) {
+            std::string reference = Watch::reference(pattern, path);
+            if (access(reference.c_str(), R_OK) != 0) {
+                fprintf(stderr, "Watch: no reference %s for %s, skipped.\n", reference.c_str(), path.c_str());
+                return;
+            }
+            printf("Watch: scoring %s against %s.\n", path.c_str(), reference.c_str());
+            // A bad or truncated file is reported and skipped, the process
+            // goes on
+            int orig_frames = nbframes;
+            int proc_frames = nbframes;
+            if (openWatchedStream(original, reference, height, width, chroma, bitdepth, transfer, full_range, start, orig_frames) &&
+                openWatchedStream(processed, path, height, width, chroma, bitdepth, transfer, full_range, start, proc_frames)) {
+                int frames = orig_frames < proc_frames ? orig_frames : proc_frames;
+                // No cap on the chunk from the frame count of the first file
+                if (reader == nullptr)
+                    reader = new ReadScheduler(original, processed, 0, readahead);
+                reader->restart(frames);
+                if (batch_frames == nullptr)
+                    batch_frames = new BatchFrames(original, processed, batch, engine->needsColor());
+                // Results alongside the processed file
+                if (!scoreStreams(original, processed, reader, start, frames, batch, metrics, *engine, *batch_frames,
+                                  nullptr, path, prefix))
+                    fprintf(stderr, "Watch: %s could not be scored, skipped.\n", path.c_str());
+            }
+        });
+        delete batch_frames;
+        delete reader;
+        delete original;
+        delete processed;
+        delete engine;
+        delete pool;
+        return ret;
+    }
+#endif /* HAVE_SYS_INOTIFY_H */
+
+    std::string orig_path = vm["original"].as<std::string>();
+    std::string proc_path = vm["processed"].as<std::string>();
+    std::string results_path = vm.count("results") ? vm["results"].as<std::string>() : proc_path;
+
+    // Input video streams.
+    // Without 'frames', the shortest of the two streams is processed.
+    // The processed stream may be cropped, the offset is then estimated.
+    bool align = vm.count("align") > 0 || vm.count("align-subpixel") > 0;
+    int proc_width  = vm.count("proc-width") ? vm["proc-width"].as<int>() : width;
+    int proc_height = vm.count("proc-height") ? vm["proc-height"].as<int>() : height;
+    if (!align && (proc_width != width || proc_height != height)) {
+        fprintf(stderr, "The streams have different sizes, use 'align' to compute the metrics on their overlap.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (align && (vm.count("coordinator") || vm.count("adaptive") || vm.count("realtime") || vm.count("viewports"))) {
+        fprintf(stderr, "Alignment is not supported with 'coordinator', 'adaptive', 'realtime' or 'viewports'.\n");
+        exit(EXIT_FAILURE);
+    }
+    int orig_frames = nbframes;
+    int proc_frames = nbframes;
+    VideoYUV *original  = openStream(orig_path, height, width, chroma, bitdepth, transfer, full_range, start, orig_frames);
+    VideoYUV *processed = openStream(proc_path, proc_height, proc_width, chroma, bitdepth, transfer, full_range, start, proc_frames);
+    nbframes = orig_frames < proc_frames ? orig_frames : proc_frames;
+
+    // Metrics on the overlap of the aligned streams
+    Alignment *alignment = nullptr;
+    int metric_height = height;
+    int metric_width  = width;
+    if (align) {
+        alignment = estimateAlignment(original, processed, start, nbframes, vm["align-frames"].as<int>(),
+                                      vm["align-max"].as<int>(), vm.count("align-subpixel") > 0);
+        metric_height = alignment->getHeight();
+        metric_width  = alignment->getWidth();
+    }
+
+    checkSize(metrics, metric_height, metric_width);
+
+#ifndef _WIN32
+    // Coordinator mode, the frames are scored by the workers
+    if (vm.count("coordinator")) {
+        delete original;
+        delete processed;
+
+        ClusterJob job;
+        job.original  = orig_path;
+        job.processed = proc_path;
+        job.height    = height;
+        job.width     = width;
+        job.chroma    = chroma;
+        job.bitdepth  = bitdepth;
+        job.transfer  = transfer;
+        job.full_range = full_range;
+        job.start     = start;
+        job.nbframes  = nbframes;
+        job.metrics   = metrics;
+        Coordinator coordinator(job, vm["bind"].as<std::string>(), vm["coordinator"].as<int>(),
+                                vm["range"].as<int>(), vm["cluster-timeout"].as<int>());
+        return coordinator.run(results_path);
+    }
+#endif
+
+    // A live input is read one frame at a time: a larger chunk would wait
+    // for frames not delivered yet, and the frames read with them would all
+    // look late
+    ReadScheduler *reader = new ReadScheduler(original, processed, nbframes, vm.count("realtime") ? 0 : readahead);
+
+    // Adaptive mode, the chosen frames are read again
+    if (vm.count("adaptive")) {
+        double fraction = vm["adaptive"].as<double>();
+        if (fraction <= 0.0 || fraction > 1.0 || original->getTotalFrames() < 0 || processed->getTotalFrames() < 0) {
+            fprintf(stderr, "Adaptive: the fraction has to be in (0,1] and the inputs have to be files.\n");
+            exit(EXIT_FAILURE);
+        }
+        bool expensive[METRIC_SIZE] = {false};
+        for (auto metric : metrics) {
+            if (metric2index.at(metric) != METRIC_PSNR)
+                expensive[metric2index.at(metric)] = true;
+        }
+        ThreadPool *pool = nthreads > 1 ? new ThreadPool(nthreads) : nullptr;
+        MetricEngine *engine = new MetricEngine(height, width, expensive, pool);
+        int ret = adaptiveScoring(original, processed, reader, height, width, start, nbframes, metrics,
+                                  fraction, results_path, prefix, *engine);
+        delete engine;
+        delete pool;
+        delete reader;
+        delete original;
+        delete processed;
+        return ret;
+    }
+
+    // Real-time mode, expensive metrics shed when late
+    if (vm.count("realtime")) {
+        double fps = vm["realtime"].as<double>();
+        if (fps <= 0.0) {
+            fprintf(stderr, "Realtime: the frame rate has to be positive.\n");
+            exit(EXIT_FAILURE);
+        }
+        ThreadPool *pool = nthreads > 1 ? new ThreadPool(nthreads) : nullptr;
+        int ret = realtimeScoring(original, processed, reader, height, width, start, nbframes, metrics,
+                                  fps, results_path, prefix, pool);
+        delete pool;
+        delete reader;
+        delete original;
+        delete processed;
+        return ret;
+    }
+
+    // Viewport mode, for 360 content
+    if (vm.count("viewports")) {
+        ThreadPool *pool = nthreads > 1 ? new ThreadPool(nthreads) : nullptr;
+        int ret = viewportScoring(original, processed, reader, height, width, start, nbframes, metrics,
+                                  vm["viewports"].as<std::vector<std::string>>(), vm["fov"].as<double>(),
+                                  vm["viewport-size"].as<int>(), results_path, prefix, pool);
+        delete pool;
+        delete reader;
+        delete original;
+        delete processed;
+        return ret;
+    }
+
+    bool enabled[METRIC_SIZE] = {false};
+    for (auto metric : metrics)
+        enabled[metric2index.at(metric)] = true;
+    ThreadPool *pool = nthreads > 1 ? new ThreadPool(nthreads) : nullptr;
+    MetricEngine *engine = new MetricEngine(metric_height, metric_width, enabled, pool);
+
+    BatchFrames *batch_frames = new BatchFrames(original, processed, batch, engine->needsColor());
+
+    bool scored = scoreStreams(original, processed, reader, start, nbframes, batch, metrics, *engine, *batch_frames,
+                               alignment, results_path, prefix);
 
-    delete psnr;
-    delete ssim;
-    delete msssim;
-    delete vifp;
-    delete phvs;
+    delete batch_frames;
 
-    delete wspsnr;
+    delete engine;
+    delete pool;
+    delete alignment;
 
+    delete reader;
     delete original;
     delete processed;
+    if (!scored)
+        return EXIT_FAILURE;
 
     duration = static_cast<double>(cv::getTickCount()) - duration;
     duration /= cv::getTickFrequency();
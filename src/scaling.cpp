@@ -0,0 +1,293 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+/**************************************************************************
+
+ Parallel scaling benchmark.
+
+ Usage:
+  vqmt-scaling [--metrics PSNR SSIM ...] [--sizes 1920x1080 ...]
+               [--threads N] [--processes N] [--frames F] [--output scaling.csv]
+
+ Runs a fixed synthetic workload (F frames per worker) for each metric and
+ resolution, with 1, 2, 4, ... N threads (OpenCV threads and vqmt thread
+ pool) in a single process, and with 1, 2, 4, ... N single-threaded
+ processes running side by side. Threads share the frames (strong
+ scaling), each process scores its own F frames (weak scaling, measured
+ as throughput).
+
+ For each run, the speedup over one worker, the efficiency and the
+ Karp-Flatt serial fraction are reported, and the Amdahl serial fraction
+ is fitted over all the runs of a sweep (least squares on 1/speedup).
+
+ CSV columns:
+  mode,metric,width,height,workers,seconds,fps,speedup,efficiency,karp_flatt,amdahl
+
+**************************************************************************/
+
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <opencv2/core/core.hpp>
+
+//Boost::program_options
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+
+#include "Benchmark.hpp"
+#include "MetricEngine.hpp"
+#include "SystemInfo.hpp"
+#include "ThreadPool.hpp"
+
+struct Run {
+    int workers;
+    double seconds;
+    double fps;
+};
+
+// Worker counts of a sweep: powers of two up to max, and max
+static std::vector<int> workerCounts(int max)
+{
+    std::vector<int> counts;
+    for (int n=1; n<max; n*=2)
+        counts.push_back(n);
+    counts.push_back(max < 1 ? 1 : max);
+    return counts;
+}
+
+// Score the same pair of frames nbframes times
+static void scoreFrames(MetricEngine& engine, const cv::Mat& original, const cv::Mat& processed, int nbframes)
+{
+    std::vector<cv::Mat> original_frames(1, original), processed_frames(1, processed);
+    std::vector<float> results;
+    for (int f=0; f<nbframes; f++)
+        engine.computeBatch(f, original_frames, processed_frames, results);
+}
+
+// One process, nthreads threads
+static Run runThreads(int metric, int height, int width, int nthreads, int nbframes)
+{
+    bool enabled[METRIC_SIZE] = {false};
+    enabled[metric] = true;
+
+    cv::setNumThreads(nthreads);
+    ThreadPool *pool = nthreads > 1 ? new ThreadPool(nthreads) : nullptr;
+    MetricEngine *engine = new MetricEngine(height, width, enabled, pool);
+    cv::Mat original, processed;
+    Benchmark::syntheticFrames(height, width, original, processed);
+
+    Run run;
+    run.workers = nthreads;
+    run.seconds = Benchmark::time([&]() { scoreFrames(*engine, original, processed, nbframes); }, 0.0, 1);
+    run.fps = nbframes / run.seconds;
+
+    delete engine;
+    delete pool;
+    return run;
+}
+
+// nprocs single-threaded processes, started together once they are ready
+static Run runProcesses(int metric, int height, int width, int nprocs, int nbframes)
+{
+    int ready[2], go[2];
+    if (pipe(ready) != 0 || pipe(go) != 0) {
+        fprintf(stderr, "Scaling: cannot create pipes.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    std::vector<pid_t> children;
+    for (int p=0; p<nprocs; p++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            fprintf(stderr, "Scaling: cannot fork.\n");
+            exit(EXIT_FAILURE);
+        }
+        if (pid == 0) {
+            close(ready[0]);
+            close(go[1]);
+            bool enabled[METRIC_SIZE] = {false};
+            enabled[metric] = true;
+            cv::setNumThreads(1);
+            MetricEngine engine(height, width, enabled, nullptr);
+            cv::Mat original, processed;
+            Benchmark::syntheticFrames(height, width, original, processed);
+            // Warm up, then wait for the others
+            scoreFrames(engine, original, processed, 1);
+            char c = 0;
+            if (write(ready[1], &c, 1) != 1 || read(go[0], &c, 1) < 0)
+                _exit(EXIT_FAILURE);
+            scoreFrames(engine, original, processed, nbframes);
+            _exit(EXIT_SUCCESS);
+        }
+        children.push_back(pid);
+    }
+    close(ready[1]);
+    close(go[0]);
+
+    char c;
+    for (int p=0; p<nprocs; p++) {
+        if (read(ready[0], &c, 1) != 1) {
+            fprintf(stderr, "Scaling: a worker process failed.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Closing the pipe releases all the children at once
+    double start = static_cast<double>(cv::getTickCount());
+    close(go[1]);
+    for (size_t p=0; p<children.size(); p++) {
+        int status;
+        waitpid(children[p], &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+            fprintf(stderr, "Scaling: a worker process failed.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    close(ready[0]);
+
+    Run run;
+    run.workers = nprocs;
+    run.seconds = (static_cast<double>(cv::getTickCount()) - start) / cv::getTickFrequency();
+    run.fps = nprocs*nbframes / run.seconds;
+    return run;
+}
+
+// Least-squares fit of the serial fraction f of Amdahl's law,
+// 1/S = f + (1-f)/n, i.e. 1/S - 1/n = f (1 - 1/n)
+static double fitAmdahl(const std::vector<Run>& runs)
+{
+    double sxy = 0.0, sxx = 0.0;
+    for (auto& r : runs) {
+        double speedup = r.fps / runs[0].fps;
+        double x = 1.0 - 1.0/r.workers;
+        double y = 1.0/speedup - 1.0/r.workers;
+        sxy += x*y;
+        sxx += x*x;
+    }
+    return sxx > 0.0 ? sxy/sxx : 0.0;
+}
+
+static void report(FILE *csv, const char *mode, const std::string& metric, int width, int height,
+                   const std::vector<Run>& runs)
+{
+    double amdahl = fitAmdahl(runs);
+    printf("%s %s %dx%d: serial fraction %.4f (Amdahl)\n", metric.c_str(), mode, width, height, amdahl);
+    printf("  %8s %10s %10s %8s %10s %10s\n", "workers", "seconds", "fps", "speedup", "efficiency", "karp-flatt");
+    for (auto& r : runs) {
+        double speedup = r.fps / runs[0].fps;
+        double efficiency = speedup / r.workers;
+        // Experimentally determined serial fraction, undefined for one worker
+        double karp_flatt = r.workers > 1 ? (1.0/speedup - 1.0/r.workers) / (1.0 - 1.0/r.workers) : 0.0;
+        printf("  %8d %10.3f %10.2f %8.2f %10.2f %10.4f\n", r.workers, r.seconds, r.fps, speedup, efficiency, karp_flatt);
+        fprintf(csv, "%s,%s,%d,%d,%d,%.6f,%.4f,%.4f,%.4f,%.6f,%.6f\n", mode, metric.c_str(), width, height,
+                r.workers, r.seconds, r.fps, speedup, efficiency, karp_flatt, amdahl);
+    }
+}
+
+int main (int argc, const char *argv[])
+{
+    int ncpus = SystemInfo().getCpus();
+
+    po::options_description desc("Allowed options");
+    desc.add_options()
+      ("help",        "produce this help message")
+      ("metrics,m",   po::value<std::vector<std::string>>()->multitoken()
+                          ->default_value(std::vector<std::string>{"PSNR", "SSIM", "MSSSIM", "VIFP", "PSNRHVS"}, "PSNR SSIM MSSSIM VIFP PSNRHVS"),
+                      "Metrics to benchmark")
+      ("sizes",       po::value<std::vector<std::string>>()->multitoken()
+                          ->default_value(std::vector<std::string>{"1920x1080"}, "1920x1080"),
+                      "Resolutions, as WIDTHxHEIGHT")
+      ("threads,t",   po::value<int>()->default_value(ncpus), "Largest number of threads")
+      ("processes,n", po::value<int>()->default_value(ncpus), "Largest number of processes")
+      ("frames,f",    po::value<int>()->default_value(8), "Frames scored by each worker")
+      ("output,o",    po::value<std::string>()->default_value("scaling.csv"), "CSV output file")
+      ;
+
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 1;
+    }
+
+    std::vector<int> metrics;
+    std::vector<std::string> names;
+    for (auto metric : vm["metrics"].as<std::vector<std::string>>()) {
+        if (metric2index.count(metric)) {
+            metrics.push_back(metric2index.at(metric));
+            names.push_back(metric);
+        }
+        else {
+            printf ("Warning: Metric %s not recognized and will be ignored.\n", metric.c_str() );
+        }
+    }
+
+    std::vector<std::pair<int,int>> sizes;
+    for (auto size : vm["sizes"].as<std::vector<std::string>>()) {
+        int w, h;
+        if (sscanf(size.c_str(), "%dx%d", &w, &h) != 2 || w <= 0 || h <= 0) {
+            fprintf(stderr, "Scaling: invalid size %s, expected WIDTHxHEIGHT.\n", size.c_str());
+            exit(EXIT_FAILURE);
+        }
+        sizes.push_back(std::make_pair(w, h));
+    }
+
+    int nbframes = vm["frames"].as<int>();
+    std::string path = vm["output"].as<std::string>();
+    FILE *csv = fopen(path.c_str(), "w");
+    if (csv == nullptr) {
+        fprintf(stderr, "Scaling: cannot create %s\n", path.c_str());
+        exit(EXIT_FAILURE);
+    }
+    fprintf(csv, "mode,metric,width,height,workers,seconds,fps,speedup,efficiency,karp_flatt,amdahl\n");
+
+    // Process sweeps first: forking is only safe before OpenCV and the
+    // thread pool have started threads in this process
+    for (auto& size : sizes) {
+        for (size_t m=0; m<metrics.size(); m++) {
+            std::vector<Run> runs;
+            for (int n : workerCounts(vm["processes"].as<int>()))
+                runs.push_back(runProcesses(metrics[m], size.second, size.first, n, nbframes));
+            report(csv, "processes", names[m], size.first, size.second, runs);
+        }
+    }
+
+    for (auto& size : sizes) {
+        for (size_t m=0; m<metrics.size(); m++) {
+            std::vector<Run> runs;
+            for (int n : workerCounts(vm["threads"].as<int>()))
+                runs.push_back(runThreads(metrics[m], size.second, size.first, n, nbframes));
+            report(csv, "threads", names[m], size.first, size.second, runs);
+        }
+    }
+
+    fclose(csv);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,138 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "FramePool.hpp"
+#include "Tests.hpp"
+
+static const int HEIGHT = 16;
+static const int WIDTH = 8;
+
+// Whether frame is frame i of its pool, the frames one below the other
+// from first
+static bool inSlot(const FrameRef& frame, const FrameRef& first, int i)
+{
+    size_t step = first->image.step;
+    return frame->image.data == first->image.data + size_t(i)*HEIGHT*step;
+}
+
+// References: a frame is recycled only when its last copy is dropped, and
+// a batch released back to front is handed out again in buffer order
+bool testFramePoolRefs()
+{
+    static const int NFRAMES = 3;
+    bool passed = true;
+    FramePool pool(NFRAMES, HEIGHT, WIDTH, CV_32F);
+    std::vector<FrameRef> batch;
+    for (int i=0; i<NFRAMES; i++)
+        batch.push_back(pool.acquire());
+    for (int i=0; i<NFRAMES; i++)
+        passed = check(batch[size_t(i)] && inSlot(batch[size_t(i)], batch[0], i),
+                       "FramePool: frame %d is not in buffer order", i) && passed;
+    passed = check(!pool.tryAcquire(), "FramePool: frame handed out from an empty pool") && passed;
+
+    // Copies, moves and assignments keep the frame out of the pool
+    FrameRef copy = batch[0];
+    FrameRef assigned;
+    assigned = copy;
+    FrameRef moved(std::move(copy));
+    passed = check(!copy, "FramePool: moved-from reference still set") && passed;
+    batch[0] = FrameRef();
+    passed = check(!pool.tryAcquire(), "FramePool: frame recycled with 2 references left") && passed;
+    moved = FrameRef();
+    passed = check(!pool.tryAcquire(), "FramePool: frame recycled with 1 reference left") && passed;
+    assigned = FrameRef();
+    FrameRef again = pool.tryAcquire();
+    passed = check(again && inSlot(batch[1], again, 1), "FramePool: frame not recycled after its last reference")
+        && passed;
+    batch[0] = again;
+    again = FrameRef();
+
+    // Back to front from an empty pool, as releaseBatch() in main.cpp
+    while (!batch.empty())
+        batch.pop_back();
+    for (int i=0; i<NFRAMES; i++) {
+        batch.push_back(pool.acquire());
+        passed = check(inSlot(batch.back(), batch[0], i), "FramePool: frame %d out of order after release", i)
+            && passed;
+    }
+    while (!batch.empty())
+        batch.pop_back();
+    return passed;
+}
+
+// Waits: acquire() times out on an empty pool, and wakes up when a frame
+// is released by another thread
+bool testFramePoolWait()
+{
+    bool passed = true;
+    FramePool pool(1, HEIGHT, WIDTH, CV_32F);
+    FrameRef held = pool.acquire();
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    FrameRef none = pool.acquire(0.05);
+    double waited = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+    passed = check(!none, "FramePool: frame handed out from an empty pool") && passed;
+    passed = check(waited >= 0.04, "FramePool: timeout after %.3f s instead of 0.05 s", waited) && passed;
+
+    std::thread releaser([&held]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        held = FrameRef();
+    });
+    FrameRef woken = pool.acquire(10.0);
+    releaser.join();
+    passed = check(static_cast<bool>(woken), "FramePool: waiter not woken up by a release") && passed;
+    return passed;
+}
+
+// Threads taking, sharing and dropping frames of a small pool: a frame is
+// never handed out twice while held
+bool testFramePoolThreads()
+{
+    static const int NTHREADS = 4;
+    static const int ITERATIONS = 20000;
+    FramePool pool(2, HEIGHT, WIDTH, CV_32F);
+    std::atomic<int> errors(0);
+    std::vector<std::thread> threads;
+    for (int t=0; t<NTHREADS; t++) {
+        threads.push_back(std::thread([&pool, &errors, t]() {
+            for (int i=0; i<ITERATIONS; i++) {
+                FrameRef frame = pool.acquire();
+                int tag = t*ITERATIONS+i;
+                frame.fill()->number = tag;
+                FrameRef shared = frame;
+                frame = FrameRef();
+                std::this_thread::yield();
+                if (shared->number != tag)
+                    errors.fetch_add(1);
+            }
+        }));
+    }
+    for (size_t t=0; t<threads.size(); t++)
+        threads[t].join();
+    return check(errors.load() == 0, "FramePool: %d frames handed out while held", errors.load());
+}
@@ -0,0 +1,79 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+#include <cmath>
+#include "SSIMULACRA2.hpp"
+#include "Tests.hpp"
+
+// R'G'B' (0-1) of a luma frame (0-255), the same in the three channels
+static void toGray(const cv::Mat& luma, cv::Mat& rgb)
+{
+    cv::Mat scaled = luma / 255.0;
+    cv::Mat planes[] = {scaled, scaled, scaled};
+    cv::merge(planes, 3, rgb);
+}
+
+// Properties of the reference implementation: 100 for identical images,
+// luma scored as gray R'G'B', lower scores for stronger distortions, and
+// the smallest images (8x8, a single scale) scored
+bool testSSIMULACRA2Reference()
+{
+    static const int HEIGHT = 72;
+    static const int WIDTH = 96;
+    bool passed = true;
+    SSIMULACRA2 metric(HEIGHT, WIDTH);
+    cv::Mat frame, light, strong;
+    randomFrame(frame, HEIGHT, WIDTH, 1);
+    noisyFrame(frame, light, 2.0, 2);
+    noisyFrame(frame, strong, 8.0, 3);
+
+    double same = metric.compute(frame, frame);
+    passed = check(std::fabs(same-100.0) <= 1e-3, "SSIMULACRA2 of identical luma images: %.6f", same) && passed;
+    cv::Mat rgb, light_rgb, strong_rgb;
+    toGray(frame, rgb);
+    toGray(light, light_rgb);
+    toGray(strong, strong_rgb);
+    double same_rgb = metric.compute(rgb, rgb);
+    passed = check(std::fabs(same_rgb-100.0) <= 1e-3, "SSIMULACRA2 of identical R'G'B' images: %.6f", same_rgb)
+        && passed;
+
+    double luma_score = metric.compute(frame, light);
+    double rgb_score = metric.compute(rgb, light_rgb);
+    passed = check(std::fabs(luma_score-rgb_score) <= 1e-3, "SSIMULACRA2 of luma %.6f, of the same gray R'G'B' %.6f",
+                   luma_score, rgb_score) && passed;
+
+    double strong_score = metric.compute(rgb, strong_rgb);
+    passed = check(rgb_score < 100.0 && strong_score < rgb_score,
+                   "SSIMULACRA2 with noise of sigma 2: %.6f, of sigma 8: %.6f", rgb_score, strong_score) && passed;
+
+    SSIMULACRA2 tiny(8, 8);
+    cv::Mat tiny_frame, tiny_noisy;
+    randomFrame(tiny_frame, 8, 8, 4);
+    noisyFrame(tiny_frame, tiny_noisy, 8.0, 5);
+    double tiny_same = tiny.compute(tiny_frame, tiny_frame);
+    double tiny_score = tiny.compute(tiny_frame, tiny_noisy);
+    passed = check(std::fabs(tiny_same-100.0) <= 1e-3 && std::isfinite(tiny_score) && tiny_score < 100.0,
+                   "SSIMULACRA2 of 8x8 images: %.6f identical, %.6f with noise", tiny_same, tiny_score) && passed;
+    return passed;
+}
@@ -0,0 +1,90 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+#include <math.h>
+#include <vector>
+#include "FramePool.hpp"
+#include "PSNR.hpp"
+#include "SSIM.hpp"
+#include "Tests.hpp"
+
+// Batch of n frames: the original frames consecutive in a pool (stacked
+// as a view), the processed frames allocated one by one (stacked as a copy)
+static void makeBatch(FramePool& pool, int n, int height, int width, std::vector<FrameRef>& refs,
+                      std::vector<cv::Mat>& original, std::vector<cv::Mat>& processed)
+{
+    for (int i=0; i<n; i++) {
+        FrameRef ref = pool.acquire();
+        cv::Mat frame;
+        randomFrame(frame, height, width, uint64_t(i+1));
+        frame.copyTo(ref.fill()->image);
+        original.push_back(ref->image);
+        refs.push_back(ref);
+        cv::Mat noisy;
+        noisyFrame(frame, noisy, 2.0 + i, uint64_t(1000+i));
+        processed.push_back(noisy);
+    }
+}
+
+// Compare computeFrames() with compute() on batches of small frames (many
+// per stack) and of large frames (2 per stack, the last stack partial)
+template <class M>
+static bool testStacked(const char *metric, double tolerance)
+{
+    static const int SIZES[][3] = {{48, 64, 7}, {1024, 1024, 5}};
+    bool passed = true;
+    for (size_t s=0; s<sizeof(SIZES)/sizeof(SIZES[0]); s++) {
+        int height = SIZES[s][0], width = SIZES[s][1], n = SIZES[s][2];
+        FramePool pool(n, height, width, CV_32F);
+        std::vector<FrameRef> refs;
+        std::vector<cv::Mat> original, processed;
+        makeBatch(pool, n, height, width, refs, original, processed);
+
+        M stacked(height, width);
+        std::vector<float> results;
+        stacked.computeFrames(original, processed, results);
+        passed = check(results.size() == size_t(n), "%s %dx%d: %d results for %d frames", metric, width, height,
+                       int(results.size()), n) && passed;
+        for (int i=0; i<n && size_t(i)<results.size(); i++) {
+            M single(height, width);
+            double expected = single.compute(original[size_t(i)], processed[size_t(i)]);
+            double got = results[size_t(i)];
+            passed = check(fabs(got-expected) <= tolerance, "%s %dx%d frame %d: stacked %.6f, per frame %.6f",
+                           metric, width, height, i, got, expected) && passed;
+        }
+        while (!refs.empty())
+            refs.pop_back();
+    }
+    return passed;
+}
+
+bool testStackedSSIM()
+{
+    return testStacked<SSIM>("SSIM", 1e-5);
+}
+
+bool testStackedPSNR()
+{
+    return testStacked<PSNR>("PSNR", 1e-3);
+}
@@ -0,0 +1,67 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+/**************************************************************************
+
+ Regression tests, run by CTest through vqmt-tests (see main.cpp).
+
+ Each test returns true when it passes, and reports every failed check on
+ stderr. The frames are synthetic, from a fixed seed, so that a failure
+ is reproducible.
+
+**************************************************************************/
+
+#ifndef Tests_hpp
+#define Tests_hpp
+
+#include <stdint.h>
+#include <opencv2/core/core.hpp>
+
+// Report a failed check, printf format
+// Return condition
+bool check(bool condition, const char *format, ...);
+
+// Random texture of height x width samples (CV_32F, 0-255) from seed
+void randomFrame(cv::Mat& frame, int height, int width, uint64_t seed);
+
+// Frame plus Gaussian noise of the given standard deviation, from seed
+void noisyFrame(const cv::Mat& frame, cv::Mat& noisy, double sigma, uint64_t seed);
+
+// Stacked SSIM and PSNR (Metric::computeFrames()) against compute() frame
+// by frame
+bool testStackedSSIM();
+bool testStackedPSNR();
+
+// VIFp at the smallest frame size accepted by vqmt
+bool testVIFPSmall();
+
+// FramePool reference counting, waits and concurrent use
+bool testFramePoolRefs();
+bool testFramePoolWait();
+bool testFramePoolThreads();
+
+// SSIMULACRA 2 against properties of the reference implementation
+bool testSSIMULACRA2Reference();
+
+#endif
@@ -0,0 +1,63 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+#include <cmath>
+#include <vector>
+#include "Tests.hpp"
+#include "VIFP.hpp"
+
+// VIFp at its smallest frame size (41x41, a 3x3 window on the 4th scale):
+// 1 for identical frames, below 1 with noise, and the same frame by frame
+// and in a batch
+bool testVIFPSmall()
+{
+    static const int SIZE = 41;
+    static const int NFRAMES = 3;
+    bool passed = true;
+    std::vector<cv::Mat> original, processed;
+    for (int i=0; i<NFRAMES; i++) {
+        cv::Mat frame, noisy;
+        randomFrame(frame, SIZE, SIZE, uint64_t(i+1));
+        noisyFrame(frame, noisy, 4.0, uint64_t(1000+i));
+        original.push_back(frame);
+        processed.push_back(noisy);
+    }
+
+    VIFP vifp(SIZE, SIZE);
+    double same = vifp.compute(original[0], original[0]);
+    passed = check(std::fabs(same-1.0) <= 1e-4, "VIFp %dx%d of identical frames: %.6f", SIZE, SIZE, same) && passed;
+
+    std::vector<float> batch;
+    vifp.computeBatch(original, processed, batch);
+    passed = check(batch.size() == size_t(NFRAMES), "VIFp %dx%d: %d results for %d frames", SIZE, SIZE,
+                   int(batch.size()), NFRAMES) && passed;
+    for (int i=0; i<NFRAMES && size_t(i)<batch.size(); i++) {
+        double single = vifp.compute(original[size_t(i)], processed[size_t(i)]);
+        passed = check(std::isfinite(single) && single > 0.0 && single < 1.0,
+                       "VIFp %dx%d frame %d with noise: %.6f", SIZE, SIZE, i, single) && passed;
+        passed = check(std::fabs(double(batch[size_t(i)])-single) <= 1e-5, "VIFp %dx%d frame %d: batch %.6f, per frame %.6f",
+                       SIZE, SIZE, i, double(batch[size_t(i)]), single) && passed;
+    }
+    return passed;
+}
@@ -0,0 +1,112 @@
+//
+// Copyright(c) Multimedia Signal Processing Group (MMSPG),
+//              Ecole Polytechnique Fédérale de Lausanne (EPFL)
+//              http://mmspg.epfl.ch
+// All rights reserved.
+// Author: Roberto Azevedo (roberto.azevedo@epfl.ch)
+//
+// Permission is hereby granted, without written agreement and without
+// license or royalty fees, to use, copy, modify, and distribute the
+// software provided and its documentation for research purpose only,
+// provided that this copyright notice and the original authors' names
+// appear on all copies and supporting documentation.
+// The software provided may not be commercially distributed.
+// In no event shall the Ecole Polytechnique Fédérale de Lausanne (EPFL)
+// be liable to any party for direct, indirect, special, incidental, or
+// consequential damages arising out of the use of the software and its
+// documentation.
+// The Ecole Polytechnique Fédérale de Lausanne (EPFL) specifically
+// disclaims any warranties.
+// The software provided hereunder is on an "as is" basis and the Ecole
+// Polytechnique Fédérale de Lausanne (EPFL) has no obligation to provide
+// maintenance, support, updates, enhancements, or modifications.
+//
+
+/**************************************************************************
+
+ Regression tests.
+
+ Usage:
+  vqmt-tests NAME...
+
+ Runs the named tests (all of them without a name), and exits with a
+ failure status if any fails. CTest runs each test on its own.
+
+**************************************************************************/
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <opencv2/imgproc/imgproc.hpp>
+#include "Tests.hpp"
+
+struct Test {
+    const char *name;
+    bool (*run)();
+};
+
+static const Test TESTS[] = {
+    {"stacked-ssim", testStackedSSIM},
+    {"stacked-psnr", testStackedPSNR},
+    {"vifp-small", testVIFPSmall},
+    {"frame-pool-refs", testFramePoolRefs},
+    {"frame-pool-wait", testFramePoolWait},
+    {"frame-pool-threads", testFramePoolThreads},
+    {"ssimulacra2-reference", testSSIMULACRA2Reference},
+};
+
+bool check(bool condition, const char *format, ...)
+{
+    if (!condition) {
+        va_list args;
+        va_start(args, format);
+        fprintf(stderr, "FAILED: ");
+        vfprintf(stderr, format, args);
+        fprintf(stderr, "\n");
+        va_end(args);
+    }
+    return condition;
+}
+
+void randomFrame(cv::Mat& frame, int height, int width, uint64_t seed)
+{
+    // Smoothed noise: a texture with structure at several scales, rather
+    // than white noise on which every metric saturates
+    cv::RNG rng(seed);
+    cv::Mat noise(height, width, CV_32F);
+    rng.fill(noise, cv::RNG::UNIFORM, cv::Scalar(0.0), cv::Scalar(255.0));
+    cv::GaussianBlur(noise, frame, cv::Size(0, 0), 1.5);
+    cv::normalize(frame, frame, 0.0, 255.0, cv::NORM_MINMAX);
+}
+
+void noisyFrame(const cv::Mat& frame, cv::Mat& noisy, double sigma, uint64_t seed)
+{
+    cv::RNG rng(seed);
+    cv::Mat noise(frame.rows, frame.cols, CV_32F);
+    rng.fill(noise, cv::RNG::NORMAL, cv::Scalar(0.0), cv::Scalar(sigma));
+    cv::add(frame, noise, noisy);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t ntests = sizeof(TESTS)/sizeof(TESTS[0]);
+    bool passed = true;
+    int run = 0;
+    for (size_t t=0; t<ntests; t++) {
+        bool selected = argc < 2;
+        for (int a=1; a<argc; a++)
+            selected = selected || strcmp(argv[a], TESTS[t].name) == 0;
+        if (!selected)
+            continue;
+        bool ok = TESTS[t].run();
+        printf("%s: %s\n", TESTS[t].name, ok ? "passed" : "FAILED");
+        passed = passed && ok;
+        run++;
+    }
+    if (run == 0) {
+        fprintf(stderr, "No such test.\n");
+        return EXIT_FAILURE;
+    }
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}